@@ -163,7 +163,8 @@ def build_dBG_args(descr=None, epilog=None, parser=None):
                              ' set')
     parser.add_argument('--fp-rate', type=float, default=None,
                         help="Override the automatic FP rate setting for the"
-                        " current script")
+                        " current script; warn once the estimated FP rate"
+                        " exceeds it")
 
     group = parser.add_mutually_exclusive_group()
     help = ('upper bound on tablesize to use; overrides --max-memory-usage/-M'
@@ -194,6 +195,16 @@ def add_output_interval_args(parser):
     parser.add_argument('--coarse-interval', type=int, default=DEFAULT_INTERVALS.COARSE)
 
 
+def add_report_format_args(parser):
+    parser.add_argument('--report-format',
+                        choices=['csv', 'binary'],
+                        default='csv',
+                        help='Write interval reports as CSV, or as fixed-width '
+                             'binary records; read the latter with '
+                             'boink.records.read_records.')
+    return parser
+
+
 def print_interval_settings(args):
     print('* FINE output interval:', args.fine_interval, file=sys.stderr)
     print('* MEDIUM output interval:', args.medium_interval, file=sys.stderr)
@@ -231,6 +242,11 @@ def add_save_cDBG_args(parser):
                         metavar='FILENAME.graphml',
                         nargs='?',
                         const='boink.cdbg.history.graphml')
+    parser.add_argument('--cdbg-history-format',
+                        choices=['graphml', 'log'],
+                        default='graphml',
+                        help='Write history as GraphML, or as a compact binary '
+                             'log which convert-cdbg-history turns into GraphML.')
 
     parser.add_argument('--track-cdbg-components',
                         metavar='FILE_NAME.csv',
@@ -270,7 +286,8 @@ def print_cdbg_args(args):
               file=sys.stderr)
         print('* Saving tracking information to', args.track_cdbg_stats, file=sys.stderr)
     if args.track_cdbg_history:
-        print('* Tracking cDBG history and saving to', args.track_cdbg_history, file=sys.stderr)
+        print('* Tracking cDBG history and saving to', args.track_cdbg_history,
+              'as', args.cdbg_history_format, file=sys.stderr)
     if args.validate:
         print('* cDBG will be validated on completion and results saved to', args.validate,
               file=sys.stderr)
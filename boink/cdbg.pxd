@@ -11,7 +11,7 @@ from libcpp.memory cimport unique_ptr
 from libcpp.pair cimport pair
 from libcpp.set cimport set
 from libcpp.vector cimport vector
-from libc.stdint cimport uint8_t, uint32_t, uint64_t
+from libc.stdint cimport uint8_t, uint32_t, uint64_t, int64_t
 
 from boink.assembly cimport *
 from boink.hashing cimport *
@@ -48,9 +48,15 @@ cdef extern from "boink/cdbg/cdbg_types.hh" namespace "boink::cdbg":
 
     cdef const char * node_meta_repr(node_meta_t)
 
+    cdef cppclass _PackedSequence "boink::cdbg::PackedSequence":
+        size_t size()
+        size_t length()
+        string str()
+        string substr(size_t, size_t)
+
     cdef cppclass _CompactNode "boink::cdbg::CompactNode":
         const id_t node_id
-        string sequence
+        _PackedSequence sequence
 
         _CompactNode(id_t, string, node_meta_t)
         
@@ -74,6 +80,9 @@ cdef extern from "boink/cdbg/cdbg_types.hh" namespace "boink::cdbg":
         
         hash_t left_end()
         hash_t right_end()
+        uint64_t kmer_count()
+        uint64_t read_count()
+        double mean_coverage(uint16_t)
 
         string repr()
 
@@ -83,11 +92,21 @@ cdef extern from "boink/cdbg/cdbg_types.hh" namespace "boink::cdbg":
     ctypedef _DecisionNode * DecisionNodePtr
     ctypedef _UnitigNode * UnitigNodePtr
 
+cdef extern from "boink/cdbg/node_table.hh" namespace "boink::cdbg" nogil:
+    cdef cppclass _NodeTable "boink::cdbg::NodeTable" [NodeType]:
+        cppclass const_iterator:
+            pair[id_t, unique_ptr[NodeType]]& operator*()
+            const_iterator operator++()
+            bint operator==(const_iterator)
+            bint operator!=(const_iterator)
+
+        size_t size()
+
 cdef extern from "boink/cdbg/cdbg.hh" namespace "boink::cdbg" nogil:
 
     cdef cppclass _cDBG "boink::cdbg::cDBG" [GraphType] (_KmerClient, _EventNotifier):
-        ctypedef sparse_hash_map[hash_t,unique_ptr[_DecisionNode]].const_iterator dnode_iter_t
-        ctypedef sparse_hash_map[id_t,unique_ptr[_UnitigNode]].const_iterator unode_iter_t
+        ctypedef _NodeTable[_DecisionNode].const_iterator dnode_iter_t
+        ctypedef _NodeTable[_UnitigNode].const_iterator unode_iter_t
 
         _cDBG(uint16_t K)
 
@@ -97,6 +116,7 @@ cdef extern from "boink/cdbg/cdbg.hh" namespace "boink::cdbg" nogil:
         uint64_t n_unitig_nodes() const
         uint64_t n_decision_nodes() const
         uint64_t n_tags() const
+        uint64_t sample_window() const
         uint64_t n_unitig_ends() const
 
         unode_iter_t unodes_begin() const
@@ -114,13 +134,16 @@ cdef extern from "boink/cdbg/cdbg.hh" namespace "boink::cdbg" nogil:
         _UnitigNode * query_unode_tag(hash_t)
         _UnitigNode * query_unode_end(hash_t)
         _UnitigNode * query_unode_id(id_t)
+        pair[UnitigNodePtr, int64_t] query_unode_kmer(const string&) except +ValueError
         pair[DecisionNodePtr, DecisionNodePtr] find_unode_neighbors(_UnitigNode*)
 
         vector[CompactNodePtr] traverse_breadth_first(CompactNodePtr) except +ValueError
         sparse_hash_map[id_t, vector[id_t]] find_connected_components() except +ValueError
+        vector[size_t] component_sizes() except +ValueError
+        uint64_t n_components() except +ValueError
     
         void validate(const string&) except+ OSError
-        void write(const string&, cDBGFormat) except +OSError
+        void write(const string&, cDBGFormat, unsigned int) except +OSError
         void write_adj_matrix(const string&) except +OSError
         void write_graphml(const string&) except +OSError
 
@@ -27,7 +27,7 @@ cdef class CompactNodeView:
     @property
     def sequence(self):
         self._check_ptr()
-        return deref(self._cn_this).sequence
+        return deref(self._cn_this).sequence.str()
 
     def __len__(self):
         self._check_ptr()
@@ -127,7 +127,7 @@ cdef class DecisionNode(CompactNode):
     cdef DecisionNode _create(DecisionNodeView view):
         cdef DecisionNode node = DecisionNode()
         node.node_id = view.node_id
-        node.sequence = deref(view._cn_this).sequence
+        node.sequence = deref(view._cn_this).sequence.str()
         node.count = view.count
         return node
 
@@ -162,6 +162,20 @@ cdef class UnitigNodeView(CompactNodeView):
         self._check_ptr()
         return deref(self._un_this).right_end()
 
+    @property
+    def kmer_count(self):
+        self._check_ptr()
+        return deref(self._un_this).kmer_count()
+
+    @property
+    def read_count(self):
+        self._check_ptr()
+        return deref(self._un_this).read_count()
+
+    def mean_coverage(self, uint16_t K):
+        self._check_ptr()
+        return deref(self._un_this).mean_coverage(K)
+
     def tags(self):
         self._check_ptr()
         cdef hash_t tag
@@ -179,7 +193,7 @@ cdef class UnitigNode(CompactNode):
     cdef UnitigNode _create(UnitigNodeView view):
         cdef UnitigNode node = UnitigNode()
         node.node_id = view.node_id
-        node.sequence = deref(view._cn_this).sequence
+        node.sequence = deref(view._cn_this).sequence.str()
         node.left_end = view.left_end
         node.right_end = view.right_end
         node.meta = deref(view._un_this).meta()
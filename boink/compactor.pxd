@@ -48,7 +48,8 @@ cdef extern from "boink/cdbg/compactor.hh" namespace "boink::cdbg" nogil:
                             shared_ptr[_Registry],
                             uint64_t)
 
-        #string compactify(const string&) except +ValueError
+        string compactify(const string&) except +ValueError
+        vector[string] compactify_many(const vector[string]&, unsigned int)
         #void compactify_right(Path&) 
         #void compactify_left(Path&)
 
@@ -60,6 +61,11 @@ cdef extern from "boink/cdbg/compactor.hh" namespace "boink::cdbg" nogil:
                                  vector[NeighborBundle]&) except +ValueError
 
         void update_sequence(const string&) except +ValueError
+        uint64_t update_sequences(const vector[string]&, unsigned int) except +ValueError
+        uint64_t n_batch_conflicts()
+
+        void save(const string&) except +IOError
+        void load(const string&) except +IOError
 
         void find_new_segments(const string&, # sequence to add
                                deque[_compact_segment]&, # new segments
@@ -82,5 +88,34 @@ cdef extern from "boink/cdbg/solid_compactor.hh" namespace "boink::cdbg" nogil:
         void update_sequence(const string&)
         vector[pair[size_t, size_t]] find_solid_segments(const string&)
 
+cdef extern from "boink/cdbg/batch_compactor.hh" namespace "boink::cdbg" nogil:
+
+    cdef cppclass _BatchCompactor "boink::cdbg::BatchCompactor" [GraphType]:
+        shared_ptr[GraphType]        dbg
+        shared_ptr[_cDBG[GraphType]] cdbg
+
+        _BatchCompactor(shared_ptr[GraphType],
+                        shared_ptr[_Registry])
+
+        _BatchCompactor(shared_ptr[GraphType],
+                        shared_ptr[_Registry],
+                        uint64_t)
+
+        uint64_t compact(const vector[string]&, unsigned int) except +ValueError
+
+cdef extern from "boink/cdbg/cleaner.hh" namespace "boink::cdbg" nogil:
+
+    cdef cppclass _cDBGCleaner "boink::cdbg::cDBGCleaner" [GraphType] (_EventListener):
+        _cDBGCleaner(shared_ptr[_StreamingCompactor[GraphType]],
+                     size_t,
+                     double,
+                     size_t,
+                     double) except +ValueError
+
+        uint64_t clean()
+        uint64_t n_tips_clipped()
+        uint64_t n_bubbles_popped()
+        uint64_t n_dnodes_merged()
+
 
 include "compactor.tpl.pxd.pxi"
@@ -97,6 +97,8 @@ cdef extern from "boink/dbg.hh" namespace "boink" nogil:
 
         uint64_t n_unique()
         uint64_t n_occupied()
+        uint64_t n_saturated()
+        double estimated_fp()
 
         uint8_t ** get_raw()
 
@@ -149,6 +151,8 @@ cdef extern from "boink/pdbg.hh" namespace "boink" nogil:
 
         uint64_t n_unique()
         uint64_t n_occupied()
+        uint64_t n_saturated()
+        double estimated_fp()
         vector[size_t] get_partition_counts()
 
         void save(string)
@@ -83,6 +83,14 @@ cdef class PdBG(dBG):
     def n_occupied(self):
         return deref(self._this).n_occupied()
 
+    @property
+    def n_saturated(self):
+        return deref(self._this).n_saturated()
+
+    @property
+    def estimated_fp(self):
+        return deref(self._this).estimated_fp()
+
     @property
     def K(self):
         return deref(self._this).K()
@@ -8,6 +8,7 @@
 from libc.stdint cimport uint8_t, uint32_t, uint64_t
 from libcpp.memory cimport shared_ptr
 from libcpp.string cimport string
+from libcpp.vector cimport vector
 
 cdef extern from "boink/event_types.hh" namespace "boink::events" nogil:
 
@@ -15,6 +16,8 @@ cdef extern from "boink/event_types.hh" namespace "boink::events" nogil:
         MSG_EXIT_THREAD
         MSG_TIMER
 
+        MSG_TIME_INTERVAL
+
         MSG_WRITE_CDBG_STATS
         MSG_SAVE_CDBG
 
@@ -29,6 +32,10 @@ cdef extern from "boink/event_types.hh" namespace "boink::events" nogil:
         _Event(event_t)
         _Event(event_t, void *)
 
+    cdef cppclass _TimeIntervalEvent "boink::events::TimeIntervalEvent" (_Event):
+        _TimeIntervalEvent()
+        uint64_t t
+
 
 cdef extern from "boink/events.hh" namespace "boink::events" nogil:
     cdef cppclass _EventListener "boink::events::EventListener":
@@ -37,6 +44,15 @@ cdef extern from "boink/events.hh" namespace "boink::events" nogil:
         void exit_thread()
         void notify(shared_ptr[_Event])
         void wait_on_processing(uint64_t)
+        uint64_t queue_depth()
+        void clear_events()
+
+    cdef cppclass _EventRecorder "boink::events::EventRecorder" (_EventListener):
+        _EventRecorder() except +RuntimeError
+
+        void hold()
+        void release()
+        const vector[uint64_t]& handled()
 
     cdef cppclass _EventNotifier "boink::events::EventNotifier":
         _EventNotifier()
@@ -52,6 +68,10 @@ cdef class EventListener:
     cdef EventListener _wrap(shared_ptr[_EventListener])
 
 
+cdef class EventRecorder(EventListener):
+    cdef shared_ptr[_EventRecorder] _r_this
+
+
 cdef class EventNotifier:
     cdef shared_ptr[_EventNotifier] _notifier
     @staticmethod
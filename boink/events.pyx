@@ -6,6 +6,8 @@
 # of the MIT license.  See the LICENSE file for details.
 
 from cython.operator cimport dereference as deref
+from libc.stdint cimport uint64_t
+from libcpp.memory cimport make_shared
 
 cdef class EventListener:
 
@@ -24,6 +26,40 @@ cdef class EventListener:
     def wait_on_processing(self, int min_events=0):
         deref(self._listener).wait_on_processing(min_events)
 
+    @property
+    def queue_depth(self):
+        return deref(self._listener).queue_depth()
+
+    def clear_events(self):
+        deref(self._listener).clear_events()
+
+
+cdef class EventRecorder(EventListener):
+
+    def __cinit__(self, *args, **kwargs):
+        if type(self) is EventRecorder:
+            self._r_this = make_shared[_EventRecorder]()
+            self._listener = <shared_ptr[_EventListener]>self._r_this
+
+    def hold(self):
+        deref(self._r_this).hold()
+
+    def release(self):
+        deref(self._r_this).release()
+
+    def notify_intervals(self, uint64_t start, uint64_t n):
+        cdef shared_ptr[_TimeIntervalEvent] event
+        cdef uint64_t t
+        with nogil:
+            for t in range(start, start + n):
+                event = make_shared[_TimeIntervalEvent]()
+                deref(event).t = t
+                deref(self._listener).notify(<shared_ptr[_Event]>event)
+
+    @property
+    def handled(self):
+        return deref(self._r_this).handled()
+
 
 cdef class EventNotifier:
 
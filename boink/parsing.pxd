@@ -9,6 +9,7 @@ from libc.stdint cimport uint16_t, uint32_t, uint64_t, int64_t
 from libcpp cimport bool
 from libcpp.memory cimport unique_ptr, shared_ptr
 from libcpp.string cimport string
+from libcpp.vector cimport vector
 
 
 cdef extern from "boink/parsing/parsing.hh" namespace "boink::parsing" nogil:
@@ -29,6 +30,10 @@ cdef extern from "boink/parsing/parsing.hh" namespace "boink::parsing" nogil:
         _Sequence left
         _Sequence right
 
+cdef extern from "boink/parsing/readers.hh":
+    cdef size_t DEFAULT_FANOUT_CHUNK_SIZE
+    cdef size_t DEFAULT_FANOUT_CAPACITY
+
 cdef extern from "boink/parsing/readers.hh" namespace "boink::parsing" nogil:
 
     cdef cppclass _ReadParser "boink::parsing::ReadParser" [ParserType]:
@@ -55,6 +60,19 @@ cdef extern from "boink/parsing/readers.hh" namespace "boink::parsing" nogil:
         bool is_complete() except +ValueError
         _SequenceBundle next() except +ValueError
 
+    cdef cppclass _FanOutReader "boink::parsing::FanOutReader" [ParserType]:
+        _FanOutReader(const vector[string]&, size_t) except +ValueError
+        _FanOutReader(const vector[string]&, size_t, size_t, size_t) except +ValueError
+
+        cppclass Subscriber:
+            bool is_complete() except +ValueError
+            _Sequence get_next_read() except +ValueError
+            void close()
+
+        Subscriber& subscriber(size_t) except +IndexError
+        size_t n_subscribers() const
+        uint64_t n_published()
+
     shared_ptr[_ReadParser[_FastxReader]] get_parser[_FastxReader](const string&)
 
 
@@ -65,6 +83,11 @@ cdef class Sequence:
     cdef Sequence _wrap(_Sequence cseq)
 
 
+cdef class FanOutReader:
+
+    cdef unique_ptr[_FanOutReader[_FastxReader]] _this
+
+
 cdef class SplitPairedReader:
 
     cdef unique_ptr[_SplitPairedReader[_FastxReader]] _this
@@ -110,6 +110,50 @@ cdef class Sequence:
         return seq
 
 
+cdef class FanOutReader:
+
+    def __cinit__(self, object filenames,
+                        size_t n_subscribers,
+                        size_t chunk_size=DEFAULT_FANOUT_CHUNK_SIZE,
+                        size_t capacity=DEFAULT_FANOUT_CAPACITY):
+        if isinstance(filenames, str):
+            filenames = [filenames]
+        cdef vector[string] _filenames
+        for filename in filenames:
+            _filenames.push_back(_bstring(filename))
+        self._this = make_unique[_FanOutReader[_FastxReader]](_filenames,
+                                                              n_subscribers,
+                                                              chunk_size,
+                                                              capacity)
+
+    def reads(self, size_t subscriber_id):
+        cdef _FanOutReader[_FastxReader].Subscriber * subscriber = \
+            &deref(self._this).subscriber(subscriber_id)
+        cdef _Sequence read
+        cdef bool complete
+
+        while True:
+            # reading blocks on the producer and the other subscribers
+            with nogil:
+                complete = subscriber.is_complete()
+                if not complete:
+                    read = subscriber.get_next_read()
+            if complete:
+                break
+            yield Sequence._wrap(read)
+
+    def close(self, size_t subscriber_id):
+        deref(self._this).subscriber(subscriber_id).close()
+
+    @property
+    def n_subscribers(self):
+        return deref(self._this).n_subscribers()
+
+    @property
+    def n_published(self):
+        return deref(self._this).n_published()
+
+
 cdef class SplitPairedReader:
 
     def __init__(self, str left_filename, str right_filename,
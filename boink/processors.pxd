@@ -5,16 +5,18 @@
 # This software may be modified and distributed under the terms
 # of the MIT license.  See the LICENSE file for details.
 
-from libc.stdint cimport uint16_t, uint32_t, uint64_t, int64_t
+from libc.stdint cimport uint8_t, uint16_t, uint32_t, uint64_t, int64_t
 from libcpp cimport bool
 from libcpp.string cimport string
+from libcpp.vector cimport vector
 from libcpp.memory cimport shared_ptr
 
 from boink.dbg cimport *
 from boink.cdbg cimport *
 from boink.compactor cimport *
 from boink.events cimport EventNotifier, _EventNotifier, _EventListener
-from boink.parsing cimport _ReadParser, _FastxReader, _SplitPairedReader
+from boink.parsing cimport (_ReadParser, _FastxReader, _SplitPairedReader,
+                            _FanOutReader, FanOutReader)
 from boink.utils cimport _bstring
 from boink.minimizers cimport _UKHSCountSignature
 
@@ -41,7 +43,9 @@ cdef extern from "boink/processors.hh" namespace "boink" nogil:
 
         uint64_t process(...) except +ValueError
         uint64_t process(const string&) except +ValueError
+        uint64_t process_files "process"(const vector[string]&) except +ValueError
         uint64_t process_paired "process"(const string&, const string&) except +ValueError
+        uint64_t process_subscriber "process"(_FanOutReader[_FastxReader].Subscriber&) except +ValueError
         uint64_t process(const string&,
                          const string&,
                          uint32_t,
@@ -52,6 +56,16 @@ cdef extern from "boink/processors.hh" namespace "boink" nogil:
 
         uint64_t n_reads() const
 
+        void set_quality_filter(uint8_t, uint16_t, uint8_t) except +ValueError
+        void set_quality_filter(uint8_t, uint16_t) except +ValueError
+        void clear_quality_filter()
+        uint64_t n_reads_masked() const
+        uint64_t n_bases_masked() const
+        uint64_t n_kmers_filtered() const
+
+        void set_fp_warning_threshold(double)
+        double get_fp_warning_threshold() const
+
     cdef cppclass _FileConsumer "boink::FileConsumer" [GraphType] (_FileProcessor[_FileConsumer[GraphType]]):
         _FileConsumer(GraphType *,
                       uint64_t,
@@ -83,7 +97,9 @@ cdef extern from "boink/processors.hh" namespace "boink" nogil:
         _StreamingCompactorProcessor(shared_ptr[_StreamingCompactor[GraphType]],
                                      uint64_t,
                                      uint64_t,
-                                     uint64_t)
+                                     uint64_t,
+                                     unsigned int,
+                                     size_t)
 
     cdef cppclass _MinimizerProcessor "boink::MinimizerProcessor" [ShifterType] (_FileProcessor[_MinimizerProcessor[ShifterType]]):
         _MinimizerProcessor(int32_t,
@@ -93,6 +109,43 @@ cdef extern from "boink/processors.hh" namespace "boink" nogil:
                             uint64_t,
                             uint64_t)
 
+    ctypedef enum sequence_function_t "boink::sequence_function_t":
+        KMER_COVERAGE "boink::KMER_COVERAGE",
+        MEDIAN_COUNT "boink::MEDIAN_COUNT",
+        KMER_DEGREE "boink::KMER_DEGREE",
+        DEGREE_BIAS "boink::DEGREE_BIAS"
+
+    ctypedef enum function_scope_t "boink::function_scope_t":
+        PER_SEQUENCE "boink::PER_SEQUENCE",
+        PER_KMER "boink::PER_KMER"
+
+    ctypedef enum function_output_t "boink::function_output_t":
+        OUTPUT_TSV "boink::OUTPUT_TSV",
+        OUTPUT_BINARY "boink::OUTPUT_BINARY"
+
+    cdef cppclass _SequenceFunctionProcessor "boink::SequenceFunctionProcessor"[GraphType] (_FileProcessor[_SequenceFunctionProcessor[GraphType]]):
+        _SequenceFunctionProcessor(shared_ptr[GraphType],
+                                   sequence_function_t,
+                                   const string&,
+                                   function_output_t,
+                                   function_scope_t,
+                                   unsigned int,
+                                   size_t,
+                                   uint64_t,
+                                   uint64_t,
+                                   uint64_t)
+
+        void save_degree_bias(const string&) except +ValueError
+
+    cdef cppclass _AbundanceSummaryProcessor "boink::AbundanceSummaryProcessor"[GraphType] (_FileProcessor[_AbundanceSummaryProcessor[GraphType]]):
+        _AbundanceSummaryProcessor(shared_ptr[GraphType],
+                                   const string&,
+                                   unsigned int,
+                                   size_t,
+                                   uint64_t,
+                                   uint64_t,
+                                   uint64_t)
+
 cdef extern from "boink/normalization/diginorm.hh" namespace "boink::normalization" nogil:
     cdef cppclass _NormalizingCompactor "boink::normalization::NormalizingCompactor"[GraphType](_FileProcessor[_NormalizingCompactor[GraphType]]):
         _NormalizingCompactor(shared_ptr[_StreamingCompactor[GraphType]],
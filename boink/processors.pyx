@@ -8,6 +8,8 @@
 from cython.operator cimport dereference as deref
 from libcpp.memory cimport make_shared
 
+import threading
+
 from boink.dbg cimport *
 from boink.cdbg cimport *
 from boink.utils cimport _bstring, _ustring
@@ -30,6 +32,37 @@ cdef class FileProcessor:
 
 include "processors.tpl.pyx.pxi"
 
+
+def process_shared(object input_filenames, *processors):
+    # One parse of the inputs feeds every processor, each on its own
+    # thread; the slowest throttles the parser. Returns each processor's
+    # read count, or raises the first error once all have stopped.
+    if isinstance(input_filenames, str):
+        input_filenames = [input_filenames]
+    reader = FanOutReader(input_filenames, len(processors))
+    results = [None] * len(processors)
+    errors = [None] * len(processors)
+
+    def run(subscriber_id, processor):
+        try:
+            results[subscriber_id] = processor._process_subscriber(reader, subscriber_id)
+        except Exception as e:
+            errors[subscriber_id] = e
+            reader.close(subscriber_id)
+
+    threads = [threading.Thread(target=run, args=(i, processor))
+               for i, processor in enumerate(processors)]
+    for thread in threads:
+        thread.start()
+    for thread in threads:
+        thread.join()
+
+    for error in errors:
+        if error is not None:
+            raise error
+    return results
+
+
 cdef class MinimizerProcessor(FileProcessor):
 
     def __cinit__(self, int64_t window_size,
@@ -72,6 +105,12 @@ cdef class UKHSCountSignatureProcessor(FileProcessor):
             deref(self._this).process(_bstring(input_filename),
                                       _bstring(right_filename))
 
+    def _process_subscriber(self, FanOutReader reader, size_t subscriber_id):
+        cdef uint64_t n_reads
+        with nogil:
+            n_reads = deref(self._this).process_subscriber(deref(reader._this).subscriber(subscriber_id))
+        return n_reads
+
     def chunked_process(self, str input_filename, str right_filename=None):
         cdef shared_ptr[_ReadParser[_FastxReader]]       p_single
         cdef _SplitPairedReader[_FastxReader] *          p_paired
@@ -7,14 +7,42 @@
 
 from libcpp.memory cimport weak_ptr, shared_ptr
 from libcpp.string cimport string
+from libcpp.vector cimport vector
 
 cdef extern from "prometheus/collectable.h" namespace "prometheus" nogil:
     cdef cppclass _Collectable "prometheus::Collectable":
         pass
 
+cdef extern from "prometheus/client_metric.h" namespace "prometheus" nogil:
+    cdef struct _MetricLabel "prometheus::ClientMetric::Label":
+        string name
+        string value
+
+    cdef struct _CounterValue "prometheus::ClientMetric::Counter":
+        double value
+
+    cdef struct _GaugeValue "prometheus::ClientMetric::Gauge":
+        double value
+
+    cdef cppclass _ClientMetric "prometheus::ClientMetric":
+        vector[_MetricLabel] label
+        _CounterValue        counter
+        _GaugeValue          gauge
+
+cdef extern from "prometheus/metric_type.h" namespace "prometheus" nogil:
+    ctypedef enum _MetricType "prometheus::MetricType":
+        _COUNTER_METRIC "prometheus::MetricType::Counter"
+        _GAUGE_METRIC   "prometheus::MetricType::Gauge"
+
+cdef extern from "prometheus/metric_family.h" namespace "prometheus" nogil:
+    cdef cppclass _MetricFamily "prometheus::MetricFamily":
+        string                name
+        _MetricType           type
+        vector[_ClientMetric] metric
+
 cdef extern from "prometheus/registry.h" namespace "prometheus" nogil:
     cdef cppclass _Registry "prometheus::Registry" (_Collectable):
-        pass
+        vector[_MetricFamily] Collect()
 
 cdef extern from "prometheus/exposer.h" namespace "prometheus" nogil:
     cdef cppclass _Exposer "prometheus::Exposer":
@@ -39,3 +39,31 @@ cdef class Instrumentation:
 
             self.exposer  = make_shared[_Exposer](_address, _uri);
             deref(self.exposer).RegisterCollectable(<weak_ptr[_Collectable]>ref)
+
+    def collect(self):
+        '''Sample the registry's counters and gauges. Returns a dict from
+        metric name to a dict from labels, as a frozenset of (name, value)
+        pairs, to the current value.
+        '''
+
+        cdef vector[_MetricFamily] families = deref(self.registry).Collect()
+        cdef _MetricFamily family
+        cdef _ClientMetric metric
+        cdef _MetricLabel  label
+
+        samples = {}
+        for family in families:
+            if family.type == _COUNTER_METRIC:
+                is_counter = True
+            elif family.type == _GAUGE_METRIC:
+                is_counter = False
+            else:
+                continue
+            values = samples.setdefault(family.name, {})
+            for metric in family.metric:
+                labels = set()
+                for label in metric.label:
+                    labels.add((label.name, label.value))
+                values[frozenset(labels)] = metric.counter.value if is_counter \
+                                            else metric.gauge.value
+        return samples
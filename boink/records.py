@@ -0,0 +1,61 @@
+# boink/records.py
+# Copyright (C) 2018 Camille Scott
+# All rights reserved.
+#
+# This software may be modified and distributed under the terms
+# of the MIT license.  See the LICENSE file for details.
+
+import struct
+
+import numpy as np
+
+
+MAGIC = b'BKREC'
+VERSION = 1
+
+COLUMN_TYPES = {b'u': '<u8',
+                b'f': '<f8'}
+
+
+def read_header(fp):
+    '''Parse the header of a binary report written by a RecordWriter.
+
+    Returns the numpy dtype of one record; fp is left at the first record.
+    '''
+
+    magic = fp.read(len(MAGIC))
+    if magic != MAGIC:
+        raise ValueError('Not a boink record file (bad magic {0!r}).'.format(magic))
+    version, = struct.unpack('<B', fp.read(1))
+    if version != VERSION:
+        raise ValueError('Unsupported record version {0}.'.format(version))
+
+    n_columns, = struct.unpack('<I', fp.read(4))
+    fields = []
+    for _ in range(n_columns):
+        column_type = fp.read(1)
+        width, name_length = struct.unpack('<IH', fp.read(6))
+        name = fp.read(name_length).decode('ascii')
+        if column_type not in COLUMN_TYPES:
+            raise ValueError('Unknown type {0!r} for column {1}.'.format(column_type,
+                                                                         name))
+        if width == 1:
+            fields.append((name, COLUMN_TYPES[column_type]))
+        else:
+            fields.append((name, COLUMN_TYPES[column_type], (width,)))
+
+    return np.dtype(fields)
+
+
+def read_records(filename):
+    '''Load a binary report as a numpy structured array, one row per
+    record. A partial final record, left by a run that was cut off,
+    is dropped.
+    '''
+
+    with open(filename, 'rb') as fp:
+        dtype = read_header(fp)
+        data = fp.read()
+
+    n_records = len(data) // dtype.itemsize
+    return np.frombuffer(data, dtype=dtype, count=n_records)
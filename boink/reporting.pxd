@@ -16,6 +16,11 @@ from boink.minimizers cimport _UKHSCountSignature
 from boink.prometheus cimport _Registry
 
 
+cdef extern from "boink/reporting/report_types.hh" namespace "boink::reporting" nogil:
+    ctypedef enum ReportFormat:
+        CSV_REPORT,
+        BINARY_REPORT
+
 cdef extern from "boink/reporting/reporters.hh" namespace "boink::reporting" nogil:
     cdef cppclass _SingleFileReporter "boink::reporting::SingleFileReporter" (_EventListener):
         _SingleFileReporter(string&)
@@ -26,18 +31,27 @@ cdef extern from "boink/reporting/reporters.hh" namespace "boink::reporting" nog
 cdef extern from "boink/reporting/streaming_compactor_reporter.hh" namespace "boink::reporting" nogil:
     cdef cppclass _StreamingCompactorReporter "boink::reporting::StreamingCompactorReporter" [GraphType] (_SingleFileReporter):
         _StreamingCompactorReporter(shared_ptr[_StreamingCompactor[GraphType]], string&)
+        _StreamingCompactorReporter(shared_ptr[_StreamingCompactor[GraphType]], string&, ReportFormat)
 
 cdef extern from "boink/reporting/cdbg_writer_reporter.hh" namespace "boink::reporting" nogil:
     cdef cppclass _cDBGWriter "boink::reporting::cDBGWriter" [GraphType] (_MultiFileReporter):
-        _cDBGWriter(shared_ptr[_cDBG[GraphType]], cDBGFormat, const string&)
+        _cDBGWriter(shared_ptr[_cDBG[GraphType]], cDBGFormat, const string&, unsigned int)
 
 cdef extern from "boink/reporting/cdbg_history_reporter.hh" namespace "boink::reporting" nogil:
     cdef cppclass _cDBGHistoryReporter "boink::reporting::cDBGHistoryReporter" (_SingleFileReporter):
         _cDBGHistoryReporter(const string&)
 
+cdef extern from "boink/reporting/cdbg_history_log.hh" namespace "boink::reporting" nogil:
+    cdef cppclass _cDBGHistoryLogReporter "boink::reporting::cDBGHistoryLogReporter" (_SingleFileReporter):
+        _cDBGHistoryLogReporter(const string&)
+        uint64_t n_records()
+
+    uint64_t _history_log_to_graphml "boink::reporting::history_log_to_graphml" (const string&, const string&) except +
+
 cdef extern from "boink/reporting/ukhs_signature_reporter.hh" namespace "boink::reporting" nogil:
     cdef cppclass _UKHSSignatureReporter "boink::reporting::UKHSSignatureReporter" (_SingleFileReporter):
         _UKHSSignatureReporter(shared_ptr[_UKHSCountSignature], const string&)
+        _UKHSSignatureReporter(shared_ptr[_UKHSCountSignature], const string&, ReportFormat)
 
 cdef extern from "boink/reporting/cdbg_component_reporter.hh" namespace "boink::reporting" nogil:
     cdef cppclass _cDBGComponentReporter "boink::reporting::cDBGComponentReporter" [GraphType] (_SingleFileReporter):
@@ -46,8 +60,13 @@ cdef extern from "boink/reporting/cdbg_component_reporter.hh" namespace "boink::
                                shared_ptr[_Registry])
         _cDBGComponentReporter(shared_ptr[_cDBG[GraphType]],
                                const string&,
-                               shared_ptr[_Registry]
+                               shared_ptr[_Registry],
                                size_t)
+        _cDBGComponentReporter(shared_ptr[_cDBG[GraphType]],
+                               const string&,
+                               shared_ptr[_Registry],
+                               size_t,
+                               ReportFormat)
 
 cdef extern from "boink/reporting/cdbg_unitig_reporter.hh" namespace "boink::reporting" nogil:
     cdef cppclass _cDBGUnitigReporter "boink::reporting::cDBGUnitigReporter" [GraphType] (_SingleFileReporter):
@@ -55,6 +74,11 @@ cdef extern from "boink/reporting/cdbg_unitig_reporter.hh" namespace "boink::rep
                             const string&,
                             vector[size_t])
 
+cdef extern from "boink/reporting/run_metrics_reporter.hh" namespace "boink::reporting" nogil:
+    cdef cppclass _RunMetricsReporter "boink::reporting::RunMetricsReporter" [GraphType] (_EventListener):
+        _RunMetricsReporter(shared_ptr[GraphType], shared_ptr[_Registry])
+        void track_listener(shared_ptr[_EventListener])
+
 
 cdef class SingleFileReporter(EventListener):
     cdef readonly object          output_filename
@@ -70,6 +94,10 @@ cdef class cDBGHistoryReporter(SingleFileReporter):
     cdef shared_ptr[_cDBGHistoryReporter] _h_this
 
 
+cdef class cDBGHistoryLogReporter(SingleFileReporter):
+    cdef shared_ptr[_cDBGHistoryLogReporter] _hl_this
+
+
 cdef class UKHSSignatureReporter(SingleFileReporter):
     cdef shared_ptr[_UKHSSignatureReporter] _uk_this
 
@@ -16,6 +16,21 @@ from boink.events cimport _EventListener
 from boink.minimizers cimport UKHSCountSignature
 
 
+REPORT_FORMATS = ('csv', 'binary')
+
+
+cdef ReportFormat convert_report_format(str report_format) except *:
+    if report_format == 'csv':
+        return ReportFormat.CSV_REPORT
+    elif report_format == 'binary':
+        return ReportFormat.BINARY_REPORT
+    else:
+        formats = ', '.join(REPORT_FORMATS)
+        raise ValueError("{0} not a valid report format. "
+                         "Format must be one of: {1}".format(report_format,
+                                                             formats))
+
+
 cdef class SingleFileReporter(EventListener):
 
     def __cinit__(self, str output_filename,
@@ -44,13 +59,33 @@ cdef class cDBGHistoryReporter(SingleFileReporter):
             self._this = <shared_ptr[_SingleFileReporter]>self._h_this
             self._listener = <shared_ptr[_EventListener]>self._h_this
 
+
+cdef class cDBGHistoryLogReporter(SingleFileReporter):
+
+    def __cinit__(self, str output_filename, *args, **kwargs):
+        if type(self) is cDBGHistoryLogReporter:
+            self._hl_this = make_shared[_cDBGHistoryLogReporter](_bstring(output_filename))
+            self._this = <shared_ptr[_SingleFileReporter]>self._hl_this
+            self._listener = <shared_ptr[_EventListener]>self._hl_this
+
+    @property
+    def n_records(self):
+        return deref(self._hl_this).n_records()
+
+
+def history_log_to_graphml(str log_filename, str graphml_filename):
+    return _history_log_to_graphml(_bstring(log_filename),
+                                   _bstring(graphml_filename))
+
 cdef class UKHSSignatureReporter(SingleFileReporter):
 
 
-    def __cinit__(self, str output_filename, UKHSCountSignature signature):
+    def __cinit__(self, str output_filename, UKHSCountSignature signature,
+                        str report_format='csv'):
         if type(self) is UKHSSignatureReporter:
             self._uk_this = make_shared[_UKHSSignatureReporter](signature._this,
-                                                                _bstring(output_filename))
+                                                                _bstring(output_filename),
+                                                                convert_report_format(report_format))
             self._this = <shared_ptr[_SingleFileReporter]>self._uk_this
             self._listener = <shared_ptr[_EventListener]>self._uk_this
 
@@ -85,6 +85,14 @@ cdef class cDBG_{{type_bundle.suffix}}(cDBG_Base):
         else:
             return None
 
+    def query_unode_kmer(self, str kmer):
+        cdef pair[UnitigNodePtr, int64_t] result = \
+            deref(self._this).query_unode_kmer(_bstring(kmer))
+        if result.first != NULL:
+            return UnitigNodeView._wrap(result.first), result.second
+        else:
+            return None, -1
+
     def query_unode_end(self, hash_t h):
         cdef _UnitigNode * _node = \
             deref(self._this).query_unode_end(h)
@@ -192,6 +200,13 @@ cdef class cDBG_{{type_bundle.suffix}}(cDBG_Base):
 
         return result
 
+    def component_sizes(self):
+        return deref(self._this).component_sizes()
+
+    @property
+    def n_components(self):
+        return deref(self._this).n_components()
+
     def query_dnodes(self, str sequence):
         pass
 
@@ -218,12 +233,13 @@ cdef class cDBG_{{type_bundle.suffix}}(cDBG_Base):
     def validate(self, str filename):
         deref(self._this).validate(_bstring(filename))
 
-    def save(self, str filename, str file_format):
+    def save(self, str filename, str file_format, unsigned int n_threads=1):
         if file_format is None:
             return
         else:
             deref(self._this).write(_bstring(filename),
-                                    convert_format(file_format))
+                                    convert_format(file_format),
+                                    n_threads)
 
 {% endfor %}
 
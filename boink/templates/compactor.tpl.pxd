@@ -26,6 +26,15 @@ cdef class SolidStreamingCompactor:
     cdef StreamingCompactor compactor
     cdef dBG                abund_filter
 
+cdef class BatchCompactor:
+    cdef readonly object storage_type
+    cdef readonly object shifter_type
+    cdef object graph
+
+cdef class cDBGCleaner(EventListener):
+    cdef readonly object storage_type
+    cdef readonly object shifter_type
+
 {% for type_bundle in type_bundles %}
 cdef class StreamingCompactor_{{type_bundle.suffix}}(StreamingCompactor):
     cdef shared_ptr[_StreamingCompactor[_dBG[{{type_bundle.params}}]]] _this
@@ -37,6 +46,15 @@ cdef class StreamingCompactor_{{type_bundle.suffix}}(StreamingCompactor):
 cdef class SolidStreamingCompactor_{{type_bundle.suffix}}(SolidStreamingCompactor):
     cdef shared_ptr[_SolidStreamingCompactor[_dBG[{{type_bundle.params}}]]] _this
     cdef public EventNotifier Notifier
+
+cdef class BatchCompactor_{{type_bundle.suffix}}(BatchCompactor):
+    cdef shared_ptr[_BatchCompactor[_dBG[{{type_bundle.params}}]]] _this
+    cdef public cDBG_{{type_bundle.suffix}} cdbg
+    cdef Instrumentation instrumentation
+
+cdef class cDBGCleaner_{{type_bundle.suffix}}(cDBGCleaner):
+    cdef shared_ptr[_cDBGCleaner[_dBG[{{type_bundle.params}}]]] _this
+    cdef StreamingCompactor compactor
 {% endfor %}
 
 
@@ -14,6 +14,7 @@ from libc.stdint cimport uint64_t
 from libcpp cimport bool, nullptr_t, nullptr
 from libcpp.memory cimport make_shared
 from libcpp.string cimport string
+from libcpp.vector cimport vector
 
 from boink.prometheus cimport Instrumentation
 from boink.utils cimport *
@@ -51,6 +52,40 @@ cdef class SolidStreamingCompactor:
         raise TypeError("Invalid dBG/StreamingCompactor type.")
 
 
+cdef class BatchCompactor:
+
+    @staticmethod
+    def build(dBG graph, Instrumentation instrumentation=None):
+        {% for type_bundle in type_bundles %}
+        if graph.storage_type == "{{type_bundle.storage_type}}" and \
+           graph.shifter_type == "{{type_bundle.shifter_type}}":
+            return BatchCompactor_{{type_bundle.suffix}}(graph, instrumentation)
+        {% endfor %}
+
+        raise TypeError("Invalid dBG type.")
+
+
+cdef class cDBGCleaner(EventListener):
+
+    @staticmethod
+    def build(StreamingCompactor compactor,
+              size_t max_tip_length=0,
+              double min_tip_coverage=2.0,
+              size_t max_bubble_length=0,
+              double bubble_coverage_ratio=0.25):
+        {% for type_bundle in type_bundles %}
+        if compactor.storage_type == "{{type_bundle.storage_type}}" and \
+           compactor.shifter_type == "{{type_bundle.shifter_type}}":
+            return cDBGCleaner_{{type_bundle.suffix}}(compactor,
+                                                      max_tip_length,
+                                                      min_tip_coverage,
+                                                      max_bubble_length,
+                                                      bubble_coverage_ratio)
+        {% endfor %}
+
+        raise TypeError("Invalid dBG/StreamingCompactor type.")
+
+
 {% for type_bundle in type_bundles %}
 cdef class StreamingCompactor_{{type_bundle.suffix}}(StreamingCompactor):
 
@@ -99,6 +134,32 @@ cdef class StreamingCompactor_{{type_bundle.suffix}}(StreamingCompactor):
         cdef string _sequence = _bstring(sequence)
         deref(self._this).update_sequence(_sequence)
 
+    def update_sequences(self, list sequences, unsigned int n_threads=1):
+        cdef vector[string] _sequences
+        for sequence in sequences:
+            _sequences.push_back(_bstring(sequence))
+        return deref(self._this).update_sequences(_sequences, n_threads)
+
+    @property
+    def n_batch_conflicts(self):
+        return deref(self._this).n_batch_conflicts()
+
+    def compactify(self, str seed):
+        return _ustring(deref(self._this).compactify(_bstring(seed)))
+
+    def compactify_many(self, list seeds, unsigned int n_threads=1):
+        cdef vector[string] _seeds
+        for seed in seeds:
+            _seeds.push_back(_bstring(seed))
+        cdef vector[string] _unitigs = deref(self._this).compactify_many(_seeds, n_threads)
+        return [_ustring(unitig) for unitig in _unitigs]
+
+    def save(self, str prefix):
+        deref(self._this).save(_bstring(prefix))
+
+    def load(self, str prefix):
+        deref(self._this).load(_bstring(prefix))
+
     def find_new_segments(self, str sequence):
         cdef string _sequence = _bstring(sequence)
 
@@ -162,6 +223,67 @@ cdef class SolidStreamingCompactor_{{type_bundle.suffix}}(SolidStreamingCompacto
         return segments
 
 
+cdef class BatchCompactor_{{type_bundle.suffix}}(BatchCompactor):
+
+    def __cinit__(self, dBG_{{type_bundle.suffix}} graph, Instrumentation inst=None):
+
+        self.storage_type = graph.storage_type
+        self.shifter_type = graph.shifter_type
+
+        if inst is None:
+            self.instrumentation = Instrumentation('', expose=False)
+        else:
+            self.instrumentation = inst
+
+        if type(self) is BatchCompactor_{{type_bundle.suffix}}:
+            self._this = make_shared[_BatchCompactor[_dBG[{{type_bundle.params}}]]](graph._this,
+                                                                                    self.instrumentation.registry)
+            self.graph = graph # for reference counting
+            self.cdbg = cDBG_{{type_bundle.suffix}}._wrap(deref(self._this).cdbg)
+
+    def compact(self, list sequences, unsigned int n_threads=1):
+        cdef vector[string] _sequences
+        for sequence in sequences:
+            _sequences.push_back(_bstring(sequence))
+        return deref(self._this).compact(_sequences, n_threads)
+
+
+cdef class cDBGCleaner_{{type_bundle.suffix}}(cDBGCleaner):
+
+    def __cinit__(self, StreamingCompactor_{{type_bundle.suffix}} compactor,
+                        size_t max_tip_length=0,
+                        double min_tip_coverage=2.0,
+                        size_t max_bubble_length=0,
+                        double bubble_coverage_ratio=0.25):
+
+        self.storage_type = compactor.storage_type
+        self.shifter_type = compactor.shifter_type
+
+        if type(self) is cDBGCleaner_{{type_bundle.suffix}}:
+            self._this = make_shared[_cDBGCleaner[_dBG[{{type_bundle.params}}]]](compactor._this,
+                                                                                 max_tip_length,
+                                                                                 min_tip_coverage,
+                                                                                 max_bubble_length,
+                                                                                 bubble_coverage_ratio)
+            self._listener = <shared_ptr[_EventListener]>self._this
+            self.compactor = compactor # for reference counting
+
+    def clean(self):
+        return deref(self._this).clean()
+
+    @property
+    def n_tips_clipped(self):
+        return deref(self._this).n_tips_clipped()
+
+    @property
+    def n_bubbles_popped(self):
+        return deref(self._this).n_bubbles_popped()
+
+    @property
+    def n_dnodes_merged(self):
+        return deref(self._this).n_dnodes_merged()
+
+
 
 {% endfor %}
 
@@ -162,6 +162,14 @@ cdef class dBG_{{type_bundle.suffix}}(dBG):
     def n_occupied(self):
         return deref(self._this).n_occupied()
 
+    @property
+    def n_saturated(self):
+        return deref(self._this).n_saturated()
+
+    @property
+    def estimated_fp(self):
+        return deref(self._this).estimated_fp()
+
     @property
     def K(self):
         return deref(self._this).K()
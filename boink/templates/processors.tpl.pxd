@@ -41,6 +41,19 @@ cdef class NormalizingCompactor(FileProcessor):
     cdef readonly object shifter_type
 
 
+cdef class SequenceFunctionProcessor(FileProcessor):
+    cdef readonly object storage_type
+    cdef readonly object shifter_type
+    cdef readonly str function
+    cdef readonly str output_filename
+
+
+cdef class AbundanceSummaryProcessor(FileProcessor):
+    cdef readonly object storage_type
+    cdef readonly object shifter_type
+    cdef readonly str output_filename
+
+
 {% for type_bundle in type_bundles %}
 
 cdef class FileConsumer_{{type_bundle.suffix}}(FileConsumer):
@@ -62,6 +75,14 @@ cdef class NormalizingCompactor_{{type_bundle.suffix}}(NormalizingCompactor):
     cdef shared_ptr[_NormalizingCompactor[_dBG[{{type_bundle.params}}]]] _this
 
 
+cdef class SequenceFunctionProcessor_{{type_bundle.suffix}}(SequenceFunctionProcessor):
+    cdef shared_ptr[_SequenceFunctionProcessor[_dBG[{{type_bundle.params}}]]] _this
+
+
+cdef class AbundanceSummaryProcessor_{{type_bundle.suffix}}(AbundanceSummaryProcessor):
+    cdef shared_ptr[_AbundanceSummaryProcessor[_dBG[{{type_bundle.params}}]]] _this
+
+
 {% endfor %}
 
 cdef class FileConsumer_PdBG(FileConsumer):
@@ -10,15 +10,24 @@
 
 from cython.operator cimport dereference as deref
 
-from libc.stdint cimport uint64_t
+from libc.stdint cimport uint8_t, uint16_t, uint64_t
+from libcpp cimport bool
 from libcpp.memory cimport make_shared
 from libcpp.string cimport string
+from libcpp.vector cimport vector
 
 from boink.dbg cimport *
 from boink.utils cimport *
 from boink.processors cimport *
 
 
+cdef vector[string] _bstring_vector(object filenames):
+    cdef vector[string] _filenames
+    for filename in filenames:
+        _filenames.push_back(_bstring(filename))
+    return _filenames
+
+
 cdef class FileConsumer(FileProcessor):
 
     @staticmethod
@@ -72,7 +81,9 @@ cdef class StreamingCompactorProcessor(FileProcessor):
     def build(StreamingCompactor compactor, 
               uint64_t fine_interval,
               uint64_t medium_interval,
-              uint64_t coarse_interval):
+              uint64_t coarse_interval,
+              unsigned int n_threads=1,
+              size_t batch_size=1000):
 
         {% for type_bundle in type_bundles %}
         if compactor.storage_type == "{{type_bundle.storage_type}}" and \
@@ -80,7 +91,9 @@ cdef class StreamingCompactorProcessor(FileProcessor):
             return StreamingCompactorProcessor_{{type_bundle.suffix}}(compactor,
                                                                       fine_interval,
                                                                       medium_interval,
-                                                                      coarse_interval)
+                                                                      coarse_interval,
+                                                                      n_threads,
+                                                                      batch_size)
         {% endfor %}
 
         raise TypeError("Invalid dBG type.")
@@ -108,6 +121,75 @@ cdef class NormalizingCompactor(FileProcessor):
         raise TypeError("Invalid dBG type.")
 
 
+SEQUENCE_FUNCTIONS = {'KmerCoverage': KMER_COVERAGE,
+                      'MedianCount':  MEDIAN_COUNT,
+                      'KmerDegree':   KMER_DEGREE,
+                      'DegreeBias':   DEGREE_BIAS}
+
+
+cdef class SequenceFunctionProcessor(FileProcessor):
+
+    @staticmethod
+    def build(dBG graph,
+              str function,
+              str output_filename,
+              bool binary=False,
+              bool per_kmer=False,
+              unsigned int n_threads=1,
+              size_t batch_size=10000,
+              uint64_t fine_interval=DEFAULT_FINE_INTERVAL,
+              uint64_t medium_interval=DEFAULT_MEDIUM_INTERVAL,
+              uint64_t coarse_interval=DEFAULT_COARSE_INTERVAL):
+
+        if function not in SEQUENCE_FUNCTIONS:
+            raise ValueError('Unknown function {0}; choose from {1}.'.format(function,
+                             ', '.join(SEQUENCE_FUNCTIONS)))
+        if per_kmer and function == 'MedianCount':
+            raise ValueError('MedianCount is only defined per sequence.')
+
+        {% for type_bundle in type_bundles %}
+        if graph.storage_type == "{{type_bundle.storage_type}}" and \
+           graph.shifter_type == "{{type_bundle.shifter_type}}":
+            return SequenceFunctionProcessor_{{type_bundle.suffix}}(graph,
+                                                                    function,
+                                                                    output_filename,
+                                                                    binary,
+                                                                    per_kmer,
+                                                                    n_threads,
+                                                                    batch_size,
+                                                                    fine_interval,
+                                                                    medium_interval,
+                                                                    coarse_interval)
+        {% endfor %}
+
+        raise TypeError("Invalid dBG type.")
+
+
+cdef class AbundanceSummaryProcessor(FileProcessor):
+
+    @staticmethod
+    def build(dBG graph,
+              str output_filename,
+              unsigned int n_threads=1,
+              size_t batch_size=10000,
+              uint64_t fine_interval=DEFAULT_FINE_INTERVAL,
+              uint64_t medium_interval=DEFAULT_MEDIUM_INTERVAL,
+              uint64_t coarse_interval=DEFAULT_COARSE_INTERVAL):
+
+        {% for type_bundle in type_bundles %}
+        if graph.storage_type == "{{type_bundle.storage_type}}" and \
+           graph.shifter_type == "{{type_bundle.shifter_type}}":
+            return AbundanceSummaryProcessor_{{type_bundle.suffix}}(graph,
+                                                                    output_filename,
+                                                                    n_threads,
+                                                                    batch_size,
+                                                                    fine_interval,
+                                                                    medium_interval,
+                                                                    coarse_interval)
+        {% endfor %}
+
+        raise TypeError("Invalid dBG type.")
+
 {% for type_bundle in type_bundles %}
 
 cdef class FileConsumer_{{type_bundle.suffix}}(FileConsumer):
@@ -124,12 +206,48 @@ cdef class FileConsumer_{{type_bundle.suffix}}(FileConsumer):
         self.storage_type = graph.storage_type
         self.shifter_type = graph.shifter_type
 
-    def process(self, str input_filename):
-        deref(self._this).process(_bstring(input_filename))
+    def process(self, object input_filename):
+        if isinstance(input_filename, str):
+            deref(self._this).process(_bstring(input_filename))
+        else:
+            deref(self._this).process_files(_bstring_vector(input_filename))
 
         return (deref(self._this).n_reads(),
                 deref(self._this).n_consumed())
 
+    def _process_subscriber(self, FanOutReader reader, size_t subscriber_id):
+        cdef uint64_t n_reads
+        with nogil:
+            n_reads = deref(self._this).process_subscriber(deref(reader._this).subscriber(subscriber_id))
+        return n_reads
+
+    def set_quality_filter(self, uint8_t min_quality,
+                                 uint16_t min_length,
+                                 uint8_t phred_offset=33):
+        deref(self._this).set_quality_filter(min_quality,
+                                             min_length,
+                                             phred_offset)
+
+    @property
+    def n_reads_masked(self):
+        return deref(self._this).n_reads_masked()
+
+    @property
+    def n_bases_masked(self):
+        return deref(self._this).n_bases_masked()
+
+    @property
+    def n_kmers_filtered(self):
+        return deref(self._this).n_kmers_filtered()
+
+    @property
+    def fp_warning_threshold(self):
+        return deref(self._this).get_fp_warning_threshold()
+
+    @fp_warning_threshold.setter
+    def fp_warning_threshold(self, double threshold):
+        deref(self._this).set_fp_warning_threshold(threshold)
+
 
 cdef class DecisionNodeProcessor_{{type_bundle.suffix}}(DecisionNodeProcessor):
     
@@ -160,26 +278,66 @@ cdef class StreamingCompactorProcessor_{{type_bundle.suffix}}(StreamingCompactor
     def __cinit__(self, StreamingCompactor_{{type_bundle.suffix}} compactor,
                         uint64_t fine_interval,
                         uint64_t medium_interval,
-                        uint64_t coarse_interval):
+                        uint64_t coarse_interval,
+                        unsigned int n_threads=1,
+                        size_t batch_size=1000):
 
         self._this = make_shared[_StreamingCompactorProcessor[_dBG[{{type_bundle.params}}]]](compactor._this,
                                                                                              fine_interval,
                                                                                              medium_interval,
-                                                                                             coarse_interval)
+                                                                                             coarse_interval,
+                                                                                             n_threads,
+                                                                                             batch_size)
         self.Notifier = EventNotifier._wrap(<shared_ptr[_EventNotifier]>self._this)
 
         self.storage_type = compactor.storage_type
         self.shifter_type = compactor.shifter_type
 
-    def process(self, str input_filename, str right_filename=None):
+    def process(self, object input_filename, str right_filename=None):
         if right_filename is None:
-            deref(self._this).process(_bstring(input_filename))
+            if isinstance(input_filename, str):
+                deref(self._this).process(_bstring(input_filename))
+            else:
+                deref(self._this).process_files(_bstring_vector(input_filename))
         else:
             deref(self._this).process(_bstring(input_filename),
                                       _bstring(right_filename))
 
         return deref(self._this).n_reads()
 
+    def _process_subscriber(self, FanOutReader reader, size_t subscriber_id):
+        cdef uint64_t n_reads
+        with nogil:
+            n_reads = deref(self._this).process_subscriber(deref(reader._this).subscriber(subscriber_id))
+        return n_reads
+
+    def set_quality_filter(self, uint8_t min_quality,
+                                 uint16_t min_length,
+                                 uint8_t phred_offset=33):
+        deref(self._this).set_quality_filter(min_quality,
+                                             min_length,
+                                             phred_offset)
+
+    @property
+    def n_reads_masked(self):
+        return deref(self._this).n_reads_masked()
+
+    @property
+    def n_bases_masked(self):
+        return deref(self._this).n_bases_masked()
+
+    @property
+    def n_kmers_filtered(self):
+        return deref(self._this).n_kmers_filtered()
+
+    @property
+    def fp_warning_threshold(self):
+        return deref(self._this).get_fp_warning_threshold()
+
+    @fp_warning_threshold.setter
+    def fp_warning_threshold(self, double threshold):
+        deref(self._this).set_fp_warning_threshold(threshold)
+
 
 cdef class NormalizingCompactor_{{type_bundle.suffix}}(NormalizingCompactor):
     
@@ -199,15 +357,110 @@ cdef class NormalizingCompactor_{{type_bundle.suffix}}(NormalizingCompactor):
         self.storage_type = compactor.storage_type
         self.shifter_type = compactor.shifter_type
 
-    def process(self, str input_filename, str right_filename=None):
+    def process(self, object input_filename, str right_filename=None):
         if right_filename is None:
-            deref(self._this).process(_bstring(input_filename))
+            if isinstance(input_filename, str):
+                deref(self._this).process(_bstring(input_filename))
+            else:
+                deref(self._this).process_files(_bstring_vector(input_filename))
         else:
             deref(self._this).process(_bstring(input_filename),
                                       _bstring(right_filename))
 
         return deref(self._this).n_reads()
 
+    def _process_subscriber(self, FanOutReader reader, size_t subscriber_id):
+        cdef uint64_t n_reads
+        with nogil:
+            n_reads = deref(self._this).process_subscriber(deref(reader._this).subscriber(subscriber_id))
+        return n_reads
+
+    @property
+    def fp_warning_threshold(self):
+        return deref(self._this).get_fp_warning_threshold()
+
+    @fp_warning_threshold.setter
+    def fp_warning_threshold(self, double threshold):
+        deref(self._this).set_fp_warning_threshold(threshold)
+
+
+cdef class SequenceFunctionProcessor_{{type_bundle.suffix}}(SequenceFunctionProcessor):
+
+    def __cinit__(self, dBG_{{type_bundle.suffix}} graph,
+                        str function,
+                        str output_filename,
+                        bool binary,
+                        bool per_kmer,
+                        unsigned int n_threads,
+                        size_t batch_size,
+                        uint64_t fine_interval,
+                        uint64_t medium_interval,
+                        uint64_t coarse_interval):
+
+        self.function = function
+        self.output_filename = output_filename
+        cdef string _output_filename = _bstring(output_filename)
+        cdef function_output_t output_format = OUTPUT_BINARY if binary else OUTPUT_TSV
+        cdef function_scope_t scope = PER_KMER if per_kmer else PER_SEQUENCE
+        self._this = make_shared[_SequenceFunctionProcessor[_dBG[{{type_bundle.params}}]]](graph._this,
+                                                                                           <sequence_function_t>SEQUENCE_FUNCTIONS[function],
+                                                                                           _output_filename,
+                                                                                           output_format,
+                                                                                           scope,
+                                                                                           n_threads,
+                                                                                           batch_size,
+                                                                                           fine_interval,
+                                                                                           medium_interval,
+                                                                                           coarse_interval)
+        self.Notifier = EventNotifier._wrap(<shared_ptr[_EventNotifier]>self._this)
+
+        self.storage_type = graph.storage_type
+        self.shifter_type = graph.shifter_type
+
+    def process(self, object input_filename):
+        if isinstance(input_filename, str):
+            deref(self._this).process(_bstring(input_filename))
+        else:
+            deref(self._this).process_files(_bstring_vector(input_filename))
+
+        return deref(self._this).n_reads()
+
+    def save_degree_bias(self, str filename):
+        deref(self._this).save_degree_bias(_bstring(filename))
+
+
+cdef class AbundanceSummaryProcessor_{{type_bundle.suffix}}(AbundanceSummaryProcessor):
+
+    def __cinit__(self, dBG_{{type_bundle.suffix}} graph,
+                        str output_filename,
+                        unsigned int n_threads,
+                        size_t batch_size,
+                        uint64_t fine_interval,
+                        uint64_t medium_interval,
+                        uint64_t coarse_interval):
+
+        self.output_filename = output_filename
+        cdef string _output_filename = _bstring(output_filename)
+        self._this = make_shared[_AbundanceSummaryProcessor[_dBG[{{type_bundle.params}}]]](graph._this,
+                                                                                           _output_filename,
+                                                                                           n_threads,
+                                                                                           batch_size,
+                                                                                           fine_interval,
+                                                                                           medium_interval,
+                                                                                           coarse_interval)
+        self.Notifier = EventNotifier._wrap(<shared_ptr[_EventNotifier]>self._this)
+
+        self.storage_type = graph.storage_type
+        self.shifter_type = graph.shifter_type
+
+    def process(self, object input_filename):
+        if isinstance(input_filename, str):
+            deref(self._this).process(_bstring(input_filename))
+        else:
+            deref(self._this).process_files(_bstring_vector(input_filename))
+
+        return deref(self._this).n_reads()
+
 {% endfor %}
 
 cdef class FileConsumer_PdBG(FileConsumer):
@@ -223,10 +476,40 @@ cdef class FileConsumer_PdBG(FileConsumer):
                                                              coarse_interval)
         self.storage_type = graph.storage_type
 
-    def process(self, str input_filename):
-        deref(self._this).process(_bstring(input_filename))
+    def process(self, object input_filename):
+        if isinstance(input_filename, str):
+            deref(self._this).process(_bstring(input_filename))
+        else:
+            deref(self._this).process_files(_bstring_vector(input_filename))
 
         return (deref(self._this).n_reads(),
                 deref(self._this).n_consumed())
 
+    def set_quality_filter(self, uint8_t min_quality,
+                                 uint16_t min_length,
+                                 uint8_t phred_offset=33):
+        deref(self._this).set_quality_filter(min_quality,
+                                             min_length,
+                                             phred_offset)
+
+    @property
+    def n_reads_masked(self):
+        return deref(self._this).n_reads_masked()
+
+    @property
+    def n_bases_masked(self):
+        return deref(self._this).n_bases_masked()
+
+    @property
+    def n_kmers_filtered(self):
+        return deref(self._this).n_kmers_filtered()
+
+    @property
+    def fp_warning_threshold(self):
+        return deref(self._this).get_fp_warning_threshold()
+
+    @fp_warning_threshold.setter
+    def fp_warning_threshold(self, double threshold):
+        deref(self._this).set_fp_warning_threshold(threshold)
+
 {% endblock code %}
@@ -40,6 +40,11 @@ cdef class cDBGUnitigReporter(SingleFileReporter):
     cdef readonly object shifter_type
 
 
+cdef class RunMetricsReporter(EventListener):
+    cdef readonly object storage_type
+    cdef readonly object shifter_type
+
+
 {% for type_bundle in type_bundles %}
 cdef class StreamingCompactorReporter_{{type_bundle.suffix}}(StreamingCompactorReporter):
     cdef shared_ptr[_StreamingCompactorReporter[_dBG[{{type_bundle.params}}]]] _s_this
@@ -53,6 +58,9 @@ cdef class cDBGComponentReporter_{{type_bundle.suffix}}(cDBGComponentReporter):
 cdef class cDBGUnitigReporter_{{type_bundle.suffix}}(cDBGUnitigReporter):
     cdef shared_ptr[_cDBGUnitigReporter[_dBG[{{type_bundle.params}}]]] _s_this
 
+cdef class RunMetricsReporter_{{type_bundle.suffix}}(RunMetricsReporter):
+    cdef shared_ptr[_RunMetricsReporter[_dBG[{{type_bundle.params}}]]] _s_this
+
 
 {% endfor %}
 
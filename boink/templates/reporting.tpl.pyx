@@ -25,11 +25,13 @@ from boink.events cimport _EventListener
 cdef class StreamingCompactorReporter(SingleFileReporter):
 
     @staticmethod
-    def build(str output_filename, StreamingCompactor compactor):
+    def build(str output_filename, StreamingCompactor compactor,
+              str report_format='csv'):
         {% for type_bundle in type_bundles %}
         if compactor.storage_type == "{{type_bundle.storage_type}}" and \
            compactor.shifter_type == "{{type_bundle.shifter_type}}":
-            return StreamingCompactorReporter_{{type_bundle.suffix}}(output_filename, compactor)
+            return StreamingCompactorReporter_{{type_bundle.suffix}}(output_filename, compactor,
+                                                                     report_format)
         {% endfor %}
 
         raise TypeError("Invalid dBG type.")
@@ -40,11 +42,13 @@ cdef class cDBGWriter(MultiFileReporter):
     @staticmethod
     def build(str output_prefix,
               str graph_format,
-              cDBG_Base cdbg):
+              cDBG_Base cdbg,
+              unsigned int n_threads=1):
         {% for type_bundle in type_bundles %}
         if cdbg.storage_type == "{{type_bundle.storage_type}}" and \
            cdbg.shifter_type == "{{type_bundle.shifter_type}}":
-            return cDBGWriter_{{type_bundle.suffix}}(output_prefix, graph_format, cdbg)
+            return cDBGWriter_{{type_bundle.suffix}}(output_prefix, graph_format, cdbg,
+                                                     n_threads)
         {% endfor %}
 
         raise TypeError("Invalid dBG type.")
@@ -53,14 +57,16 @@ cdef class cDBGWriter(MultiFileReporter):
 cdef class cDBGComponentReporter(SingleFileReporter):
 
     @staticmethod
-    def build(str output_filename, cDBG_Base cdbg, int sample_size, Instrumentation inst):
+    def build(str output_filename, cDBG_Base cdbg, int sample_size, Instrumentation inst,
+              str report_format='csv'):
         {% for type_bundle in type_bundles %}
         if cdbg.storage_type == "{{type_bundle.storage_type}}" and \
            cdbg.shifter_type == "{{type_bundle.shifter_type}}":
             return cDBGComponentReporter_{{type_bundle.suffix}}(output_filename,
                                                                 cdbg,
                                                                 sample_size,
-                                                                inst);
+                                                                inst,
+                                                                report_format);
         {% endfor %}
     
         raise TypeError("Could not match cDBG template type.")
@@ -81,15 +87,29 @@ cdef class cDBGUnitigReporter(SingleFileReporter):
         raise TypeError("Could not match cDBG template type.")
 
 
+cdef class RunMetricsReporter(EventListener):
+
+    @staticmethod
+    def build(dBG graph, Instrumentation inst):
+        {% for type_bundle in type_bundles %}
+        if graph.storage_type == "{{type_bundle.storage_type}}" and \
+           graph.shifter_type == "{{type_bundle.shifter_type}}":
+            return RunMetricsReporter_{{type_bundle.suffix}}(graph, inst)
+        {% endfor %}
+
+        raise TypeError("Invalid dBG type.")
+
+
 {% for type_bundle in type_bundles %}
 
 cdef class StreamingCompactorReporter_{{type_bundle.suffix}}(StreamingCompactorReporter):
     
     def __cinit__(self, str output_filename, StreamingCompactor_{{type_bundle.suffix}} compactor,
-                        *args, **kwargs):
+                        str report_format='csv', *args, **kwargs):
         if type(self) is StreamingCompactorReporter_{{type_bundle.suffix}}:
             self._s_this = make_shared[_StreamingCompactorReporter[_dBG[{{type_bundle.params}}]]](\
-                    compactor._this, _bstring(output_filename))
+                    compactor._this, _bstring(output_filename),
+                    convert_report_format(report_format))
             self._this = <shared_ptr[_SingleFileReporter]>self._s_this
             self._listener = <shared_ptr[_EventListener]>self._s_this
 
@@ -102,6 +122,7 @@ cdef class cDBGWriter_{{type_bundle.suffix}}(cDBGWriter):
     def __cinit__(self, str output_prefix,
                         str graph_format,
                         cDBG_{{type_bundle.suffix}} cdbg,
+                        unsigned int n_threads=1,
                         *args, **kwargs):
         
         self.storage_type = cdbg.storage_type
@@ -111,7 +132,8 @@ cdef class cDBGWriter_{{type_bundle.suffix}}(cDBGWriter):
             self._s_this = make_shared[_cDBGWriter[_dBG[{{type_bundle.params}}]]]\
                                        (cdbg._this,
                                         convert_format(graph_format),
-                                        _bstring(output_prefix))
+                                        _bstring(output_prefix),
+                                        n_threads)
 
             self._this = <shared_ptr[_MultiFileReporter]>self._s_this
             self._listener = <shared_ptr[_EventListener]>self._s_this
@@ -123,6 +145,7 @@ cdef class cDBGComponentReporter_{{type_bundle.suffix}}(cDBGComponentReporter):
                         cDBG_{{type_bundle.suffix}} cdbg,
                         int                         sample_size,
                         Instrumentation             inst,
+                        str                         report_format='csv',
                         *args,
                         **kwargs):
         
@@ -140,7 +163,8 @@ cdef class cDBGComponentReporter_{{type_bundle.suffix}}(cDBGComponentReporter):
                                       (cdbg._this,
                                        _bstring(output_filename),
                                        registry,
-                                       sample_size)
+                                       sample_size,
+                                       convert_report_format(report_format))
 
             self._this = <shared_ptr[_SingleFileReporter]>self._s_this
             self._listener = <shared_ptr[_EventListener]>self._s_this
@@ -166,6 +190,24 @@ cdef class cDBGUnitigReporter_{{type_bundle.suffix}}(cDBGUnitigReporter):
             self._this = <shared_ptr[_SingleFileReporter]>self._s_this
             self._listener = <shared_ptr[_EventListener]>self._s_this
 
+
+cdef class RunMetricsReporter_{{type_bundle.suffix}}(RunMetricsReporter):
+
+    def __cinit__(self, dBG_{{type_bundle.suffix}} graph,
+                        Instrumentation            inst,
+                        *args, **kwargs):
+
+        self.storage_type = graph.storage_type
+        self.shifter_type = graph.shifter_type
+
+        if type(self) is RunMetricsReporter_{{type_bundle.suffix}}:
+            self._s_this = make_shared[_RunMetricsReporter[_dBG[{{type_bundle.params}}]]]\
+                                      (graph._this, inst.registry)
+            self._listener = <shared_ptr[_EventListener]>self._s_this
+
+    def track(self, EventListener listener):
+        deref(self._s_this).track_listener(listener._listener)
+
 {% endfor %}
 
 {% endblock code %}
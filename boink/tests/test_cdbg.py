@@ -5,14 +5,18 @@
 # This software may be modified and distributed under the terms
 # of the MIT license.  See the LICENSE file for details.
 
+from collections import Counter
 import itertools
 import sys
 
 import pytest
 from boink.tests.utils import *
 
-from boink.compactor import display_segment_list, StreamingCompactor
+from boink.compactor import (display_segment_list, StreamingCompactor,
+                             BatchCompactor)
+from boink.processors import StreamingCompactorProcessor
 from boink.prometheus import Instrumentation
+from boink.reporting import cDBGWriter
 
 
 @pytest.fixture
@@ -518,6 +522,24 @@ class TestUnitigBuildExtend(object):
         assert compactor.cdbg.query_unode_end(graph.hash(sequence[:ksize])).sequence == sequence
         assert compactor.cdbg.n_unitig_ends == 2
 
+    @using_ksize(15)
+    @using_length(200)
+    def test_query_unode_kmer(self, ksize, length, graph, compactor, linear_path, check_fp):
+        sequence = linear_path()
+        check_fp()
+
+        # build from the middle so the unitig is extended both ways
+        compactor.update_sequence(sequence[length//3:2*length//3])
+        compactor.update_sequence(sequence)
+        assert compactor.cdbg.n_unodes == 1
+        assert compactor.cdbg.n_tags > 0
+
+        unode = compactor.cdbg.query_unode_end(graph.hash(sequence[:ksize]))
+        for i in range(length - ksize + 1):
+            found, offset = compactor.cdbg.query_unode_kmer(sequence[i:i+ksize])
+            assert found.node_id == unode.node_id
+            assert offset == i
+
     @using_ksize(15)
     @using_length(100)
     def test_merge(self, ksize, length, graph, compactor, linear_path, check_fp):
@@ -549,6 +571,28 @@ class TestUnitigBuildExtend(object):
         assert compactor.cdbg.query_unode_end(graph.hash(left[-ksize:])) is None
         assert compactor.cdbg.query_unode_end(graph.hash(right[:ksize])) is None
 
+    @using_ksize(15)
+    @using_length(100)
+    @pytest.mark.parametrize('n_threads', [1, 2, 4])
+    def test_merge_batched(self, ksize, length, graph, compactor, linear_path,
+                                 check_fp, n_threads):
+        sequence = linear_path()
+        check_fp()
+
+        left = sequence[:length//2]
+        right = sequence[length//2:]
+
+        n_skipped = compactor.update_sequences([left, right, left + right],
+                                               n_threads)
+        assert n_skipped == 0
+        assert compactor.n_batch_conflicts == 1
+        assert compactor.cdbg.n_unodes == 1
+        unode = compactor.cdbg.query_unode_end(graph.hash(left[:ksize]))
+        assert unode.sequence == left + right
+        assert unode.meta == 'ISLAND'
+        assert compactor.cdbg.query_unode_end(graph.hash(left[-ksize:])) is None
+        assert compactor.cdbg.query_unode_end(graph.hash(right[:ksize])) is None
+
     @using_ksize(15)
     @using_length(100)
     def test_suffix_merge(self, ksize, length, graph, compactor, linear_path, check_fp):
@@ -886,6 +930,34 @@ class TestUnitigSplit(object):
         assert core_right_unode.left_end == graph.hash(core[pivot+1:pivot+ksize+1])
         assert core_right_unode.right_end == graph.hash(core[-ksize:])
 
+    @using_ksize(15)
+    @using_length(100)
+    def test_neighbors_after_induced_split(self, ksize, length, graph, compactor,
+                                                 right_fork, check_fp):
+        (core, branch), pivot = right_fork()
+
+        compactor.update_sequence(core)
+        core_unode = compactor.cdbg.query_unode_end(graph.hash(core[:ksize]))
+        assert compactor.cdbg.find_unode_neighbors(core_unode) == (None, None)
+
+        compactor.update_sequence(branch)
+        dnode = compactor.cdbg.query_dnode(graph.hash(core[pivot:pivot+ksize]))
+        core_left_unode = compactor.cdbg.query_unode_end(graph.hash(core[:ksize]))
+        core_right_unode = compactor.cdbg.query_unode_end(graph.hash(core[-ksize:]))
+        branch_unode = compactor.cdbg.query_unode_end(graph.hash(branch[:ksize]))
+
+        left, right = compactor.cdbg.find_dnode_neighbors(dnode)
+        assert [n.node_id for n in left] == [core_left_unode.node_id]
+        assert sorted(n.node_id for n in right) == \
+               sorted([core_right_unode.node_id, branch_unode.node_id])
+
+        left, right = compactor.cdbg.find_unode_neighbors(core_left_unode)
+        assert left is None
+        assert right.node_id == dnode.node_id
+        left, right = compactor.cdbg.find_unode_neighbors(core_right_unode)
+        assert left.node_id == dnode.node_id
+        assert right is None
+
     @using_ksize(15)
     @using_length(100)
     def test_tandem_decision_unitig_clipping(self, ksize, length, graph, compactor,
@@ -1369,3 +1441,322 @@ class TestFindConnectedComponents:
 
         components = benchmark(compactor.cdbg.find_connected_components)
         assert len(components) == n_components
+
+    @using_ksize(21)
+    @using_length(100)
+    def test_merged_components_match_traversal(self, ksize, length, graph, compactor,
+                                                     snp_bubble, check_fp):
+        bubbles = []
+        for _ in range(5):
+            (wild, snp), L, R = snp_bubble()
+            check_fp()
+            bubbles.append((wild, snp))
+            compactor.update_sequence(wild)
+            compactor.update_sequence(snp)
+        assert compactor.cdbg.n_components == 5
+
+        # bridge the first two bubbles into one component
+        (wild_a, _), (wild_b, _) = bubbles[0], bubbles[1]
+        compactor.update_sequence(wild_a[-ksize:] + wild_b[:ksize])
+        check_fp()
+
+        components = compactor.cdbg.find_connected_components()
+        assert len(components) == compactor.cdbg.n_components == 4
+        assert sorted(compactor.cdbg.component_sizes()) == \
+               sorted(len(nodes) for nodes in components.values())
+
+        for component_id, node_ids in components.items():
+            for node in compactor.cdbg.unodes():
+                if node.node_id in node_ids:
+                    traversed = compactor.cdbg.traverse_breadth_first(node)
+                    assert sorted(n.node_id for n in traversed) == sorted(node_ids)
+                    break
+
+
+class TestBatchCompactor:
+
+    @using_ksize(15)
+    @using_length(100)
+    @pytest.mark.parametrize('n_threads', [1, 4])
+    def test_snp_bubble_matches_streaming(self, ksize, length, graph, compactor,
+                                                snp_bubble, check_fp, n_threads):
+        (wild, snp), L, R = snp_bubble()
+        check_fp()
+
+        compactor.update_sequence(wild)
+        compactor.update_sequence(snp)
+
+        batch = BatchCompactor.build(graph)
+        assert batch.compact([wild, snp], n_threads) == 0
+
+        assert batch.cdbg.n_dnodes == compactor.cdbg.n_dnodes == 2
+        assert batch.cdbg.n_unodes == compactor.cdbg.n_unodes
+        assert sorted(u.sequence for u in batch.cdbg.unodes()) == \
+               sorted(u.sequence for u in compactor.cdbg.unodes())
+        assert sorted(u.meta for u in batch.cdbg.unodes()) == \
+               sorted(u.meta for u in compactor.cdbg.unodes())
+
+    @using_ksize(15)
+    @using_length(20)
+    def test_circular(self, ksize, length, graph, circular, check_fp):
+        sequence = circular()
+        check_fp()
+        graph.insert_sequence(sequence)
+
+        batch = BatchCompactor.build(graph)
+        batch.compact([sequence])
+        assert batch.cdbg.n_unodes == 1
+        assert batch.cdbg.n_unitig_ends == 1
+        assert batch.cdbg.n_dnodes == 0
+
+        unode, = batch.cdbg.unodes()
+        assert unode.meta == 'CIRCULAR'
+        assert unode.left_end == unode.right_end
+        assert len(unode.sequence) == length + ksize - 1
+        assert set(kmers(unode.sequence, ksize)) == set(kmers(sequence, ksize))
+
+    @using_ksize(15)
+    @using_length(100)
+    def test_skips_short(self, ksize, length, graph, linear_path, check_fp):
+        sequence = linear_path()
+        check_fp()
+        graph.insert_sequence(sequence)
+
+        batch = BatchCompactor.build(graph)
+        assert batch.compact([sequence, sequence[:ksize-1]]) == 1
+        assert batch.cdbg.n_unodes == 1
+        unode, = batch.cdbg.unodes()
+        assert unode.sequence == sequence
+        assert unode.meta == 'ISLAND'
+
+
+class TestSnapshot:
+
+    @using_ksize(15)
+    @using_length(100)
+    def test_resume_snp_bubble(self, ksize, length, graph, compactor,
+                                     snp_bubble, check_fp, tmpdir):
+        (wild, snp), L, R = snp_bubble()
+        check_fp()
+
+        compactor.update_sequence(wild)
+        prefix = str(tmpdir.join('snapshot'))
+        compactor.save(prefix)
+
+        resumed = StreamingCompactor.build(graph.shallow_clone())
+        resumed.load(prefix)
+        assert resumed.cdbg.n_unodes == compactor.cdbg.n_unodes == 1
+        assert [u.sequence for u in resumed.cdbg.unodes()] == [wild]
+        assert resumed.cdbg.n_tags == compactor.cdbg.n_tags
+
+        compactor.update_sequence(snp)
+        resumed.update_sequence(snp)
+
+        assert resumed.cdbg.n_dnodes == compactor.cdbg.n_dnodes == 2
+        assert resumed.cdbg.n_updates == compactor.cdbg.n_updates
+        assert sorted((u.node_id, u.sequence, u.meta) for u in resumed.cdbg.unodes()) == \
+               sorted((u.node_id, u.sequence, u.meta) for u in compactor.cdbg.unodes())
+
+    @using_ksize(15)
+    @using_length(100)
+    def test_load_requires_empty(self, ksize, length, graph, compactor,
+                                       linear_path, check_fp, tmpdir):
+        sequence = linear_path()
+        check_fp()
+
+        compactor.update_sequence(sequence)
+        prefix = str(tmpdir.join('snapshot'))
+        compactor.save(prefix)
+
+        with pytest.raises(IOError):
+            compactor.load(prefix)
+
+
+class TestCoverage:
+
+    @using_ksize(15)
+    @using_length(100)
+    def test_extend_accumulates(self, ksize, length, graph, compactor,
+                                      linear_path, check_fp):
+        sequence = linear_path()
+        check_fp()
+        left = sequence[:length//2]
+
+        compactor.update_sequence(left)
+        compactor.update_sequence(sequence)
+        compactor.update_sequence(sequence)
+
+        unode = compactor.cdbg.query_unode_end(graph.hash(sequence[:ksize]))
+        n_left = len(left) - ksize + 1
+        n_kmers = length - ksize + 1
+        assert unode.kmer_count == n_left + 2 * n_kmers
+        assert unode.read_count == 3
+
+    @using_ksize(15)
+    @using_length(100)
+    def test_merge_sums(self, ksize, length, graph, compactor,
+                              linear_path, check_fp):
+        sequence = linear_path()
+        check_fp()
+        left = sequence[:length//2]
+        right = sequence[length//2 + ksize:]
+
+        compactor.update_sequence(left)
+        compactor.update_sequence(right)
+        compactor.update_sequence(sequence)
+        assert compactor.cdbg.n_unodes == 1
+
+        unode = compactor.cdbg.query_unode_end(graph.hash(sequence[:ksize]))
+        n_kmers = length - ksize + 1
+        assert unode.kmer_count == (len(left) - ksize + 1) + \
+                                   (len(right) - ksize + 1) + n_kmers
+        assert unode.read_count == 3
+
+    @using_ksize(15)
+    @using_length(100)
+    @counting_backends()
+    def test_split_counts_kept_kmers(self, ksize, length, graph, compactor,
+                                           right_fork, check_fp):
+        (core, branch), pivot = right_fork()
+        check_fp()
+        # the core is covered unevenly before the branch splits it
+        sequences = [core, core[pivot+1:], core[:pivot+1] + branch]
+
+        for sequence in sequences:
+            compactor.update_sequence(sequence)
+        assert compactor.cdbg.n_unodes == 3
+
+        counts = Counter(graph.hash(sequence[i:i+ksize])
+                         for sequence in sequences
+                         for i in range(len(sequence) - ksize + 1))
+        for unode in compactor.cdbg.unodes():
+            seq = unode.sequence
+            assert unode.kmer_count == sum(counts[graph.hash(seq[i:i+ksize])]
+                                           for i in range(len(seq) - ksize + 1))
+        for dnode in compactor.cdbg.dnodes():
+            assert dnode.count == counts[graph.hash(dnode.sequence)]
+
+    @using_ksize(15)
+    @using_length(100)
+    def test_gfa1_tags(self, ksize, length, graph, compactor,
+                             linear_path, check_fp, tmpdir):
+        sequence = linear_path()
+        check_fp()
+
+        compactor.update_sequence(sequence)
+        compactor.update_sequence(sequence)
+
+        filename = tmpdir.join('coverage.gfa1')
+        compactor.cdbg.save(str(filename), 'gfa1')
+        segments = [l.split('\t') for l in filename.read().splitlines()
+                    if l.startswith('S')]
+        assert len(segments) == 1
+        n_kmers = length - ksize + 1
+        assert segments[0][4:] == ['KC:i:{0}'.format(2 * n_kmers), 'RC:i:2']
+
+
+def gfa1_kmers(filename, graph, ksize):
+    kmers = set()
+    with open(filename) as fp:
+        for line in fp:
+            if line.startswith('S'):
+                sequence = line.split('\t')[2]
+                assert len(sequence) >= ksize
+                kmers.update(graph.hash(sequence[i:i+ksize])
+                             for i in range(len(sequence) - ksize + 1))
+    return kmers
+
+
+class TestWrite:
+
+    @using_ksize(15)
+    @using_length(100)
+    @pytest.mark.parametrize('file_format', ['gfa1', 'fasta'])
+    def test_threads_match(self, ksize, length, graph, compactor, snp_bubble,
+                                 check_fp, tmpdir, file_format):
+        (wild, snp), L, R = snp_bubble()
+        check_fp()
+
+        compactor.update_sequence(wild)
+        compactor.update_sequence(snp)
+
+        serial = tmpdir.join('serial')
+        threaded = tmpdir.join('threaded')
+        compactor.cdbg.save(str(serial), file_format)
+        compactor.cdbg.save(str(threaded), file_format, n_threads=4)
+        assert serial.read() == threaded.read()
+
+        lines = serial.read().splitlines()
+        if file_format == 'gfa1':
+            assert lines[0] == 'H\tVN:Z:1.0'
+            segments = [l.split('\t') for l in lines if l.startswith('S')]
+            assert len(segments) == compactor.cdbg.n_unodes + compactor.cdbg.n_dnodes
+            assert all(s[3] == 'LN:i:{0}'.format(len(s[2])) for s in segments)
+            links = [l for l in lines if l.startswith('L')]
+            assert len(links) == 6
+        else:
+            assert sorted(lines[1::2]) == \
+                   sorted(u.sequence for u in compactor.cdbg.unodes())
+
+    @using_ksize(21)
+    def test_snapshots_during_updates(self, ksize, graph, compactor, datadir,
+                                            tmpdir):
+        # the writer snapshots on its own thread while the processor
+        # keeps compacting; no snapshot may catch a node half-updated
+        prefix = str(tmpdir.join('snapshot'))
+        processor = StreamingCompactorProcessor.build(compactor, 1, 1, 1)
+        writer = cDBGWriter.build(prefix, 'gfa1', compactor.cdbg)
+        processor.Notifier.register_listener(writer)
+
+        processor.process(datadir('test-fastq-reads.fq'))
+        processor.Notifier.stop_listeners()
+
+        filenames = sorted(tmpdir.listdir(lambda p: p.ext == '.gfa1'),
+                           key=lambda p: int(p.basename.split('.')[1]))
+        assert len(filenames) > 1
+        # streaming only adds k-mers, so each snapshot holds the last
+        previous = set()
+        for filename in filenames:
+            kmers = gfa1_kmers(str(filename), graph, ksize)
+            assert previous <= kmers
+            previous = kmers
+
+        final = set(graph.hash(n.sequence) for n in compactor.cdbg.dnodes())
+        for unode in compactor.cdbg.unodes():
+            final.update(graph.hash(unode.sequence[i:i+ksize])
+                         for i in range(len(unode.sequence) - ksize + 1))
+        assert previous == final
+
+
+class TestCompactifyMany:
+
+    @using_ksize(15)
+    @using_length(100)
+    @pytest.mark.parametrize('n_threads', [1, 4])
+    def test_all_kmers_as_seeds(self, ksize, length, graph, compactor,
+                                      snp_bubble, check_fp, n_threads):
+        (wild, snp), L, R = snp_bubble()
+        check_fp()
+
+        compactor.update_sequence(wild)
+        compactor.update_sequence(snp)
+
+        seeds = [seq[i:i+ksize] for seq in (wild, snp)
+                                for i in range(len(seq) - ksize + 1)]
+        unitigs = compactor.compactify_many(seeds, n_threads)
+        assert sorted(unitigs) == \
+               sorted(u.sequence for u in compactor.cdbg.unodes())
+
+    @using_ksize(15)
+    @using_length(100)
+    def test_matches_compactify(self, ksize, length, graph, compactor,
+                                      right_fork, check_fp):
+        (core, branch), pivot = right_fork()
+        check_fp()
+
+        compactor.update_sequence(core)
+        compactor.update_sequence(core[:pivot+1] + branch)
+
+        seed = core[:ksize]
+        assert compactor.compactify_many([seed]) == [compactor.compactify(seed)]
+        assert compactor.compactify(seed) == core[:pivot+ksize-1]
@@ -0,0 +1,96 @@
+# boink/tests/test_cleaner.py
+# Copyright (C) 2018 Camille Scott
+# All rights reserved.
+#
+# This software may be modified and distributed under the terms
+# of the MIT license.  See the LICENSE file for details.
+
+import pytest
+
+from boink.compactor import cDBGCleaner
+from boink.tests.utils import *
+from boink.tests.test_cdbg import compactor
+
+
+class TestClipTips:
+
+    @using_ksize(15)
+    @using_length(100)
+    @exact_backends()
+    def test_clip_low_coverage_tip(self, ksize, length, graph, compactor,
+                                         right_fork, check_fp):
+        (core, branch), pivot = right_fork()
+        check_fp()
+
+        for _ in range(3):
+            compactor.update_sequence(core)
+        compactor.update_sequence(core[:pivot+1] + branch)
+        assert compactor.cdbg.n_dnodes == 1
+        assert compactor.cdbg.n_unodes == 3
+
+        cleaner = cDBGCleaner.build(compactor, max_tip_length=len(branch) + ksize)
+        assert cleaner.clean() == 1
+        assert cleaner.n_tips_clipped == 1
+        assert cleaner.n_dnodes_merged == 1
+
+        assert compactor.cdbg.n_dnodes == 0
+        assert compactor.cdbg.n_unodes == 1
+        unode = compactor.cdbg.query_unode_end(graph.hash(core[:ksize]))
+        assert unode.sequence == core
+        assert graph.query(branch[-ksize:]) == 0
+
+        # the tip's k-mers are new again
+        compactor.update_sequence(core[:pivot+1] + branch)
+        assert compactor.cdbg.n_dnodes == 1
+        assert compactor.cdbg.n_unodes == 3
+
+    @using_ksize(15)
+    @using_length(100)
+    @exact_backends()
+    def test_keep_covered_tip(self, ksize, length, graph, compactor,
+                                    right_fork, check_fp):
+        (core, branch), pivot = right_fork()
+        check_fp()
+
+        for _ in range(3):
+            compactor.update_sequence(core)
+        for _ in range(2):
+            compactor.update_sequence(core[:pivot+1] + branch)
+
+        cleaner = cDBGCleaner.build(compactor, max_tip_length=len(branch) + ksize)
+        assert cleaner.clean() == 0
+        assert compactor.cdbg.n_dnodes == 1
+        assert compactor.cdbg.n_unodes == 3
+
+
+class TestPopBubbles:
+
+    @using_ksize(15)
+    @using_length(100)
+    @exact_backends()
+    def test_pop_snp_bubble(self, ksize, length, graph, compactor,
+                                  snp_bubble, check_fp):
+        (wild, snp), L, R = snp_bubble()
+        check_fp()
+
+        for _ in range(4):
+            compactor.update_sequence(wild)
+        compactor.update_sequence(snp)
+        assert compactor.cdbg.n_dnodes == 2
+        assert compactor.cdbg.n_unodes == 4
+
+        cleaner = cDBGCleaner.build(compactor, max_bubble_length=len(snp))
+        assert cleaner.clean() == 1
+        assert cleaner.n_bubbles_popped == 1
+
+        assert compactor.cdbg.n_dnodes == 0
+        assert compactor.cdbg.n_unodes == 1
+        unode = compactor.cdbg.query_unode_end(graph.hash(wild[:ksize]))
+        assert unode.sequence == wild
+
+
+@using_ksize(15)
+@oxli_backends()
+def test_requires_removal(ksize, graph, compactor):
+    with pytest.raises(ValueError):
+        cDBGCleaner.build(compactor)
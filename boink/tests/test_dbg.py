@@ -104,6 +104,36 @@ def test_n_occupied(graph, ksize):
     assert graph.n_unique == 1
 
 
+@using_ksize(21)
+@oxli_backends()
+def test_estimated_fp(graph, ksize, random_sequence):
+    assert graph.estimated_fp == 0.0
+
+    graph.insert_sequence(random_sequence())
+    assert 0.0 < graph.estimated_fp < 1.0
+
+
+@using_ksize(21)
+@exact_backends()
+def test_estimated_fp_exact(graph, ksize, random_sequence):
+    graph.insert_sequence(random_sequence())
+    assert graph.estimated_fp == 0.0
+
+
+@using_ksize(21)
+@counting_backends()
+def test_n_saturated(graph, ksize):
+    kmer = 'G' * ksize
+
+    for _ in range(255):
+        graph.insert(kmer)
+    assert graph.n_saturated == 0
+
+    for _ in range(10):
+        graph.insert(kmer)
+    assert graph.n_saturated == 10
+
+
 @using_ksize([21,51,81])
 def test_get_ksize(graph, ksize):
     assert graph.K == ksize
@@ -0,0 +1,88 @@
+# boink/tests/test_events.py
+# Copyright (C) 2018 Camille Scott
+# All rights reserved.
+#
+# This software may be modified and distributed under the terms
+# of the MIT license.  See the LICENSE file for details.
+
+import threading
+import time
+
+import pytest
+
+from boink.events import EventRecorder
+
+
+MAX_EVENTS = 50000
+
+
+def start_producers(recorder, n_producers, n_events, offset=0):
+    producers = [threading.Thread(target=recorder.notify_intervals,
+                                  args=(offset + i * n_events, n_events))
+                 for i in range(n_producers)]
+    for producer in producers:
+        producer.start()
+    return producers
+
+
+def wait_for_depth(recorder, depth, timeout=30):
+    deadline = time.time() + timeout
+    while recorder.queue_depth < depth:
+        assert time.time() < deadline
+        time.sleep(0.01)
+
+
+@pytest.mark.parametrize('n_producers', [1, 4, 8])
+def test_producers_lose_nothing(n_producers):
+    recorder = EventRecorder()
+    n_events = 10000
+
+    producers = start_producers(recorder, n_producers, n_events)
+    for producer in producers:
+        producer.join()
+    recorder.stop()
+
+    assert sorted(recorder.handled) == list(range(n_producers * n_events))
+
+
+def test_blocked_producers_resume():
+    recorder = EventRecorder()
+    recorder.hold()
+    n_producers, n_events = 4, 20000
+
+    producers = start_producers(recorder, n_producers, n_events)
+    wait_for_depth(recorder, MAX_EVENTS + 1)
+    # past MAX_EVENTS, notify blocks until the worker catches up
+    time.sleep(0.1)
+    assert recorder.queue_depth <= MAX_EVENTS + n_producers
+    assert any(producer.is_alive() for producer in producers)
+
+    recorder.release()
+    for producer in producers:
+        producer.join(timeout=30)
+        assert not producer.is_alive()
+    recorder.stop()
+
+    assert sorted(recorder.handled) == list(range(n_producers * n_events))
+
+
+def test_clear_events_keeps_later_events():
+    recorder = EventRecorder()
+    recorder.hold()
+    n_queued = 1000
+
+    recorder.notify_intervals(0, n_queued)
+    wait_for_depth(recorder, n_queued)
+    recorder.clear_events()
+
+    producers = start_producers(recorder, 4, 100, offset=n_queued)
+    for producer in producers:
+        producer.join()
+    recorder.release()
+    recorder.stop()
+
+    handled = sorted(recorder.handled)
+    # the worker may have taken the first event before the clear
+    cleared = [t for t in handled if t < n_queued]
+    assert cleared in ([], [0])
+    assert handled[len(cleared):] == list(range(n_queued, n_queued + 400))
@@ -0,0 +1,41 @@
+# boink/tests/test_history_log.py
+# Copyright (C) 2018 Camille Scott
+# All rights reserved.
+#
+# This software may be modified and distributed under the terms
+# of the MIT license.  See the LICENSE file for details.
+
+import os
+
+from boink.reporting import (cDBGHistoryReporter,
+                             cDBGHistoryLogReporter,
+                             history_log_to_graphml)
+from boink.tests.utils import *
+from boink.tests.test_cdbg import compactor
+
+
+@using_ksize(15)
+@using_length(100)
+def test_log_converts_to_reporter_graphml(ksize, length, graph, compactor,
+                                          right_fork, tmpdir, check_fp):
+    (core, branch), pivot = right_fork()
+    check_fp()
+
+    graphml_filename = str(tmpdir.join('history.graphml'))
+    log_filename = str(tmpdir.join('history.log'))
+    converted_filename = str(tmpdir.join('converted.graphml'))
+
+    graphml = cDBGHistoryReporter(graphml_filename)
+    log = cDBGHistoryLogReporter(log_filename)
+    compactor.cdbg.Notifier.register_listener(graphml)
+    compactor.cdbg.Notifier.register_listener(log)
+
+    compactor.update_sequence(core)
+    compactor.update_sequence(core[:pivot+1] + branch)
+    compactor.cdbg.Notifier.stop_listeners()
+
+    assert log.n_records > 0
+    assert history_log_to_graphml(log_filename, converted_filename) == log.n_records
+    assert os.path.getsize(log_filename) < os.path.getsize(graphml_filename)
+    with open(graphml_filename) as expected, open(converted_filename) as result:
+        assert result.read() == expected.read()
@@ -0,0 +1,91 @@
+# boink/tests/test_parsing.py
+# Copyright (C) 2018 Camille Scott
+# All rights reserved.
+#
+# This software may be modified and distributed under the terms
+# of the MIT license.  See the LICENSE file for details.
+
+import threading
+import time
+
+import pytest
+
+from khmer._oxli.parsing import FastxParser
+from boink.parsing import FanOutReader
+
+
+def read_names(filenames):
+    return [record.name for filename in filenames
+                        for record in FastxParser(filename)]
+
+
+def consume(reader, subscriber_id, names):
+    for read in reader.reads(subscriber_id):
+        names.append(read.name)
+
+
+def test_fanout_subscribers_see_same_reads(datadir):
+    rfile = datadir('random-20-a.fa')
+    reader = FanOutReader([rfile, rfile], 3, chunk_size=7, capacity=2)
+
+    results = [[] for _ in range(3)]
+    threads = [threading.Thread(target=consume, args=(reader, i, results[i]))
+               for i in range(3)]
+    for thread in threads:
+        thread.start()
+    for thread in threads:
+        thread.join()
+
+    expected = read_names([rfile, rfile])
+    for names in results:
+        assert names == expected
+
+
+def test_fanout_backpressure(datadir):
+    rfile = datadir('random-20-a.fa')
+    reader = FanOutReader(rfile, 2, chunk_size=1, capacity=2)
+
+    fast = []
+    thread = threading.Thread(target=consume, args=(reader, 0, fast))
+    thread.start()
+
+    # the producer stalls capacity chunks ahead of the idle subscriber
+    deadline = time.time() + 10
+    while reader.n_published < 2 and time.time() < deadline:
+        time.sleep(0.01)
+    time.sleep(0.2)
+    assert reader.n_published == 2
+    assert thread.is_alive()
+    assert len(fast) == 2
+
+    slow = [read.name for read in reader.reads(1)]
+    thread.join()
+
+    assert fast == slow == read_names([rfile])
+    assert reader.n_published == len(slow)
+
+
+def test_fanout_close_releases_backpressure(datadir):
+    rfile = datadir('random-20-a.fa')
+    reader = FanOutReader(rfile, 2, chunk_size=1, capacity=2)
+
+    reader.close(1)
+    names = [read.name for read in reader.reads(0)]
+
+    assert names == read_names([rfile])
+
+
+def test_fanout_parse_error_reaches_subscribers(datadir, tmpdir):
+    rfile = datadir('random-20-a.fa')
+    missing = str(tmpdir.join('missing.fa'))
+    reader = FanOutReader([rfile, missing], 2)
+
+    for subscriber_id in range(2):
+        with pytest.raises(ValueError):
+            list(reader.reads(subscriber_id))
+
+
+def test_fanout_bad_subscriber(datadir):
+    reader = FanOutReader(datadir('random-20-a.fa'), 2)
+    with pytest.raises(IndexError):
+        reader.close(2)
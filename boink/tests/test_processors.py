@@ -8,12 +8,22 @@
 import pytest
 
 import csv
+import statistics
+from collections import Counter
 
 from boink.tests.utils import *
 
 from khmer._oxli.parsing import FastxParser
 from boink.compactor import StreamingCompactor
-from boink.processors import FileConsumer, DecisionNodeProcessor
+from boink.events import EventRecorder
+from boink.processors import (FileConsumer, DecisionNodeProcessor,
+                              SequenceFunctionProcessor,
+                              AbundanceSummaryProcessor,
+                              StreamingCompactorProcessor,
+                              process_shared)
+from boink.prometheus import Instrumentation
+from boink.records import read_records
+from boink.reporting import RunMetricsReporter
 
 
 #@pytest.mark.parametrize('graph_type', ['BitStorage'], indirect=['graph_type'])
@@ -36,6 +46,34 @@ def test_fileconsumer(graph, datadir, ksize):
             assert graph.get(kmer) == graph2.get(kmer)
 
 
+def test_process_shared(graph, datadir, ksize):
+    rfile = datadir('random-20-a.fa')
+    graph2, graph3 = graph.shallow_clone(), graph.shallow_clone()
+    consumer = FileConsumer.build(graph, 10000, 10000, 10000)
+    consumer2 = FileConsumer.build(graph2, 10000, 10000, 10000)
+    compactor = StreamingCompactor.build(graph3)
+    processor = StreamingCompactorProcessor.build(compactor, 10000, 10000, 10000)
+
+    n_records = 2 * len(list(FastxParser(rfile)))
+    n_reads = process_shared([rfile, rfile], consumer, consumer2, processor)
+    assert n_reads == [n_records] * 3
+
+    for record in FastxParser(rfile):
+        for kmer in kmers(record.sequence, ksize):
+            assert graph.get(kmer)
+            assert graph.get(kmer) == graph2.get(kmer)
+            assert graph3.get(kmer)
+
+
+def test_process_shared_error(graph, datadir, tmpdir):
+    rfile = datadir('random-20-a.fa')
+    consumer = FileConsumer.build(graph, 10000, 10000, 10000)
+    other = FileConsumer.build(graph.shallow_clone(), 10000, 10000, 10000)
+
+    with pytest.raises(ValueError):
+        process_shared([rfile, str(tmpdir.join('missing.fa'))], consumer, other)
+
+
 #@pytest.mark.parametrize('graph_type', ['BitStorage'], indirect=['graph_type'])
 def test_DecisionNodeProcessor(graph, ksize, right_fork, fastx_writer, tmpdir):
     '''TODO Check for false positives
@@ -62,3 +100,268 @@ def test_DecisionNodeProcessor(graph, ksize, right_fork, fastx_writer, tmpdir):
             assert int(row['r_degree']) == 2
 
     assert len(data) == 100
+
+
+def test_fileconsumer_multiple_files(graph, datadir, ksize):
+    rfile = datadir('random-20-a.fa')
+    qfile = datadir('test-fastq-reads.fq')
+
+    consumer = FileConsumer.build(graph, 10000, 10000, 10000)
+    n_reads, n_kmers = consumer.process([rfile, qfile])
+
+    graph2 = graph.shallow_clone()
+    expected_reads = 0
+    for filename in (rfile, qfile):
+        for record in FastxParser(filename):
+            graph2.insert_sequence(record.sequence)
+            expected_reads += 1
+
+    assert n_reads == expected_reads
+    for filename in (rfile, qfile):
+        for record in FastxParser(filename):
+            for kmer in kmers(record.sequence, ksize):
+                assert graph.get(kmer) == graph2.get(kmer)
+
+
+def test_fileconsumer_quality_filter(graph, ksize, random_sequence, tmpdir):
+    sequence = random_sequence()
+    # low quality tail on the last ksize bases
+    good = len(sequence) - ksize
+    quality = 'I' * good + '#' * ksize
+    fastq_file = str(tmpdir.join('tmp.fq'))
+    with open(fastq_file, 'w') as fp:
+        fp.write('@0\n{0}\n+\n{1}\n'.format(sequence, quality))
+
+    consumer = FileConsumer.build(graph, 10000, 10000, 10000)
+    consumer.set_quality_filter(20, ksize)
+    consumer.process(fastq_file)
+
+    for kmer in kmers(sequence[:good], ksize):
+        assert graph.get(kmer)
+    assert consumer.n_reads_masked == 1
+    assert consumer.n_bases_masked == ksize
+    # every k-mer overlapping the tail is dropped
+    assert consumer.n_kmers_filtered == ksize
+
+
+def test_fileconsumer_quality_filter_out_of_range(graph, ksize):
+    consumer = FileConsumer.build(graph, 10000, 10000, 10000)
+    with pytest.raises(ValueError):
+        consumer.set_quality_filter(250, ksize)
+
+
+def test_RunMetricsReporter(graph, datadir):
+    rfile = datadir('random-20-a.fa')
+    instrumentation = Instrumentation('', expose=False)
+    compactor = StreamingCompactor.build(graph)
+    processor = StreamingCompactorProcessor.build(compactor, 5, 10000, 10000)
+    run_metrics = RunMetricsReporter.build(graph, instrumentation)
+    recorder = EventRecorder()
+    run_metrics.track(recorder)
+    processor.Notifier.register_listener(run_metrics)
+
+    processor.process(rfile)
+    processor.Notifier.stop_listeners()
+    recorder.stop()
+
+    records = list(FastxParser(rfile))
+    samples = instrumentation.collect()
+    labels = lambda **kwargs: frozenset(kwargs.items())
+
+    consumed = samples['boink_processor_consumed_total']
+    assert consumed[labels(unit='reads')] == len(records)
+    assert consumed[labels(unit='bases')] == sum(len(r.sequence) for r in records)
+
+    storage = samples['boink_storage_current']
+    assert storage[labels(storage='dbg', measure='unique_kmers')] == graph.n_unique
+    assert storage[labels(storage='dbg', measure='estimated_fp')] == \
+        pytest.approx(graph.estimated_fp)
+
+    depths = samples['boink_event_queue_depth']
+    assert labels(listener='EventListener::RunMetricsReporter') in depths
+    assert depths[labels(listener='EventListener::EventRecorder')] == 0
+
+
+@pytest.mark.parametrize('n_threads', [1, 4])
+def test_SequenceFunctionProcessor_median(graph, datadir, tmpdir, n_threads):
+    rfile = datadir('random-20-a.fa')
+    consumer = FileConsumer.build(graph, 10000, 10000, 10000)
+    consumer.process([rfile, rfile])
+
+    result_file = str(tmpdir.join('median.tsv'))
+    processor = SequenceFunctionProcessor.build(graph, 'MedianCount', result_file,
+                                                n_threads=n_threads, batch_size=7)
+    n_reads = processor.process(rfile)
+
+    with open(result_file) as fp:
+        rows = list(csv.DictReader(fp, delimiter='\t'))
+    records = list(FastxParser(rfile))
+
+    assert n_reads == len(records) == len(rows)
+    for record, row in zip(records, rows):
+        expected = statistics.median(graph.query_sequence(record.sequence))
+        assert float(row['MedianCount']) == expected
+
+
+def kmer_values(graph, function, sequence):
+    if function == 'KmerCoverage':
+        return graph.query_sequence(sequence)
+    return [graph.degree(kmer) for kmer in kmers(sequence, graph.K)]
+
+
+@pytest.mark.parametrize('n_threads', [1, 4])
+@pytest.mark.parametrize('function', ['KmerCoverage', 'KmerDegree', 'DegreeBias'])
+def test_SequenceFunctionProcessor_mean(graph, datadir, tmpdir, function, n_threads):
+    rfile = datadir('random-20-a.fa')
+    consumer = FileConsumer.build(graph, 10000, 10000, 10000)
+    consumer.process([rfile, rfile])
+
+    result_file = str(tmpdir.join('mean.tsv'))
+    processor = SequenceFunctionProcessor.build(graph, function, result_file,
+                                                n_threads=n_threads, batch_size=7)
+    processor.process(rfile)
+
+    with open(result_file) as fp:
+        rows = list(csv.DictReader(fp, delimiter='\t'))
+    records = list(FastxParser(rfile))
+
+    assert len(records) == len(rows)
+    for record, row in zip(records, rows):
+        expected = statistics.mean(kmer_values(graph, function, record.sequence))
+        assert float(row[function]) == pytest.approx(expected)
+
+
+@pytest.mark.parametrize('function', ['KmerCoverage', 'KmerDegree'])
+def test_SequenceFunctionProcessor_per_kmer(graph, datadir, tmpdir, function):
+    rfile = datadir('random-20-a.fa')
+    consumer = FileConsumer.build(graph, 10000, 10000, 10000)
+    consumer.process([rfile, rfile])
+
+    result_file = str(tmpdir.join('kmers.tsv'))
+    processor = SequenceFunctionProcessor.build(graph, function, result_file,
+                                                per_kmer=True, n_threads=4,
+                                                batch_size=7)
+    processor.process(rfile)
+
+    with open(result_file) as fp:
+        rows = [(int(row['read_n']), int(row['position']), float(row[function]))
+                for row in csv.DictReader(fp, delimiter='\t')]
+    expected = [(read_n, position, value)
+                for read_n, record in enumerate(FastxParser(rfile))
+                for position, value in enumerate(kmer_values(graph, function,
+                                                             record.sequence))]
+    assert rows == expected
+
+
+def test_SequenceFunctionProcessor_median_per_kmer(graph, tmpdir):
+    with pytest.raises(ValueError):
+        SequenceFunctionProcessor.build(graph, 'MedianCount',
+                                        str(tmpdir.join('kmers.tsv')),
+                                        per_kmer=True)
+
+
+@pytest.mark.parametrize('per_kmer', [False, True])
+def test_SequenceFunctionProcessor_binary(graph, datadir, tmpdir, per_kmer):
+    rfile = datadir('random-20-a.fa')
+    consumer = FileConsumer.build(graph, 10000, 10000, 10000)
+    consumer.process([rfile, rfile])
+
+    tsv_file = str(tmpdir.join('coverage.tsv'))
+    binary_file = str(tmpdir.join('coverage.bin'))
+    for filename, binary in ((tsv_file, False), (binary_file, True)):
+        processor = SequenceFunctionProcessor.build(graph, 'KmerCoverage', filename,
+                                                    binary=binary, per_kmer=per_kmer,
+                                                    n_threads=4, batch_size=7)
+        processor.process(rfile)
+
+    with open(tsv_file) as fp:
+        rows = list(csv.DictReader(fp, delimiter='\t'))
+    records = read_records(binary_file)
+
+    assert len(records) == len(rows) > 0
+    assert list(records.dtype.names) == [name for name in rows[0] if name != 'name']
+    for row, record in zip(rows, records):
+        for column in records.dtype.names[:-1]:
+            assert int(row[column]) == record[column]
+        assert float(row['KmerCoverage']) == pytest.approx(record['KmerCoverage'])
+
+
+@pytest.mark.parametrize('n_threads', [1, 4])
+def test_SequenceFunctionProcessor_degree_bias(graph, datadir, tmpdir, n_threads):
+    rfile = datadir('random-20-a.fa')
+    consumer = FileConsumer.build(graph, 10000, 10000, 10000)
+    consumer.process(rfile)
+
+    processor = SequenceFunctionProcessor.build(graph, 'DegreeBias',
+                                                str(tmpdir.join('degree.tsv')),
+                                                n_threads=n_threads, batch_size=7)
+    processor.process(rfile)
+    bias_file = str(tmpdir.join('bias.csv'))
+    processor.save_degree_bias(bias_file)
+
+    expected = {}
+    for record in FastxParser(rfile):
+        for kmer in kmers(record.sequence, graph.K):
+            degree = graph.degree(kmer)
+            for heptamer in kmers(kmer, 7):
+                expected.setdefault(heptamer, Counter())[degree] += 1
+
+    with open(bias_file) as fp:
+        rows = [line.strip().split(', ') for line in fp]
+    assert len(rows) == 4 ** 7
+    for row in rows:
+        counts = expected.get(row[0], Counter())
+        assert [int(c) for c in row[1:]] == [counts[d] for d in range(len(row) - 1)]
+
+
+def test_SequenceFunctionProcessor_degree_bias_only(graph, tmpdir):
+    processor = SequenceFunctionProcessor.build(graph, 'KmerDegree',
+                                                str(tmpdir.join('degree.tsv')))
+    with pytest.raises(ValueError):
+        processor.save_degree_bias(str(tmpdir.join('bias.csv')))
+
+
+def test_AbundanceSummaryProcessor(graph, datadir, tmpdir):
+    rfile = datadir('random-20-a.fa')
+    qfile = datadir('test-fastq-reads.fq')
+    consumer = FileConsumer.build(graph, 10000, 10000, 10000)
+    consumer.process([rfile, qfile, rfile])
+
+    result_file = str(tmpdir.join('summary.tsv'))
+    processor = AbundanceSummaryProcessor.build(graph, result_file,
+                                                n_threads=3, batch_size=11)
+    processor.process([rfile, qfile])
+
+    expected = ['name\tmax\tmedian\tstart\tend\tinternal_max']
+    for filename in (rfile, qfile):
+        for record in FastxParser(filename):
+            counts = graph.query_sequence(record.sequence)
+            internal = max(counts[1:-1]) if len(counts) > 2 else None
+            expected.append('"{0}"\t{1}\t{2}\t{3}\t{4}\t{5}'.format(record.name,
+                            max(counts), statistics.median(counts),
+                            counts[0], counts[-1], internal))
+
+    with open(result_file) as fp:
+        assert fp.read().splitlines() == expected
+
+
+@pytest.mark.parametrize('n_threads', [2, 8])
+def test_AbundanceSummaryProcessor_threads_keep_rows(graph, datadir, tmpdir, n_threads):
+    rfile = datadir('random-20-a.fa')
+    qfile = datadir('test-fastq-reads.fq')
+    consumer = FileConsumer.build(graph, 10000, 10000, 10000)
+    consumer.process([rfile, qfile])
+
+    inputs = [rfile, qfile] * 5
+    result_file = str(tmpdir.join('summary.tsv'))
+    processor = AbundanceSummaryProcessor.build(graph, result_file,
+                                                n_threads=n_threads,
+                                                batch_size=500)
+    processor.process(inputs)
+
+    n_expected = sum(1 for filename in inputs
+                       for record in FastxParser(filename)
+                       if len(record.sequence) >= graph.ksize)
+    with open(result_file) as fp:
+        rows = list(csv.DictReader(fp, delimiter='\t'))
+    assert len(rows) == n_expected
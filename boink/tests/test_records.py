@@ -0,0 +1,57 @@
+# boink/tests/test_records.py
+# Copyright (C) 2018 Camille Scott
+# All rights reserved.
+#
+# This software may be modified and distributed under the terms
+# of the MIT license.  See the LICENSE file for details.
+
+import csv
+
+import pytest
+
+from boink.processors import StreamingCompactorProcessor
+from boink.records import read_records
+from boink.reporting import StreamingCompactorReporter
+from boink.tests.utils import *
+from boink.tests.test_cdbg import compactor
+
+
+@pytest.mark.parametrize('fp_warning_threshold', [0.0, 1e-9])
+def test_binary_report_matches_csv(compactor, datadir, tmpdir, fp_warning_threshold):
+    csv_filename = str(tmpdir.join('stats.csv'))
+    binary_filename = str(tmpdir.join('stats.bin'))
+
+    processor = StreamingCompactorProcessor.build(compactor, 10, 50, 100)
+    processor.fp_warning_threshold = fp_warning_threshold
+    csv_reporter = StreamingCompactorReporter.build(csv_filename, compactor)
+    binary_reporter = StreamingCompactorReporter.build(binary_filename, compactor,
+                                                       'binary')
+    processor.Notifier.register_listener(csv_reporter)
+    processor.Notifier.register_listener(binary_reporter)
+
+    processor.process(datadir('test-fastq-reads.fq'))
+    processor.Notifier.stop_listeners()
+
+    with open(csv_filename) as fp:
+        rows = list(csv.DictReader(fp))
+    records = read_records(binary_filename)
+
+    assert len(records) == len(rows) > 0
+    assert list(records.dtype.names) == list(rows[0].keys())
+    # each reporter samples the graph on its own thread while compaction
+    # goes on, so only read_n lines up before the END row
+    assert [int(row['read_n']) for row in rows] == list(records['read_n'])
+
+    row, record = rows[-1], records[-1]
+    for column in records.dtype.names:
+        if records.dtype[column].kind == 'f':
+            # the CSV keeps the stream's default six significant digits
+            assert float(row[column]) == pytest.approx(record[column], rel=1e-5)
+        else:
+            assert int(row[column]) == record[column]
+
+
+def test_invalid_report_format(compactor, tmpdir):
+    with pytest.raises(ValueError):
+        StreamingCompactorReporter.build(str(tmpdir.join('stats.bin')),
+                                         compactor, 'arrow')
@@ -126,6 +126,7 @@ DEBUG        = get_var('DEBUG', DEBUG_CDBG or \
                                 DEBUG_EVENTS)
 
 HEAP_PROFILE = get_var('HEAP_PROFILE', False)
+STAGE_TIMING = get_var('STAGE_TIMING', False)
 
 if DEBUG_ALL:
     DEBUG        = True
@@ -208,6 +209,9 @@ if PROFILING:
 if HEAP_PROFILE:
     LDFLAGS  += ['-ltcmalloc']
 
+if STAGE_TIMING:
+    CXXFLAGS += ['-DBOINK_STAGE_TIMING']
+
 if sys.platform == 'linux':
     LDFLAGS  += ['-pthread']
 
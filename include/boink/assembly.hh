@@ -10,12 +10,16 @@
 #ifndef BOINK_ASSEMBLY_HH
 #define BOINK_ASSEMBLY_HH
 
+#include "boink/hashing/exceptions.hh"
 #include "boink/hashing/hashing_types.hh"
 #include "boink/hashing/kmeriterator.hh"
 
+#include <algorithm>
 #include <deque>
 #include <memory>
+#include <mutex>
 #include <set>
+#include <thread>
 #include <unordered_set>
 #include <vector>
 
@@ -62,6 +66,45 @@ typedef std::set<DecisionKmer, DecisionKmerComp> DecisionKmerSet;
 typedef std::unordered_set<DecisionKmer, DecisionKmerHash> DecisionKmerUSet;
 
 
+/* A set of hashes shared by several walker threads, sharded on the top
+ * bits of the mixed hash so that they seldom wait on each other.
+ */
+class ConcurrentHashSet {
+
+    static const size_t N_SHARDS = 64;
+
+    struct shard_t {
+        std::mutex                 mutex;
+        std::unordered_set<hash_t> hashes;
+    };
+    std::unique_ptr<shard_t[]> _shards;
+
+    shard_t& _shard(hash_t hash) {
+        return _shards[(hash * 0x9E3779B97F4A7C15ULL) >> 58];
+    }
+
+public:
+
+    ConcurrentHashSet()
+        : _shards(new shard_t[N_SHARDS])
+    {
+    }
+
+    // true if the hash was new
+    bool insert(hash_t hash) {
+        auto& shard = _shard(hash);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        return shard.hashes.insert(hash).second;
+    }
+
+    bool contains(hash_t hash) {
+        auto& shard = _shard(hash);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        return shard.hashes.count(hash) > 0;
+    }
+};
+
+
 template<class GraphType>
 class AssemblerMixin : public GraphType::shifter_type {
 
@@ -69,6 +112,34 @@ protected:
 
     std::set<hash_t> seen;
 
+    // count_nodes and reduce_nodes for nodes that were already prefetched
+    uint8_t _count_nodes(const std::vector<shift_t>& nodes) {
+        uint8_t n_found = 0;
+        for (auto node: nodes) {
+            if(this->graph->query(node.hash)) {
+                ++n_found;
+            }
+        }
+        return n_found;
+    }
+
+    uint8_t _reduce_nodes(const std::vector<shift_t>& nodes,
+                          shift_t&                    result) {
+        uint8_t n_found = 0;
+        for (auto node : nodes) {
+            //pdebug("check " << neighbor.hash << " " << neighbor.symbol);
+            if(this->graph->query(node.hash)) {
+                //pdebug("found " << neighbor.hash);
+                ++n_found;
+                if (n_found > 1) {
+                    return n_found;
+                }
+                result = node;
+            }
+        }
+        return n_found;
+    }
+
 public:
 
     using BaseShifter = typename GraphType::shifter_type;
@@ -145,18 +216,35 @@ public:
     }
 
 
-    uint8_t count_nodes(const std::vector<shift_t>& nodes) {
-        uint8_t n_found = 0;
-        for (auto node: nodes) {
-            if(this->graph->query(node.hash)) {
-                ++n_found;
-            }
+    /* Start loading the storage for all of a step's candidate
+     * neighbors before any of them is queried, so that their cache
+     * misses overlap rather than being paid one after another.
+     */
+    void prefetch_nodes(const std::vector<shift_t>& nodes) {
+        for (auto& node : nodes) {
+            this->graph->prefetch(node.hash);
         }
-        return n_found;
+    }
+
+    /* Gather the neighbors on both sides of the cursor as one
+     * prefetched batch.
+     */
+    void gather_neighbors(std::vector<shift_t>& left,
+                          std::vector<shift_t>& right) {
+        left = this->gather_left();
+        right = this->gather_right();
+        prefetch_nodes(left);
+        prefetch_nodes(right);
+    }
+
+    uint8_t count_nodes(const std::vector<shift_t>& nodes) {
+        prefetch_nodes(nodes);
+        return _count_nodes(nodes);
     }
 
     uint8_t count_nodes(const std::vector<shift_t>& nodes,
                         std::set<hash_t>&           extras) {
+        prefetch_nodes(nodes);
         uint8_t n_found = 0;
         for (auto node: nodes) {
             if(this->graph->query(node.hash) ||
@@ -169,24 +257,14 @@ public:
 
     uint8_t reduce_nodes(const std::vector<shift_t>& nodes,
                          shift_t&                    result) {
-        uint8_t n_found = 0;
-        for (auto node : nodes) {
-            //pdebug("check " << neighbor.hash << " " << neighbor.symbol);
-            if(this->graph->query(node.hash)) {
-                //pdebug("found " << neighbor.hash);
-                ++n_found;
-                if (n_found > 1) {
-                    return n_found;
-                }
-                result = node;
-            }
-        }
-        return n_found;
+        prefetch_nodes(nodes);
+        return _reduce_nodes(nodes, result);
     }
 
     uint8_t reduce_nodes(const std::vector<shift_t>& nodes,
                          shift_t&                    result,
                          std::set<hash_t>&           extra) {
+        prefetch_nodes(nodes);
         uint8_t n_found = 0;
         for (auto node : nodes) {
             //pdebug("check " << neighbor.hash << " " << neighbor.symbol);
@@ -204,6 +282,7 @@ public:
     }
 
     std::vector<shift_t> filter_nodes(const std::vector<shift_t>& nodes) {
+        prefetch_nodes(nodes);
         std::vector<shift_t> result;
         for (auto node : nodes) {
             if (this->graph->query(node.hash)) {
@@ -215,6 +294,7 @@ public:
 
     std::vector<shift_t> filter_nodes(const std::vector<shift_t>& nodes,
                                  std::set<hash_t>&      extra) {
+        prefetch_nodes(nodes);
         std::vector<shift_t> result;
         for (auto node : nodes) {
             if (this->graph->query(node.hash) ||
@@ -350,18 +430,78 @@ public:
     {
     }
 
-    std::string compactify(const std::string& seed) {
+    /* Walk the unitig through seed: left first, then right with the
+     * left walk as a mask, so that a circular unitig isn't walked around
+     * twice. A circular unitig is rotated to start at its smallest k-mer
+     * hash, with both ends anchored there, so that walks from any of its
+     * k-mers agree.
+     */
+    void compactify(const std::string& seed,
+                    std::string&       sequence,
+                    hash_t&            left_end,
+                    hash_t&            right_end) {
         Path path;
+        std::set<hash_t> mask;
+
         this->set_cursor(seed);
         this->get_cursor(path);
-        hash_t end_hash;
-        compactify_left(path, end_hash);
+        compactify_left(path, left_end, mask);
+        mask.swap(this->seen);
         this->set_cursor(seed);
-        compactify_right(path, end_hash);
+        compactify_right(path, right_end, mask);
+        sequence = this->to_string(path);
+
+        if (sequence.size() > _K && is_circular(sequence, left_end, right_end)) {
+            left_end = right_end = rotate_circular(sequence);
+        }
+    }
+
+    std::string compactify(const std::string& seed) {
+        std::string sequence;
+        hash_t left_end, right_end;
+        compactify(seed, sequence, left_end, right_end);
+        return sequence;
+    }
+
+    /* Walk the unitigs through many seeds at once, on n_threads copies
+     * of this walker. The k-mers of each walked unitig go into a visited
+     * set shared by the threads and seeds already in it are skipped, so
+     * each unitig is walked about once; when two threads race on the
+     * same one, whichever claims its left end first keeps it. Seeds that
+     * are invalid, missing from the dBG, or decision k-mers are skipped.
+     * Returns the unitigs in no particular order.
+     */
+    std::vector<std::string> compactify_many(const std::vector<std::string>& seeds,
+                                             unsigned int n_threads=1) {
+        n_threads = std::max(1u, std::min<unsigned int>(n_threads, seeds.size()));
+        ConcurrentHashSet visited;
+        std::vector<std::vector<std::string>> unitigs(n_threads);
+
+        std::vector<std::thread> workers;
+        for (unsigned int t = 0; t < n_threads; ++t) {
+            workers.emplace_back([&, t] {
+                CompactorMixin walker(this->graph);
+                for (size_t i = t; i < seeds.size(); i += n_threads) {
+                    walker._walk_seed(seeds[i], visited, unitigs[t]);
+                }
+            });
+        }
+        for (auto& worker : workers) {
+            worker.join();
+        }
 
-        return this->to_string(path);
+        std::vector<std::string> result;
+        for (auto& thread_unitigs : unitigs) {
+            std::move(thread_unitigs.begin(), thread_unitigs.end(),
+                      std::back_inserter(result));
+        }
+        return result;
     }
 
+    /* Each step queries both sides of the cursor as one prefetched
+     * batch: the side walked from, for a reverse d-node, and the side
+     * walked to.
+     */
     void compactify_right(Path&             path,
                           hash_t&           end_hash,
                           std::set<hash_t>& mask) {
@@ -370,16 +510,17 @@ public:
         this->seen.clear();
         this->seen.insert(this->get());
         
+        std::vector<shift_t> left, right;
         shift_t next;
         uint8_t n_right;
         while (1) {
-            if (degree_left() > 1) {
+            this->gather_neighbors(left, right);
+            if (this->_count_nodes(left) > 1) {
                 path.pop_back();
                 return;
             }
 
-            n_right = this->reduce_nodes(this->gather_right(),
-                                         next);
+            n_right = this->_reduce_nodes(right, next);
             if (n_right > 1) {
                 path.pop_back();
                 return;
@@ -411,17 +552,18 @@ public:
         this->seen.clear();
         this->seen.insert(this->get());
 
+        std::vector<shift_t> left, right;
         shift_t next;
         uint8_t n_left;
         while (1) {
-            if (degree_right() > 1) {
+            this->gather_neighbors(left, right);
+            if (this->_count_nodes(right) > 1) {
                 pdebug("Stop: reverse d-node");
                 path.pop_front();
                 return;
             }
 
-            n_left = this->reduce_nodes(this->gather_left(),
-                                        next);
+            n_left = this->_reduce_nodes(left, next);
             if (n_left > 1) {
                 pdebug("Stop: forward d-node");
                 path.pop_front();
@@ -448,6 +590,40 @@ public:
         }
     }
 
+    bool is_circular(const std::string& sequence,
+                     hash_t             left_end,
+                     hash_t             right_end) {
+        shift_t neighbor;
+        this->set_cursor(sequence.substr(sequence.size() - _K));
+        if (this->reduce_nodes(this->gather_right(), neighbor) != 1 ||
+            neighbor.hash != left_end) {
+            return false;
+        }
+        this->set_cursor(sequence.substr(0, _K));
+        return this->reduce_nodes(this->gather_left(), neighbor) == 1 &&
+               neighbor.hash == right_end;
+    }
+
+    /* Start a circular unitig at its smallest k-mer hash, which is
+     * returned.
+     */
+    hash_t rotate_circular(std::string& sequence) {
+        hashing::KmerIterator<BaseShifter> kmers(sequence, _K);
+        size_t start = 0;
+        hash_t min_hash = kmers.next();
+        for (size_t i = 1; !kmers.done(); ++i) {
+            hash_t h = kmers.next();
+            if (h < min_hash) {
+                min_hash = h;
+                start = i;
+            }
+        }
+        const size_t n_kmers = sequence.size() - _K + 1;
+        sequence = sequence.substr(start, n_kmers + _K - 1 - start)
+                   + sequence.substr(_K - 1, start);
+        return min_hash;
+    }
+
     bool is_decision_kmer(const std::string& node,
                           uint8_t& degree) {
         this->set_cursor(node);
@@ -552,6 +728,37 @@ public:
             return false;
         }
     }
+
+protected:
+
+    void _walk_seed(const std::string&        seed,
+                    ConcurrentHashSet&        visited,
+                    std::vector<std::string>& unitigs) {
+        std::string sequence;
+        hash_t left_end, right_end;
+        try {
+            hash_t h = this->set_cursor(seed);
+            if (visited.contains(h) ||
+                !this->graph->query(h) ||
+                is_decision_kmer(seed)) {
+                return;
+            }
+            compactify(seed, sequence, left_end, right_end);
+        } catch (hashing::InvalidCharacterException &e) {
+            return;
+        } catch (hashing::SequenceLengthException &e) {
+            return;
+        }
+
+        if (!visited.insert(left_end)) {
+            return;
+        }
+        hashing::KmerIterator<BaseShifter> kmers(sequence, _K);
+        while (!kmers.done()) {
+            visited.insert(kmers.next());
+        }
+        unitigs.push_back(std::move(sequence));
+    }
 };
 
 }
@@ -0,0 +1,332 @@
+/* batch_compactor.hh -- offline compaction of a finished dBG
+ *
+ * Copyright (C) 2018 Camille Scott
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+
+#ifndef BOINK_BATCH_COMPACTOR_HH
+#define BOINK_BATCH_COMPACTOR_HH
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
+
+#include "boink/boink.hh"
+#include "boink/assembly.hh"
+#include "boink/hashing/exceptions.hh"
+#include "boink/hashing/hashing_types.hh"
+#include "boink/hashing/kmeriterator.hh"
+#include "boink/dbg.hh"
+#include "boink/cdbg/cdbg.hh"
+
+#include "boink/cdbg/compactor.hh"
+#include "boink/cdbg/node_table.hh"
+
+
+namespace boink {
+namespace cdbg {
+
+using namespace boink::hashing;
+
+
+/* Builds the cDBG of a dBG that is already complete, rather than
+ * maintaining it read by read as StreamingCompactor does. The dBG can't
+ * enumerate its own k-mers, so the sequences it was built from are
+ * scanned in parallel: each distinct k-mer has its degree checked once,
+ * yielding the decision k-mers and a seed for each run of non-decision
+ * k-mers. The unitig through each seed is then walked with
+ * compactify_left/right, also in parallel, and the nodes are built at
+ * the end, with no splits, merges or extensions along the way.
+ */
+template <class GraphType>
+class BatchCompactor {
+
+protected:
+
+    using ShifterType = typename GraphType::shifter_type;
+    using CompactorType = CompactorMixin<GraphType>;
+
+    uint16_t _K;
+
+    struct unitig_t {
+        std::string sequence;
+        hash_t      left_end;
+        hash_t      right_end;
+    };
+
+    // thread-local results of the sequence scan and the unitig walks
+    struct scan_t {
+        std::vector<kmer_t>   decision_kmers;
+        std::vector<kmer_t>   seeds;
+        std::vector<unitig_t> unitigs;
+        uint64_t              n_skipped;
+
+        scan_t()
+            : n_skipped(0)
+        {
+        }
+    };
+
+    struct visited_entry {
+        hash_t key;
+        bool   present;
+
+        visited_entry()
+            : key(0),
+              present(false)
+        {
+        }
+
+        visited_entry(hash_t key)
+            : key(key),
+              present(true)
+        {
+        }
+
+        bool occupied() const {
+            return present;
+        }
+    };
+
+    // k-mers whose degree has been checked, sharded on the top bits of
+    // the mixed hash (the tables index on lower ones)
+    static const size_t N_VISITED_SHARDS = 64;
+    struct visited_shard_t {
+        std::mutex                        mutex;
+        LinearProbeIndex<visited_entry>   hashes;
+    };
+    std::unique_ptr<visited_shard_t[]> _visited;
+
+    bool _visit(hash_t hash) {
+        auto& shard = _visited[(hash * 0x9E3779B97F4A7C15ULL) >> 58];
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        return shard.hashes.insert(visited_entry(hash),
+                                   [](const visited_entry&) { return true; });
+    }
+
+    template <class Worker>
+    static void _run_workers(size_t n_items,
+                             unsigned int n_threads,
+                             Worker work) {
+        n_threads = std::max(1u, std::min<unsigned int>(n_threads, n_items));
+        std::vector<std::thread> workers;
+        for (unsigned int t = 0; t < n_threads; ++t) {
+            workers.emplace_back([&, t] {
+                for (size_t i = t; i < n_items; i += n_threads) {
+                    work(t, i);
+                }
+            });
+        }
+        for (auto& worker : workers) {
+            worker.join();
+        }
+    }
+
+    /* Scan a sequence's k-mers, skipping any already visited from
+     * another sequence. Every other k-mer is a decision k-mer, whose
+     * neighbors are also taken as seeds, or lies in a run of unvisited
+     * non-decision k-mers; a run lies within a single unitig, so its
+     * first k-mer is enough of a seed. A sequence with an invalid
+     * character is scanned up to it, as dBG::insert_sequence would have
+     * inserted it.
+     */
+    void _scan(CompactorType& walker,
+               const std::string& sequence,
+               scan_t& scan) {
+
+        try {
+            KmerIterator<typename CompactorType::assembler_type> kmers(sequence, &walker);
+            bool in_run = false;
+            for (size_t pos = 0; !kmers.done(); ++pos) {
+                hash_t h = kmers.next();
+                if (!_visit(h)) {
+                    in_run = false;
+                } else if (walker.degree_left() > 1 || walker.degree_right() > 1) {
+                    scan.decision_kmers.emplace_back(h, sequence.substr(pos, this->_K));
+                    for (auto& kmer : walker.find_left_kmers()) {
+                        scan.seeds.push_back(kmer);
+                    }
+                    for (auto& kmer : walker.find_right_kmers()) {
+                        scan.seeds.push_back(kmer);
+                    }
+                    in_run = false;
+                } else if (!in_run) {
+                    scan.seeds.emplace_back(h, sequence.substr(pos, this->_K));
+                    in_run = true;
+                }
+            }
+        } catch (InvalidCharacterException &e) {
+            ++scan.n_skipped;
+        } catch (SequenceLengthException &e) {
+            ++scan.n_skipped;
+        }
+    }
+
+    /* Walk the unitig through seed. A seed that turns out to be a
+     * decision k-mer, because it only occurs in the dBG and not in the
+     * scanned sequences, is recorded as one instead.
+     */
+    void _walk(CompactorType& walker, const kmer_t& seed, scan_t& scan) {
+        if (walker.is_decision_kmer(seed.kmer)) {
+            scan.decision_kmers.push_back(seed);
+            return;
+        }
+
+        unitig_t unitig;
+        walker.compactify(seed.kmer, unitig.sequence, unitig.left_end, unitig.right_end);
+        scan.unitigs.push_back(std::move(unitig));
+    }
+
+public:
+
+    shared_ptr<GraphType> dbg;
+    shared_ptr<cDBG<GraphType>> cdbg;
+
+    BatchCompactor(shared_ptr<GraphType> dbg,
+                   shared_ptr<prometheus::Registry> pr_registry,
+                   uint64_t minimizer_window_size=8)
+        : _K(dbg->K()),
+          dbg(dbg)
+    {
+        this->cdbg = make_shared<cDBG<GraphType>>(dbg,
+                                                  pr_registry,
+                                                  minimizer_window_size);
+    }
+
+    uint16_t K() const {
+        return _K;
+    }
+
+    /* Compact the dBG with n_threads, given the sequences that were
+     * inserted into it; unitigs none of them touch are not found.
+     * Memory for one hash per distinct k-mer is held during the scan.
+     * Returns the number of sequences that were too short or contained
+     * invalid characters.
+     */
+    uint64_t compact(const std::vector<std::string>& sequences,
+                     unsigned int n_threads=1) {
+
+        if (cdbg->n_decision_nodes() || cdbg->n_unitig_nodes()) {
+            throw BoinkException("BatchCompactor can only compact into an empty cDBG.");
+        }
+
+        n_threads = std::max(1u, n_threads);
+        std::vector<std::unique_ptr<CompactorType>> walkers;
+        for (unsigned int t = 0; t < n_threads; ++t) {
+            walkers.push_back(make_unique<CompactorType>(dbg));
+        }
+        std::vector<scan_t> scans(n_threads);
+
+        _visited.reset(new visited_shard_t[N_VISITED_SHARDS]);
+        _run_workers(sequences.size(), n_threads, [&](unsigned int t, size_t i) {
+            _scan(*walkers[t], sequences[i], scans[t]);
+        });
+        _visited.reset();
+
+        uint64_t n_skipped = 0;
+        std::vector<kmer_t> decision_kmers;
+        std::vector<kmer_t> seeds;
+        for (auto& scan : scans) {
+            n_skipped += scan.n_skipped;
+            std::move(scan.decision_kmers.begin(), scan.decision_kmers.end(),
+                      std::back_inserter(decision_kmers));
+            std::move(scan.seeds.begin(), scan.seeds.end(),
+                      std::back_inserter(seeds));
+            scan = scan_t();
+        }
+
+        auto by_hash = [](const kmer_t& a, const kmer_t& b) { return a.hash < b.hash; };
+        std::sort(decision_kmers.begin(), decision_kmers.end(), by_hash);
+        std::sort(seeds.begin(), seeds.end(), by_hash);
+        seeds.erase(std::unique(seeds.begin(), seeds.end()), seeds.end());
+        seeds.erase(std::remove_if(seeds.begin(), seeds.end(),
+            [&](const kmer_t& seed) {
+                return std::binary_search(decision_kmers.begin(), decision_kmers.end(),
+                                          seed, by_hash);
+            }), seeds.end());
+
+        // walk the unitigs; a seed is skipped once any walk has covered it
+        std::unique_ptr<std::atomic<bool>[]> covered(new std::atomic<bool>[seeds.size()]);
+        for (size_t i = 0; i < seeds.size(); ++i) {
+            covered[i] = false;
+        }
+        _run_workers(seeds.size(), n_threads, [&](unsigned int t, size_t i) {
+            if (covered[i]) {
+                return;
+            }
+            auto& unitigs = scans[t].unitigs;
+            size_t n_walked = unitigs.size();
+            _walk(*walkers[t], seeds[i], scans[t]);
+            if (unitigs.size() == n_walked) {
+                return;
+            }
+
+            KmerIterator<ShifterType> kmers(unitigs.back().sequence, this->_K);
+            while (!kmers.done()) {
+                kmer_t kmer(kmers.next(), "");
+                auto it = std::lower_bound(seeds.begin(), seeds.end(), kmer, by_hash);
+                if (it != seeds.end() && it->hash == kmer.hash) {
+                    covered[it - seeds.begin()] = true;
+                }
+            }
+        });
+
+        std::vector<unitig_t> unitigs;
+        for (auto& scan : scans) {
+            std::move(scan.decision_kmers.begin(), scan.decision_kmers.end(),
+                      std::back_inserter(decision_kmers));
+            std::move(scan.unitigs.begin(), scan.unitigs.end(),
+                      std::back_inserter(unitigs));
+        }
+        scans.clear();
+
+        // d-nodes first, so the unitigs' meta is computed against them;
+        // a unitig walked from several seeds is built once
+        std::sort(decision_kmers.begin(), decision_kmers.end(), by_hash);
+        decision_kmers.erase(std::unique(decision_kmers.begin(), decision_kmers.end()),
+                             decision_kmers.end());
+        for (auto& kmer : decision_kmers) {
+            cdbg->build_dnode(kmer.hash, kmer.kmer, 0);
+        }
+
+        std::sort(unitigs.begin(), unitigs.end(),
+            [](const unitig_t& a, const unitig_t& b) { return a.left_end < b.left_end; });
+        unitigs.erase(std::unique(unitigs.begin(), unitigs.end(),
+            [](const unitig_t& a, const unitig_t& b) { return a.left_end == b.left_end; }),
+            unitigs.end());
+        for (auto& unitig : unitigs) {
+            cdbg->build_unode(unitig.sequence,
+                              unitig.left_end,
+                              unitig.right_end);
+        }
+
+        // coverage, as though the sequences had been streamed in
+        for (auto& sequence : sequences) {
+            std::vector<hash_t> hashes;
+            try {
+                KmerIterator<ShifterType> kmers(sequence, this->_K);
+                while (!kmers.done()) {
+                    hashes.push_back(kmers.next());
+                }
+            } catch (InvalidCharacterException &e) {
+                continue;
+            } catch (SequenceLengthException &e) {
+                continue;
+            }
+            cdbg->add_coverage(sequence, hashes);
+        }
+
+        return n_skipped;
+    }
+};
+
+}
+}
+
+#endif
@@ -16,14 +16,15 @@
 #include <mutex>
 #include <iostream>
 #include <fstream>
+#include <functional>
 #include <sstream>
+#include <thread>
 #include <tuple>
 
 // save diagnostic state
 #pragma GCC diagnostic push 
 #pragma GCC diagnostic ignored "-Wsign-compare"
 #pragma GCC diagnostic ignored "-Wchar-subscripts"
-#include "gfakluge/gfakluge.hpp"
 #include "sparsepp/spp.h"
 #pragma GCC diagnostic pop
 
@@ -39,7 +40,13 @@
 #include "boink/event_types.hh"
 
 #include "boink/cdbg/cdbg_types.hh"
+#include "boink/cdbg/components.hh"
 #include "boink/cdbg/metrics.hh"
+#include "boink/cdbg/node_table.hh"
+#include "boink/cdbg/snapshot.hh"
+
+#define CDBG_SAVED_SIGNATURE      "BCDG"
+#define CDBG_SAVED_FORMAT_VERSION 2
 
 # ifdef DEBUG_CDBG
 #   define pdebug(x) do { std::ostringstream stream; \
@@ -84,34 +91,38 @@ public:
     typedef CompactorType compactor_type;
     typedef MinimizerType minimizer_type;
 
-    /* Map of k-mer hash --> DecisionNode. DecisionNodes take
-     * their k-mer hash value as their Node ID.
+    /* Table of DecisionNodes. DecisionNodes take their k-mer
+     * hash value as their Node ID; their slots are found through
+     * the node index.
      */
-    typedef spp::sparse_hash_map<hash_t,
-                                 std::unique_ptr<DecisionNode>> dnode_map_t;
-    typedef dnode_map_t::const_iterator dnode_iter_t;
+    typedef NodeTable<DecisionNode> dnode_table_t;
+    typedef dnode_table_t::const_iterator dnode_iter_t;
 
-    /* Map of Node ID --> UnitigNode. This is a container
-     * for the UnitigNodes' pointers; k-mer maps are stored elsewhere,
-     * mapping k-mers to Node IDs.
+    /* Table of UnitigNodes, indexed by slot. This is a container for
+     * the UnitigNodes' pointers; k-mers are mapped to slots by the node
+     * index, and Node IDs by the slot index.
      */
-    typedef spp::sparse_hash_map<id_t,
-                                 std::unique_ptr<UnitigNode>> unode_map_t;
-    typedef unode_map_t::const_iterator unode_iter_t;
+    typedef NodeTable<UnitigNode> unode_table_t;
+    typedef unode_table_t::const_iterator unode_iter_t;
 
 protected:
 
     shared_ptr<GraphType> dbg;
 
-    // The actual k-mer hash --> DNode map
-    dnode_map_t decision_nodes;
-
-    // The actual ID --> UNode map
-    unode_map_t unitig_nodes;
-    // The map from Unitig end k-mer hashes to UnitigNodes
-    spp::sparse_hash_map<hash_t, UnitigNode*> unitig_end_map;
-    // The map from dBG k-mer tags to UnitigNodes
-    spp::sparse_hash_map<hash_t, UnitigNode*> unitig_tag_map;
+    // The DNode table
+    dnode_table_t decision_nodes;
+
+    // The UNode table
+    unode_table_t unitig_nodes;
+    // unitig ID --> UNode slot
+    UnitigSlotIndex unitig_slots;
+    // k-mer hash --> DNode slot and unitig end entries
+    NodeIndex node_index;
+    // sampled interior k-mer hash --> (unitig ID, coordinate)
+    UnitigPositionIndex position_index;
+    // a k-mer is sampled if it is the minimum in some window of
+    // this many consecutive unitig k-mers
+    uint64_t _sample_window;
 
     //std::mutex dnode_mutex;
     //std::mutex unode_mutex;
@@ -124,7 +135,11 @@ protected:
     // Current number of Unitigs
     uint64_t _n_unitig_nodes;
 
-    id_t     component_id_counter;
+    // connected components, kept up to date as nodes change
+    ComponentIndex component_index;
+
+    // backing store for the sequences in history events
+    events::SequenceBuffer _history_sequences;
 
     shared_ptr<prometheus::Registry> pr_registry;
 
@@ -138,10 +153,10 @@ public:
         : KmerClient(dbg->K()),
           EventNotifier(),
           dbg(dbg),
+          _sample_window(std::max(minimizer_window_size, (uint64_t)1)),
           _n_updates(0),
           _unitig_id_counter(UNITIG_START_ID),
           _n_unitig_nodes(0),
-          component_id_counter(0),
           pr_registry(metrics_registry)
     {
         pr_registry = metrics_registry;
@@ -162,19 +177,19 @@ public:
         return dbg;
     }
 
-    dnode_map_t::const_iterator dnodes_begin() const {
+    dnode_iter_t dnodes_begin() const {
         return decision_nodes.cbegin();
     }
 
-    dnode_map_t::const_iterator dnodes_end() const {
+    dnode_iter_t dnodes_end() const {
         return decision_nodes.cend();
     }
 
-    unode_map_t::const_iterator unodes_begin() const {
+    unode_iter_t unodes_begin() const {
         return unitig_nodes.cbegin();
     }
 
-    unode_map_t::const_iterator unodes_end() const {
+    unode_iter_t unodes_end() const {
         return unitig_nodes.cend();
     }
 
@@ -195,11 +210,15 @@ public:
     }
 
     uint64_t n_tags() const {
-        return unitig_tag_map.size();
+        return position_index.size();
+    }
+
+    uint64_t sample_window() const {
+        return _sample_window;
     }
 
     uint64_t n_unitig_ends() const {
-        return unitig_end_map.size();
+        return node_index.count(INDEX_UNODE_END);
     }
 
     /* Node query methods: separate query mechanisms for
@@ -207,18 +226,24 @@ public:
      */
 
     CompactNode* query_cnode(hash_t hash) {
-        CompactNode * node = query_unode_end(hash);
-        if (node == nullptr) {
-            node = query_dnode(hash);
-        }
+        // unitig ends take precedence over d-nodes
+        CompactNode * node = nullptr;
+        node_index.probe(hash, [&](node_index_t kind, uint64_t slot) {
+            if (kind == INDEX_UNODE_END) {
+                node = unitig_nodes.at(slot);
+                return true;
+            } else if (kind == INDEX_DNODE) {
+                node = decision_nodes.at(slot);
+            }
+            return false;
+        });
         return node;
     }
 
     DecisionNode* query_dnode(hash_t hash) {
-
-        auto search = decision_nodes.find(hash);
-        if (search != decision_nodes.end()) {
-            return search->second.get();
+        uint64_t slot;
+        if (node_index.find(hash, INDEX_DNODE, slot)) {
+            return decision_nodes.at(slot);
         }
         return nullptr;
     }
@@ -239,39 +264,100 @@ public:
     }
 
     UnitigNode * query_unode_end(hash_t end_kmer) {
-        auto search = unitig_end_map.find(end_kmer);
-        if (search != unitig_end_map.end()) {
-            return search->second;
+        uint64_t slot;
+        if (node_index.find(end_kmer, INDEX_UNODE_END, slot)) {
+            return unitig_nodes.at(slot);
         }
         return nullptr;
     }
 
     UnitigNode * query_unode_tag(hash_t hash) {
-        auto search = unitig_tag_map.find(hash);
-        if (search != unitig_tag_map.end()) {
-            return search->second;
+        id_t id;
+        int64_t coord;
+        if (position_index.find(hash, id, coord)) {
+            return query_unode_id(id);
         }
         return nullptr;
     }
 
+    /* Find the unitig containing the given k-mer and the k-mer's offset
+     * within it, or (nullptr, -1). Walks right through the dBG until it
+     * reaches a sampled k-mer or the unitig's right end, which the
+     * sampling guarantees within sample_window() steps; branches (from
+     * false positives in the dBG) are followed too, up to a fixed
+     * budget, and the answer is checked against the unitig sequence.
+     */
+    std::pair<UnitigNode*, int64_t> query_unode_kmer(const std::string& kmer) {
+        CompactorType compactor(dbg);
+        std::vector<std::pair<std::string, uint64_t>> stack;
+        stack.emplace_back(kmer, 0);
+        uint64_t budget = 4 * (_sample_window + 1);
+
+        while (stack.size() && budget--) {
+            auto current = stack.back();
+            stack.pop_back();
+            const uint64_t step = current.second;
+            hash_t h = compactor.set_cursor(current.first);
+
+            UnitigNode * unode = nullptr;
+            int64_t offset = -1;
+            id_t id;
+            int64_t coord;
+
+            if (position_index.find(h, id, coord)) {
+                unode = query_unode_id(id);
+                offset = coord - unode->origin() - step;
+            } else if ((unode = query_unode_end(h)) != nullptr) {
+                if (h == unode->right_end()) {
+                    offset = unode->n_kmers(this->_K) - 1 - step;
+                } else if (step == 0) {
+                    offset = 0;
+                }
+            } else if (query_dnode(h) != nullptr) {
+                continue;
+            }
+
+            if (unode != nullptr) {
+                if (offset >= 0 &&
+                    offset < (int64_t)unode->n_kmers(this->_K) &&
+                    unode->sequence.substr(offset, this->_K) == kmer) {
+                    return std::make_pair(unode, offset);
+                }
+                continue;
+            }
+
+            if (step < _sample_window) {
+                for (auto neighbor : compactor.filter_nodes(compactor.gather_right())) {
+                    stack.emplace_back(current.first.substr(1) + neighbor.symbol,
+                                       step + 1);
+                }
+            }
+        }
+
+        return std::make_pair(nullptr, -1);
+    }
+
     UnitigNode * query_unode_id(id_t id) {
-        auto search = unitig_nodes.find(id);
-        if (search != unitig_nodes.end()) {
-            return search->second.get();
+        uint64_t slot;
+        if (unitig_slots.find(id, slot)) {
+            return unitig_nodes.at(slot);
         }
         return nullptr;
     }
 
+    /* unode's slot in the unitig table, for the node index. */
+    uint64_t _unode_slot(const UnitigNode * unode) const {
+        uint64_t slot = 0;
+        unitig_slots.find(unode->node_id, slot);
+        return slot;
+    }
+
     bool has_dnode(hash_t hash) {
-        auto search = decision_nodes.find(hash);
-        if (search != decision_nodes.end()) {
-            return true;
-        }
-        return false;   
+        return node_index.contains(hash, INDEX_DNODE);
     }
 
     bool has_unode_end(hash_t end_kmer) {
-        return unitig_end_map.count(end_kmer) != 0;
+        return node_index.contains(end_kmer, INDEX_UNODE_END);
     }
 
     CompactNode * find_rc_cnode(CompactNode * root) {
@@ -287,60 +373,143 @@ public:
      *
      */
 
-    std::pair<std::vector<CompactNode*>,
-              std::vector<CompactNode*>> find_dnode_neighbors(DecisionNode* dnode) {
+    /* Neighbors are cached on the nodes as IDs: a d-node keeps the nodes
+     * on each side, a unitig the d-nodes at its ends. They are derived
+     * from the k-mer shifts of the node's ends and the node index alone,
+     * so they can only go stale when an index entry at one of those
+     * shifts changes; every such change calls invalidate_near, and the
+     * next query re-derives.
+     */
 
-        std::vector<CompactNode*> left;
-        std::vector<CompactNode*> right;
-        auto neighbors = dbg->neighbors(dnode->sequence);
+    void derive_dnode_neighbors(DecisionNode * dnode) {
+        ShifterType shifter(this->_K);
+        shifter.set_cursor(dnode->sequence.str());
 
-        for (auto shift : neighbors.first) {
+        dnode->left_neighbors.clear();
+        for (auto shift : shifter.gather_left()) {
             CompactNode * node = query_cnode(shift.hash);
             if (node != nullptr) {
-                left.push_back(node);
+                dnode->left_neighbors.push_back(node->node_id, node->meta() == DECISION);
             }
         }
 
-        for (auto shift : neighbors.second) {
+        dnode->right_neighbors.clear();
+        for (auto shift : shifter.gather_right()) {
             CompactNode * node = query_cnode(shift.hash);
             if (node != nullptr) {
-                right.push_back(node);
+                dnode->right_neighbors.push_back(node->node_id, node->meta() == DECISION);
             }
         }
 
-        return make_pair(left, right);
+        dnode->adjacency_valid = true;
     }
 
-    std::pair<DecisionNode*, DecisionNode*> find_unode_neighbors(UnitigNode * unode) {
-        DecisionNode * left = nullptr, * right = nullptr;
-        CompactorType compactor(dbg);
-
-        compactor.set_cursor(unode->sequence.c_str());
-        auto left_shifts = compactor.gather_left();
+    void derive_unode_neighbors(UnitigNode * unode) {
+        ShifterType shifter(this->_K);
+        unode->left_dnode = unode->right_dnode = NULL_ID;
 
-        compactor.set_cursor(unode->sequence.c_str() + unode->sequence.size() - this->_K);
-        auto right_shifts = compactor.gather_right();
+        shifter.set_cursor(unode->sequence.substr(0, this->_K));
+        for (auto shift : shifter.gather_left()) {
+            if (has_dnode(shift.hash)) {
+                unode->left_dnode = shift.hash;
+                pdebug("Found left d-node: " << shift.hash);
+            }
+        }
 
-        uint8_t n_left = 0;
-        for (auto shift : left_shifts) {
-            DecisionNode * dnode;
-            if ((dnode = query_dnode(shift.hash)) != nullptr) {
-                left = dnode;
-                n_left++;
-                pdebug("Found left d-node: " << *dnode);
+        shifter.set_cursor(unode->sequence.substr(unode->sequence.size() - this->_K));
+        for (auto shift : shifter.gather_right()) {
+            if (has_dnode(shift.hash)) {
+                unode->right_dnode = shift.hash;
+                pdebug("Found right d-node: " << shift.hash);
             }
         }
 
-        uint8_t n_right = 0;
-        for (auto shift : right_shifts) {
-            DecisionNode * dnode;
-            if ((dnode = query_dnode(shift.hash)) != nullptr) {
-                right = dnode;
-                n_right++;
-                pdebug("Found right d-node: " << *dnode);
+        unode->adjacency_valid = true;
+    }
+
+    /* Invalidate the cached neighbors of every node with an end at
+     * kmer or one shift away from it. Called with the old and new ends
+     * of any node whose index entries change.
+     */
+    void invalidate_near(const std::string& kmer) {
+        ShifterType shifter(this->_K);
+        hash_t hash = shifter.set_cursor(kmer);
+        auto shifts = shifter.gather_left();
+        auto right = shifter.gather_right();
+        shifts.insert(shifts.end(), right.begin(), right.end());
+        shifts.emplace_back(hash, 'A');
+
+        for (auto shift : shifts) {
+            node_index.probe(shift.hash, [&](node_index_t kind, uint64_t slot) {
+                CompactNode * node = kind == INDEX_DNODE
+                                     ? static_cast<CompactNode*>(decision_nodes.at(slot))
+                                     : static_cast<CompactNode*>(unitig_nodes.at(slot));
+                if (node != nullptr) {
+                    node->adjacency_valid = false;
+                }
+                return false;
+            });
+        }
+    }
+
+    void _invalidate_end(UnitigNode * unode, direction_t end) {
+        unode->adjacency_valid = false;
+        if (end == DIR_LEFT) {
+            invalidate_near(unode->sequence.substr(0, this->_K));
+        } else {
+            invalidate_near(unode->sequence.substr(unode->sequence.size() - this->_K));
+        }
+    }
+
+    void _invalidate_ends(UnitigNode * unode) {
+        _invalidate_end(unode, DIR_LEFT);
+        _invalidate_end(unode, DIR_RIGHT);
+    }
+
+    CompactNode * _resolve_neighbor(const neighbor_ids_t& neighbors, uint8_t i) {
+        if (neighbors.is_dnode(i)) {
+            return query_dnode(neighbors.ids[i]);
+        }
+        return query_unode_id(neighbors.ids[i]);
+    }
+
+    std::pair<std::vector<CompactNode*>,
+              std::vector<CompactNode*>> find_dnode_neighbors(DecisionNode* dnode) {
+
+        if (!dnode->adjacency_valid) {
+            derive_dnode_neighbors(dnode);
+        }
+
+        std::vector<CompactNode*> left;
+        std::vector<CompactNode*> right;
+        for (uint8_t i = 0; i < dnode->left_neighbors.n; ++i) {
+            CompactNode * node = _resolve_neighbor(dnode->left_neighbors, i);
+            if (node != nullptr) {
+                left.push_back(node);
+            }
+        }
+        for (uint8_t i = 0; i < dnode->right_neighbors.n; ++i) {
+            CompactNode * node = _resolve_neighbor(dnode->right_neighbors, i);
+            if (node != nullptr) {
+                right.push_back(node);
             }
         }
 
+        return make_pair(left, right);
+    }
+
+    std::pair<DecisionNode*, DecisionNode*> find_unode_neighbors(UnitigNode * unode) {
+        if (!unode->adjacency_valid) {
+            derive_unode_neighbors(unode);
+        }
+
+        DecisionNode * left = nullptr, * right = nullptr;
+        if (unode->left_dnode != NULL_ID) {
+            left = query_dnode(unode->left_dnode);
+        }
+        if (unode->right_dnode != NULL_ID) {
+            right = query_dnode(unode->right_dnode);
+        }
         return std::make_pair(left, right);
     }
 
@@ -383,46 +552,102 @@ public:
         return result;
     }
 
+    /* Member lookup for the component index: the live node, or nullptr
+     * if it has been removed.
+     */
+    std::function<CompactNode*(const component_member&)> _component_lookup() {
+        return [this](const component_member& member) -> CompactNode* {
+            if (member.is_dnode) {
+                return query_dnode(member.id);
+            }
+            return query_unode_id(member.id);
+        };
+    }
+
+    /* Settle any components left dirty by deletions (the caller will
+     * need to lock).
+     */
+    void _refresh_components() {
+        if (component_index.is_dirty()) {
+            component_index.refresh(_component_lookup(),
+                                    [this](CompactNode * root) {
+                                        return traverse_breadth_first(root);
+                                    });
+        }
+    }
+
+    void _connect_unode(UnitigNode * unode,
+                        std::pair<DecisionNode*, DecisionNode*> neighbors) {
+        if (neighbors.first != nullptr) {
+            component_index.unite(unode, neighbors.first, _component_lookup());
+        }
+        if (neighbors.second != nullptr) {
+            component_index.unite(unode, neighbors.second, _component_lookup());
+        }
+    }
+
+    void _connect_dnode(DecisionNode * dnode) {
+        auto neighbors = find_dnode_neighbors(dnode);
+        for (auto neighbor : neighbors.first) {
+            component_index.unite(dnode, neighbor, _component_lookup());
+        }
+        for (auto neighbor : neighbors.second) {
+            component_index.unite(dnode, neighbor, _component_lookup());
+        }
+    }
+
     spp::sparse_hash_map<id_t, std::vector<id_t>> find_connected_components() {
         auto lock = this->lock_nodes();
+        _refresh_components();
 
-        spp::sparse_hash_set<id_t>                    seen;
+        auto lookup = _component_lookup();
         spp::sparse_hash_map<id_t, std::vector<id_t>> components;
-
-        for (auto unitig_it = unodes_begin(); unitig_it != unodes_end(); unitig_it++) {
-            auto root = unitig_it->second.get();
-            if (!seen.count(root->node_id)) {
-                auto              component_nodes = traverse_breadth_first(root);
-                std::vector<id_t> component_node_ids;
-                id_t              component_id = root->component_id;
-
-                if (component_id == NULL_ID) {
-                    component_id = component_id_counter;
-                    ++component_id_counter;
-                    root->component_id = component_id;
-                }
-
-                for (auto node : component_nodes) {
-                    node->component_id = component_id;
-                    seen.insert(node->node_id);
-                    component_node_ids.push_back(node->node_id);
+        spp::sparse_hash_set<component_member, component_member_hash> seen;
+        for (auto& component : component_index.components()) {
+            auto& component_node_ids = components[component.first];
+            for (auto& member : component.second.members) {
+                CompactNode * node = lookup(member);
+                if (node != nullptr && node->component_id == component.first &&
+                    seen.insert(member).second) {
+                    component_node_ids.push_back(member.id);
                 }
-
-                components[component_id] = component_node_ids;
             }
         }
 
         return components;
     }
 
+    /* Node counts of the current components, without listing their
+     * members.
+     */
+    std::vector<size_t> component_sizes() {
+        auto lock = this->lock_nodes();
+        _refresh_components();
+
+        std::vector<size_t> sizes;
+        sizes.reserve(component_index.n_components());
+        for (auto& component : component_index.components()) {
+            sizes.push_back(component.second.size);
+        }
+        return sizes;
+    }
+
+    uint64_t n_components() {
+        auto lock = this->lock_nodes();
+        _refresh_components();
+        return component_index.n_components();
+    }
+
     node_meta_t recompute_node_meta(UnitigNode * unode) {
         pdebug("Recompute node meta for " << unode->node_id);
         if (unode->sequence.size() == this->_K) {
+            _connect_unode(unode, find_unode_neighbors(unode));
             return TRIVIAL;
         } else if (unode->left_end() == unode->right_end()) {
             return CIRCULAR;
         } else {
             auto neighbors = find_unode_neighbors(unode);
+            _connect_unode(unode, neighbors);
             if (neighbors.first == neighbors.second) {
                 if (neighbors.first == nullptr) {
                     return ISLAND;
@@ -439,17 +664,95 @@ public:
         }
     }
 
+    /* Sample the k-mers of any window of _sample_window k-mers that
+     * overlaps positions [begin, end) of the unitig.
+     */
+    void _sample_unode(UnitigNode * unode, size_t begin, size_t end) {
+        const int64_t n_kmers = unode->n_kmers(this->_K);
+        const int64_t window = _sample_window;
+        int64_t lo = std::max<int64_t>(0, (int64_t)begin - window + 1);
+        int64_t hi = std::min<int64_t>(n_kmers, (int64_t)end + window - 1);
+        if (hi <= lo) {
+            return;
+        }
+
+        RollingMin<hash_t> minimizer(std::min(window, hi - lo));
+        KmerIterator<ShifterType> kmers(unode->sequence.substr(lo, hi - lo + this->_K - 1),
+                                        this->_K);
+        for (int64_t i = 0; !kmers.done(); ++i) {
+            auto current = minimizer.update(kmers.next());
+            if (i + 1 >= minimizer.window_size() &&
+                position_index.insert(current.first,
+                                      unode->node_id,
+                                      unode->origin() + lo + current.second)) {
+                unode->tags.push_back(current.first);
+            }
+        }
+    }
+
+    /* Drop samples that are no longer inside the unitig. */
+    void _prune_samples(UnitigNode * unode) {
+        const int64_t n_kmers = unode->n_kmers(this->_K);
+        auto keep = std::remove_if(unode->tags.begin(), unode->tags.end(),
+            [&](hash_t tag) {
+                id_t id;
+                int64_t coord;
+                if (!position_index.find(tag, id, coord) || id != unode->node_id) {
+                    return true;
+                }
+                int64_t offset = coord - unode->origin();
+                if (offset < 0 || offset >= n_kmers) {
+                    position_index.erase(tag, unode->node_id);
+                    return true;
+                }
+                return false;
+            });
+        unode->tags.erase(keep, unode->tags.end());
+    }
+
+    void _erase_samples(UnitigNode * unode) {
+        for (hash_t tag : unode->tags) {
+            position_index.erase(tag, unode->node_id);
+        }
+        unode->tags.clear();
+    }
+
+    /* The k-mer count unode should carry after it has been cut down
+     * from n_before k-mers holding kmer_count observations. A counting
+     * dBG still has each kept k-mer's observations (saturating), so they
+     * are summed; a presence-only dBG does not, and the mean coverage is
+     * kept instead. Called before the current sequence is inserted.
+     */
+    uint64_t _kept_count(UnitigNode * unode, uint64_t kmer_count, size_t n_before) {
+        if (storage::is_counting<typename GraphType::storage_type>::value) {
+            uint64_t count = 0;
+            for (auto c : dbg->query_sequence(unode->sequence)) {
+                count += c;
+            }
+            return count;
+        }
+        return n_before ? kmer_count * unode->n_kmers(this->_K) / n_before : 0;
+    }
+
+    /* After unode has lost k-mers, reset its k-mer count to what the
+     * k-mers it kept observed. The read count stays.
+     */
+    void _recount_coverage(UnitigNode * unode, size_t n_before) {
+        unode->set_coverage(_kept_count(unode, unode->kmer_count(), n_before),
+                            unode->read_count());
+    }
+
     UnitigNode * switch_unode_ends(hash_t old_unode_end,
                                    hash_t new_unode_end) {
 
-        auto unode_end_it = unitig_end_map.find(old_unode_end);
-        if (unode_end_it == unitig_end_map.end()) {
+        uint64_t slot;
+        if (!node_index.find(old_unode_end, INDEX_UNODE_END, slot)) {
             return nullptr;
         }
+        UnitigNode * unode = unitig_nodes.at(slot);
 
-        UnitigNode * unode = unode_end_it->second;
-        unitig_end_map.erase(unode_end_it);
-        unitig_end_map.insert(make_pair(new_unode_end, unode));
+        node_index.erase(old_unode_end, INDEX_UNODE_END);
+        node_index.insert(new_unode_end, INDEX_UNODE_END, slot);
 
         pdebug("Swap " << old_unode_end << " to " << new_unode_end
                << " for " << unode->node_id);
@@ -458,18 +761,24 @@ public:
     }
 
     DecisionNode* build_dnode(hash_t hash,
-                              const std::string& kmer) {
-        /* Build a new DecisionNode; or, if the given k-mer hash
-         * already has a DecisionNode, do nothing.
+                              const std::string& kmer,
+                              uint32_t count) {
+        /* Build a new DecisionNode holding count prior observations;
+         * or, if the given k-mer hash already has a DecisionNode, do
+         * nothing. add_coverage credits the current sequence.
          */
         auto lock = lock_nodes();
         DecisionNode * dnode = query_dnode(hash);
         if (dnode == nullptr) {
             pdebug("BUILD_DNODE: " << hash << ", " << kmer);
-            decision_nodes.emplace(hash,
-                                   std::move(make_unique<DecisionNode>(hash, kmer)));
-            // the memory location changes after the move; get a fresh address
-            dnode = query_dnode(hash);
+            auto slot = decision_nodes.insert(hash,
+                                              make_unique<DecisionNode>(hash, kmer));
+            node_index.insert(hash, INDEX_DNODE, slot);
+            dnode = decision_nodes.at(slot);
+            dnode->set_count(count);
+            invalidate_near(kmer);
+            component_index.add(dnode);
+            _connect_dnode(dnode);
             notify_history_new(dnode->node_id,
                                dnode->sequence,
                                dnode->meta());
@@ -477,41 +786,44 @@ public:
             pdebug("BUILD_DNODE complete: " << *dnode);
         } else {
             pdebug("BUILD_DNODE: d-node for " << hash << " already exists.");
-            dnode->incr_count();
         }
         return dnode;
     }
 
     UnitigNode * build_unode(const std::string& sequence,
-                             std::vector<hash_t>& tags,
                              hash_t left_end,
                              hash_t right_end) {
 
         auto lock = lock_nodes();
+        return _build_unode(sequence, left_end, right_end);
+    }
+
+    /* build_unode, for a caller already holding the node lock. */
+    UnitigNode * _build_unode(const std::string& sequence,
+                              hash_t left_end,
+                              hash_t right_end) {
+
         id_t id = _unitig_id_counter;
         
-        // Transfer the UnitigNode's ownership to the map;
+        // Transfer the UnitigNode's ownership to the table;
         // get its new memory address
-        unitig_nodes.emplace(id, std::move(make_unique<UnitigNode>(id,
-                                                                   left_end,
-                                                                   right_end,
-                                                                   sequence)));
-        UnitigNode * unode_ptr = unitig_nodes[id].get();
+        auto slot = unitig_nodes.insert(id, make_unique<UnitigNode>(id,
+                                                                    left_end,
+                                                                    right_end,
+                                                                    sequence));
+        unitig_slots.insert(id, slot);
+        UnitigNode * unode_ptr = unitig_nodes.at(slot);
 
         _unitig_id_counter++;
         _n_unitig_nodes++;
         _n_updates++;
         metrics->n_unodes.Increment();
 
-        // Link up its new tags
-        unode_ptr->tags.insert(std::end(unode_ptr->tags),
-                               std::begin(tags),
-                               std::end(tags));
-        for (auto tag: tags) {
-            unitig_tag_map.insert(make_pair(tag, unode_ptr));
-        }
-        unitig_end_map.insert(make_pair(left_end, unode_ptr));
-        unitig_end_map.insert(make_pair(right_end, unode_ptr));
+        _sample_unode(unode_ptr, 0, unode_ptr->n_kmers(this->_K));
+        node_index.insert(left_end, INDEX_UNODE_END, slot);
+        node_index.insert(right_end, INDEX_UNODE_END, slot);
+        _invalidate_ends(unode_ptr);
+        component_index.add(unode_ptr);
 
         auto unode_meta = recompute_node_meta(unode_ptr);
         unode_ptr->set_node_meta(unode_meta);
@@ -531,18 +843,22 @@ public:
 
         auto unode = switch_unode_ends(old_unode_end, new_unode_end);
         assert(unode != nullptr);
+        _invalidate_end(unode, clip_from);
         pdebug("CLIP: " << *unode << " from " << (clip_from == DIR_LEFT ? std::string("LEFT") : std::string("RIGHT")) <<
                " and swap " << old_unode_end << " to " << new_unode_end);
 
         if (unode->sequence.length() == this->_K) {
             metrics->decrement_cdbg_node(unode->meta());
-            delete_unode(unode);
+            delete_unode(unode, true);
             pdebug("CLIP complete: deleted null unode.");
         } else {
             metrics->n_clips.Increment();
+            size_t n_kmers = unode->n_kmers(this->_K);
             if (clip_from == DIR_LEFT) {
-                unode->sequence = unode->sequence.substr(1);
-                unode->set_left_end(new_unode_end);
+                unode->clip_left(new_unode_end);
+                _prune_samples(unode);
+                _invalidate_end(unode, DIR_LEFT);
+                _recount_coverage(unode, n_kmers);
 
                 metrics->decrement_cdbg_node(unode->meta());
                 auto meta = recompute_node_meta(unode);
@@ -552,8 +868,10 @@ public:
                 notify_history_clip(unode->node_id, unode->sequence, unode->meta());
                 pdebug("CLIP complete: " << *unode);
             } else {
-                unode->sequence = unode->sequence.substr(0, unode->sequence.length() - 1);
-                unode->set_right_end(new_unode_end);
+                unode->clip_right(new_unode_end);
+                _prune_samples(unode);
+                _invalidate_end(unode, DIR_RIGHT);
+                _recount_coverage(unode, n_kmers);
 
                 metrics->decrement_cdbg_node(unode->meta());
                 auto meta = recompute_node_meta(unode);
@@ -571,17 +889,25 @@ public:
     void extend_unode(direction_t ext_dir,
                       const std::string& new_sequence,
                       hash_t old_unode_end,
-                      hash_t new_unode_end,
-                      std::vector<hash_t>& new_tags) {
+                      hash_t new_unode_end) {
 
         auto lock = lock_nodes();
+        _extend_unode(ext_dir, new_sequence, old_unode_end, new_unode_end);
+    }
+
+    /* extend_unode, for a caller already holding the node lock. */
+    void _extend_unode(direction_t ext_dir,
+                       const std::string& new_sequence,
+                       hash_t old_unode_end,
+                       hash_t new_unode_end) {
 
         auto unode = switch_unode_ends(old_unode_end, new_unode_end);
         if (unode->meta() == TRIVIAL) {
-            unitig_end_map.insert(make_pair(old_unode_end, unode));
+            node_index.insert(old_unode_end, INDEX_UNODE_END, _unode_slot(unode));
         }
 
         assert(unode != nullptr); 
+        _invalidate_end(unode, ext_dir);
 
         pdebug("EXTEND: from " << old_unode_end << " to " << new_unode_end
                << (ext_dir == DIR_LEFT ? std::string(" to LEFT") : std::string(" to RIGHT"))
@@ -589,15 +915,14 @@ public:
                << std::endl << *unode);
         
         if (ext_dir == DIR_RIGHT) {
+            size_t old_n_kmers = unode->n_kmers(this->_K);
             unode->extend_right(new_unode_end, new_sequence);
+            _sample_unode(unode, old_n_kmers, unode->n_kmers(this->_K));
         } else {
             unode->extend_left(new_unode_end, new_sequence);
+            _sample_unode(unode, 0, new_sequence.size());
         }
-
-        std::copy(new_tags.begin(), new_tags.end(), std::back_inserter(unode->tags));
-        for (auto tag: new_tags) {
-            unitig_tag_map.insert(make_pair(tag, unode));
-        }
+        _invalidate_end(unode, ext_dir);
 
         metrics->n_extends.Increment();
         metrics->decrement_cdbg_node(unode->meta());
@@ -616,67 +941,76 @@ public:
                      hash_t new_right_end,
                      hash_t new_left_end) {
 
-        UnitigNode * unode;
-        std::string right_unitig;
-        hash_t right_unode_right_end;
-
-        {
-            auto lock = lock_nodes();
-
-            unode = query_unode_id(node_id);
-            assert(unode != nullptr);
-            if (unode->meta() == CIRCULAR) {
-                pdebug("SPLIT: (CIRCULAR), flanking k-mers will become ends, " << 
-                       new_left_end << " will be left_end, " << new_right_end <<
-                       " will be right_end" << std::endl);
-
-                split_at = unode->sequence.find(split_kmer);
-                pdebug("Split k-mer found at " << split_at);
-                unode->sequence = unode->sequence.substr(split_at + 1) +
-                                  unode->sequence.substr((this->_K - 1), split_at);
-                switch_unode_ends(unode->left_end(), new_left_end);
-                unitig_end_map.insert(make_pair(new_right_end, unode));
-
-                unode->set_left_end(new_left_end);
-                unode->set_right_end(new_right_end);
-
-                metrics->n_splits.Increment();
-                unode->set_node_meta(FULL);
-                metrics->decrement_cdbg_node(CIRCULAR);
-                metrics->increment_cdbg_node(FULL);
-                ++_n_updates;
-
-                notify_history_split_circular(unode->node_id, unode->sequence, unode->meta());
-                pdebug("SPLIT complete (CIRCULAR): " << *unode);
-                return;
-
-            }
-            pdebug("SPLIT: " << new_right_end << " left of root, "
-                    << new_left_end << " right of root, at " << split_at
-                    << std::endl << *unode);
-
-            assert((split_at != 0) && (split_at != unode->sequence.size() - this->_K));
-            right_unitig = unode->sequence.substr(split_at + 1);
+        // split and build under one lock, so a snapshot sees both
+        // halves or neither
+        auto lock = lock_nodes();
 
-            // set the left unode right end to the new right end
-            right_unode_right_end = unode->right_end();
-            switch_unode_ends(unode->right_end(), new_right_end);
+        UnitigNode * unode = query_unode_id(node_id);
+        assert(unode != nullptr);
+        uint64_t kmer_count = unode->kmer_count();
+        uint64_t read_count = unode->read_count();
+        size_t n_kmers = unode->n_kmers(this->_K);
+        if (unode->meta() == CIRCULAR) {
+            pdebug("SPLIT: (CIRCULAR), flanking k-mers will become ends, " << 
+                   new_left_end << " will be left_end, " << new_right_end <<
+                   " will be right_end" << std::endl);
+
+            split_at = unode->sequence.find(split_kmer);
+            pdebug("Split k-mer found at " << split_at);
+            _erase_samples(unode);
+            _invalidate_ends(unode);
+            unode->sequence = unode->sequence.substr(split_at + 1) +
+                              unode->sequence.substr((this->_K - 1), split_at);
+            _sample_unode(unode, 0, unode->n_kmers(this->_K));
+            switch_unode_ends(unode->left_end(), new_left_end);
+            node_index.insert(new_right_end, INDEX_UNODE_END, _unode_slot(unode));
+
+            unode->set_left_end(new_left_end);
             unode->set_right_end(new_right_end);
-            unode->sequence = unode->sequence.substr(0, split_at + this->_K - 1);
-            
+            _invalidate_ends(unode);
+            _recount_coverage(unode, n_kmers);
+            _connect_unode(unode, find_unode_neighbors(unode));
+
             metrics->n_splits.Increment();
-            metrics->decrement_cdbg_node(unode->meta());
-            auto meta = recompute_node_meta(unode);
-            metrics->increment_cdbg_node(meta);
-            unode->set_node_meta(meta);
+            unode->set_node_meta(FULL);
+            metrics->decrement_cdbg_node(CIRCULAR);
+            metrics->increment_cdbg_node(FULL);
             ++_n_updates;
+
+            notify_history_split_circular(unode->node_id, unode->sequence, unode->meta());
+            pdebug("SPLIT complete (CIRCULAR): " << *unode);
+            return;
+
         }
+        pdebug("SPLIT: " << new_right_end << " left of root, "
+                << new_left_end << " right of root, at " << split_at
+                << std::endl << *unode);
+
+        assert((split_at != 0) && (split_at != unode->sequence.size() - this->_K));
+        std::string right_unitig = unode->sequence.substr(split_at + 1);
+
+        // set the left unode right end to the new right end
+        hash_t right_unode_right_end = unode->right_end();
+        switch_unode_ends(unode->right_end(), new_right_end);
+        _invalidate_end(unode, DIR_RIGHT);
+        unode->set_right_end(new_right_end);
+        unode->sequence.truncate(split_at + this->_K - 1);
+        _prune_samples(unode);
+        _invalidate_end(unode, DIR_RIGHT);
+        _recount_coverage(unode, n_kmers);
+        
+        metrics->n_splits.Increment();
+        metrics->decrement_cdbg_node(unode->meta());
+        auto meta = recompute_node_meta(unode);
+        metrics->increment_cdbg_node(meta);
+        unode->set_node_meta(meta);
+        ++_n_updates;
 
-        std::vector<hash_t> tags; // TODO: WARNING: broken
-        auto new_node = build_unode(right_unitig,
-                                    tags,
-                                    new_left_end,
-                                    right_unode_right_end);
+        auto new_node = _build_unode(right_unitig,
+                                     new_left_end,
+                                     right_unode_right_end);
+        new_node->set_coverage(_kept_count(new_node, kmer_count, n_kmers),
+                               read_count);
 
         notify_history_split(unode->node_id, unode->node_id, new_node->node_id,
                          unode->sequence, new_node->sequence,
@@ -688,31 +1022,23 @@ public:
     void merge_unodes(const std::string& span_sequence,
                       size_t n_span_kmers,
                       hash_t left_end,
-                      hash_t right_end,
-                      std::vector<hash_t>& new_tags) {
+                      hash_t right_end) {
         /* span_sequence is the (K * 2) - 2 sequence connecting the two unitigs
          *
          */
 
-        UnitigNode *left_unode, *right_unode;
-        std::string right_sequence;
-        hash_t new_right_end;
-
-        {
-            auto lock = lock_nodes();
-
-            auto left_unode_it = unitig_end_map.find(left_end);
-            if (left_unode_it == unitig_end_map.end()) {
-                return;
-            }
+        // held to the end: a snapshot must not see the right unitig
+        // deleted before the left has taken its sequence
+        auto lock = lock_nodes();
 
-            auto right_unode_it = unitig_end_map.find(right_end);
-            if (right_unode_it == unitig_end_map.end()) {
-                return;
-            }
+        UnitigNode * left_unode = query_unode_end(left_end);
+        if (left_unode == nullptr) {
+            return;
+        }
 
-            left_unode = left_unode_it->second;
-            right_unode = right_unode_it->second;
+        UnitigNode * right_unode = query_unode_end(right_end);
+        if (right_unode == nullptr) {
+            return;
         }
 
         auto rid = right_unode->node_id;
@@ -726,17 +1052,17 @@ public:
                 pdebug("Overlap between merged sequence, trimming right " << n_span_kmers);
                 extend = span_sequence.substr(this->_K-1, n_span_kmers);
             //} 
-            extend_unode(DIR_RIGHT,
-                         extend,
-                         left_end, // this is left_unode's right_end
-                         left_unode->left_end(),
-                         new_tags);
+            _extend_unode(DIR_RIGHT,
+                          extend,
+                          left_end, // this is left_unode's right_end
+                          left_unode->left_end());
         } else {
 
             pdebug("MERGE: " << left_end << " to " << right_end
                    << " with " << span_sequence 
                    << std::endl << *left_unode << std::endl << *right_unode);
 
+            std::string right_sequence;
             if (n_span_kmers < this->_K - 1) {
                 size_t trim = (this->_K - 1) - n_span_kmers;
                 pdebug("Overlap between merged sequence, trimming right " << trim);
@@ -744,18 +1070,18 @@ public:
             } else {
                 pdebug("No overlap, adding segment sequence, " << n_span_kmers);
                 right_sequence = span_sequence.substr(this->_K - 1, n_span_kmers - this->_K + 1)
-                                                       + right_unode->sequence;
+                                                       + right_unode->sequence.str();
             }
-            std::copy(right_unode->tags.begin(), right_unode->tags.end(),
-                      std::back_inserter(new_tags));
-            new_right_end = right_unode->right_end();
-
-            delete_unode(right_unode);
-            extend_unode(DIR_RIGHT,
-                         right_sequence,
-                         left_end,
-                         new_right_end,
-                         new_tags);
+            hash_t new_right_end = right_unode->right_end();
+            uint64_t right_kmer_count = right_unode->kmer_count();
+            uint64_t right_read_count = right_unode->read_count();
+
+            delete_unode(right_unode, true);
+            _extend_unode(DIR_RIGHT,
+                          right_sequence,
+                          left_end,
+                          new_right_end);
+            left_unode->add_coverage(right_kmer_count, right_read_count);
             metrics->n_merges.Increment();
 
         }
@@ -768,18 +1094,27 @@ public:
     }
 
 
-    void delete_unode(UnitigNode * unode) {
+    /* Remove unode. absorbed means its k-mers now belong to a
+     * neighboring node, as in merges and clips, so its component
+     * cannot have come apart; otherwise the removal goes in the history.
+     */
+    void delete_unode(UnitigNode * unode, bool absorbed=false) {
         if (unode != nullptr) {
             pdebug("Deleting " << *unode);
             id_t id = unode->node_id;
+            component_index.remove(unode, absorbed, _component_lookup());
             metrics->decrement_cdbg_node(unode->meta());
-            for (hash_t tag: unode->tags) {
-                unitig_tag_map.erase(tag);
+            _erase_samples(unode);
+            node_index.erase(unode->left_end(), INDEX_UNODE_END);
+            node_index.erase(unode->right_end(), INDEX_UNODE_END);
+            _invalidate_ends(unode);
+
+            if (!absorbed) {
+                notify_history_delete(id, unode->meta());
             }
-            unitig_end_map.erase(unode->left_end());
-            unitig_end_map.erase(unode->right_end());
 
-            unitig_nodes.erase(id);
+            unitig_nodes.erase(_unode_slot(unode));
+            unitig_slots.erase(id);
             unode = nullptr;
             _n_unitig_nodes--;
             _n_updates++;
@@ -797,73 +1132,210 @@ public:
         }
     }
 
-    void delete_dnode(DecisionNode * dnode) {
+    void delete_dnode(DecisionNode * dnode, bool absorbed=false) {
         if (dnode != nullptr) {
             pdebug("Deleting " << *dnode);
             id_t id = dnode->node_id;
+            component_index.remove(dnode, absorbed, _component_lookup());
             metrics->n_dnodes.Decrement();
             metrics->n_deletes.Increment();
+            if (!absorbed) {
+                notify_history_delete(id, dnode->meta());
+            }
             
-            decision_nodes.erase(id);
+            uint64_t slot;
+            if (node_index.find(id, INDEX_DNODE, slot)) {
+                node_index.erase(id, INDEX_DNODE);
+                invalidate_near(dnode->sequence.str());
+                decision_nodes.erase(slot);
+            }
             dnode = nullptr;
 
             _n_updates++;
         }
     }
 
-    void notify_history_new(id_t id, std::string& sequence, node_meta_t meta) {
-        auto event = make_shared<events::HistoryNewEvent>();
+    /* Credit one observation to the node holding each k-mer of a
+     * sequence that has just been compacted and inserted; hashes are
+     * its k-mer hashes in order. A unitig's interior k-mers have one
+     * neighbor each way, so once a k-mer is placed by a tag or an end,
+     * the sequence follows the unitig to its right end or its own; the
+     * k-mers before the first such anchor belong to the same unitig, and
+     * only a run with no anchor at all falls back to query_unode_kmer.
+     */
+    void add_coverage(const std::string& sequence,
+                      const std::vector<hash_t>& hashes) {
+        auto lock = lock_nodes();
+
+        std::vector<id_t> covered;
+        UnitigNode * owner = nullptr;
+        uint64_t n_pending = 0;
+        size_t run_start = 0;
+
+        auto credit = [&]() {
+            if (n_pending && owner == nullptr) {
+                owner = query_unode_kmer(sequence.substr(run_start, this->_K)).first;
+            }
+            if (owner != nullptr && n_pending) {
+                bool first = std::find(covered.begin(), covered.end(),
+                                       owner->node_id) == covered.end();
+                if (first) {
+                    covered.push_back(owner->node_id);
+                }
+                owner->add_coverage(n_pending, first);
+            }
+            n_pending = 0;
+        };
+
+        for (size_t i = 0; i < hashes.size(); ++i) {
+            DecisionNode * dnode = nullptr;
+            UnitigNode * anchor = nullptr;
+            node_index.probe(hashes[i], [&](node_index_t kind, uint64_t slot) {
+                if (kind == INDEX_UNODE_END) {
+                    anchor = unitig_nodes.at(slot);
+                    return true;
+                }
+                dnode = decision_nodes.at(slot);
+                return false;
+            });
+
+            if (anchor == nullptr && dnode != nullptr) {
+                credit();
+                owner = nullptr;
+                dnode->incr_count();
+                continue;
+            }
+
+            int64_t offset = 0;
+            if (anchor != nullptr) {
+                if (hashes[i] == anchor->right_end()) {
+                    offset = anchor->n_kmers(this->_K) - 1;
+                }
+            } else {
+                id_t id;
+                int64_t coord;
+                if (position_index.find(hashes[i], id, coord)) {
+                    anchor = query_unode_id(id);
+                    offset = coord - anchor->origin();
+                }
+            }
+            if (owner == nullptr && n_pending == 0) {
+                run_start = i;
+            }
+            ++n_pending;
+            if (anchor == nullptr) {
+                continue;
+            }
+            if (anchor != owner) {
+                if (owner != nullptr) {
+                    --n_pending;
+                    credit();
+                    n_pending = 1;
+                }
+                owner = anchor;
+            }
+
+            int64_t n_after = (int64_t)anchor->n_kmers(this->_K) - 1 - offset;
+            if (n_after <= 0) {
+                continue;
+            }
+            size_t skip = std::min<size_t>(n_after, hashes.size() - 1 - i);
+            if (skip == (size_t)n_after && hashes[i + skip] != anchor->right_end()) {
+                continue;
+            }
+            n_pending += skip;
+            i += skip;
+        }
+        credit();
+    }
+
+    template <class SequenceType>
+    void notify_history_new(id_t id, const SequenceType& sequence, node_meta_t meta) {
+        if (!this->wants(events::MSG_HISTORY_NEW)) {
+            return;
+        }
+        auto event = events::make_event<events::HistoryNewEvent>();
         event->id = id;
-        event->sequence = sequence;
+        event->sequence = _history_sequences.add(sequence);
         event->meta = meta;
         this->notify(event);
     }
 
+    template <class SequenceType>
     void notify_history_merge(id_t lparent, id_t rparent, id_t child,
-                          std::string& sequence, node_meta_t meta) {
-        auto event = make_shared<events::HistoryMergeEvent>();
+                          const SequenceType& sequence, node_meta_t meta) {
+        if (!this->wants(events::MSG_HISTORY_MERGE)) {
+            return;
+        }
+        auto event = events::make_event<events::HistoryMergeEvent>();
         event->lparent = lparent;
         event->rparent = rparent;
         event->child = child;
         event->meta = meta;
-        event->sequence = sequence;
+        event->sequence = _history_sequences.add(sequence);
         this->notify(event);
     }
 
-    void notify_history_extend(id_t id, std::string& sequence, node_meta_t meta) {
-        auto event = make_shared<events::HistoryExtendEvent>();
+    template <class SequenceType>
+    void notify_history_extend(id_t id, const SequenceType& sequence, node_meta_t meta) {
+        if (!this->wants(events::MSG_HISTORY_EXTEND)) {
+            return;
+        }
+        auto event = events::make_event<events::HistoryExtendEvent>();
         event->id = id;
-        event->sequence = sequence;
+        event->sequence = _history_sequences.add(sequence);
         event->meta = meta;
         this->notify(event);
     }
 
-    void notify_history_clip(id_t id, std::string& sequence, node_meta_t meta) {
-        auto event = make_shared<events::HistoryClipEvent>();
+    template <class SequenceType>
+    void notify_history_clip(id_t id, const SequenceType& sequence, node_meta_t meta) {
+        if (!this->wants(events::MSG_HISTORY_CLIP)) {
+            return;
+        }
+        auto event = events::make_event<events::HistoryClipEvent>();
         event->id = id;
-        event->sequence = sequence;
+        event->sequence = _history_sequences.add(sequence);
         event->meta = meta;
         this->notify(event);
     }
 
+    template <class SequenceType>
     void notify_history_split(id_t parent, id_t lchild, id_t rchild,
-                          std::string& lsequence, std::string& rsequence,
+                          const SequenceType& lsequence, const SequenceType& rsequence,
                           node_meta_t lmeta, node_meta_t rmeta) {
-        auto event = make_shared<events::HistorySplitEvent>();
+        if (!this->wants(events::MSG_HISTORY_SPLIT)) {
+            return;
+        }
+        auto event = events::make_event<events::HistorySplitEvent>();
         event->parent = parent;
         event->lchild = lchild;
         event->rchild = rchild;
-        event->lsequence = lsequence;
-        event->rsequence = rsequence;
+        event->lsequence = _history_sequences.add(lsequence);
+        event->rsequence = _history_sequences.add(rsequence);
         event->lmeta = lmeta;
         event->rmeta = rmeta;
         this->notify(event);
     }
 
-    void notify_history_split_circular(id_t id, std::string& sequence, node_meta_t meta) {
-        auto event = make_shared<events::HistorySplitCircularEvent>();
+    void notify_history_delete(id_t id, node_meta_t meta) {
+        if (!this->wants(events::MSG_HISTORY_DELETE)) {
+            return;
+        }
+        auto event = events::make_event<events::HistoryDeleteEvent>();
         event->id = id;
-        event->sequence = sequence;
+        event->meta = meta;
+        this->notify(event);
+    }
+
+    template <class SequenceType>
+    void notify_history_split_circular(id_t id, const SequenceType& sequence, node_meta_t meta) {
+        if (!this->wants(events::MSG_HISTORY_SPLIT_CIRCULAR)) {
+            return;
+        }
+        auto event = events::make_event<events::HistorySplitCircularEvent>();
+        event->id = id;
+        event->sequence = _history_sequences.add(sequence);
         event->meta = meta;
         this->notify(event);
     }
@@ -892,136 +1364,234 @@ public:
     
     }
 
-    void write(const std::string& filename, cDBGFormat format) {
+    /* Binary snapshot of the nodes, their sampled tags and the counters.
+     * The dBG is not included; a snapshot should be loaded over a dBG
+     * holding the same k-mers.
+     */
+    void save(const std::string& filename) {
+        std::ofstream out(filename, std::ios::binary);
+        if (!out.is_open()) {
+            throw BoinkFileException("Cannot open cDBG snapshot file: " + filename);
+        }
+
+        auto lock = lock_nodes();
+
+        out.write(CDBG_SAVED_SIGNATURE, 4);
+        uint8_t version = CDBG_SAVED_FORMAT_VERSION;
+        out.write((const char *) &version, sizeof(version));
+        out.write((const char *) &this->_K, sizeof(this->_K));
+        out.write((const char *) &_sample_window, sizeof(_sample_window));
+        out.write((const char *) &_n_updates, sizeof(_n_updates));
+        out.write((const char *) &_unitig_id_counter, sizeof(_unitig_id_counter));
+        id_t next_component_id = component_index.next_id();
+        out.write((const char *) &next_component_id, sizeof(next_component_id));
+
+        uint64_t n_dnodes = decision_nodes.size();
+        uint64_t n_unodes = unitig_nodes.size();
+        out.write((const char *) &n_dnodes, sizeof(n_dnodes));
+        out.write((const char *) &n_unodes, sizeof(n_unodes));
+
+        for (auto it = decision_nodes.begin(); it != decision_nodes.end(); ++it) {
+            it->second->save(out);
+        }
+
+        std::vector<std::pair<hash_t, int64_t>> tags;
+        for (auto it = unitig_nodes.begin(); it != unitig_nodes.end(); ++it) {
+            auto unode = it->second.get();
+            unode->save(out);
+
+            tags.clear();
+            for (auto tag : unode->tags) {
+                id_t id;
+                int64_t coord;
+                if (position_index.find(tag, id, coord) && id == unode->node_id) {
+                    tags.emplace_back(tag, coord);
+                }
+            }
+            uint64_t n_tags = tags.size();
+            out.write((const char *) &n_tags, sizeof(n_tags));
+            for (auto& tag : tags) {
+                out.write((const char *) &tag.first, sizeof(tag.first));
+                out.write((const char *) &tag.second, sizeof(tag.second));
+            }
+        }
+
+        if (out.fail()) {
+            throw BoinkFileException("Error writing cDBG snapshot file: " + filename);
+        }
+    }
+
+    /* Load a snapshot into this cDBG, which must be empty. The indices
+     * and node gauges are rebuilt; no history events are emitted.
+     */
+    void load(const std::string& filename) {
+        std::ifstream in;
+        in.exceptions(std::ifstream::failbit | std::ifstream::badbit |
+                      std::ifstream::eofbit);
+        try {
+            in.open(filename, std::ios::binary);
+        } catch (std::ifstream::failure &e) {
+            throw BoinkFileException("Cannot open cDBG snapshot file: " + filename);
+        }
+
+        auto lock = lock_nodes();
+        if (decision_nodes.size() || unitig_nodes.size()) {
+            throw BoinkException("Can only load a cDBG snapshot into an empty cDBG");
+        }
+
+        try {
+            char signature[4];
+            uint8_t version;
+            uint16_t K;
+            in.read(signature, 4);
+            in.read((char *) &version, sizeof(version));
+            if (std::string(signature, 4) != CDBG_SAVED_SIGNATURE) {
+                throw BoinkFileException("Not a cDBG snapshot file: " + filename);
+            }
+            if (version != CDBG_SAVED_FORMAT_VERSION) {
+                throw BoinkFileException("Incorrect cDBG snapshot version "
+                                         + std::to_string(version) + " in "
+                                         + filename);
+            }
+            in.read((char *) &K, sizeof(K));
+            if (K != this->_K) {
+                throw BoinkFileException("cDBG snapshot has K=" + std::to_string(K)
+                                         + ", expected " + std::to_string(this->_K));
+            }
+
+            in.read((char *) &_sample_window, sizeof(_sample_window));
+            in.read((char *) &_n_updates, sizeof(_n_updates));
+            in.read((char *) &_unitig_id_counter, sizeof(_unitig_id_counter));
+            id_t next_component_id;
+            in.read((char *) &next_component_id, sizeof(next_component_id));
+            component_index.set_next_id(next_component_id);
+
+            uint64_t n_dnodes, n_unodes;
+            in.read((char *) &n_dnodes, sizeof(n_dnodes));
+            in.read((char *) &n_unodes, sizeof(n_unodes));
+
+            for (uint64_t i = 0; i < n_dnodes; ++i) {
+                auto dnode = DecisionNode::load(in);
+                hash_t hash = dnode->node_id;
+                auto slot = decision_nodes.insert(hash, std::move(dnode));
+                node_index.insert(hash, INDEX_DNODE, slot);
+                component_index.insert(decision_nodes.at(slot));
+                metrics->n_dnodes.Increment();
+            }
+
+            for (uint64_t i = 0; i < n_unodes; ++i) {
+                auto unode = UnitigNode::load(in);
+                id_t id = unode->node_id;
+                uint64_t n_tags;
+                in.read((char *) &n_tags, sizeof(n_tags));
+                for (uint64_t t = 0; t < n_tags; ++t) {
+                    hash_t tag;
+                    int64_t coord;
+                    in.read((char *) &tag, sizeof(tag));
+                    in.read((char *) &coord, sizeof(coord));
+                    unode->tags.push_back(tag);
+                    position_index.insert(tag, id, coord);
+                }
+                hash_t left_end = unode->left_end();
+                hash_t right_end = unode->right_end();
+                metrics->n_unodes.Increment();
+                metrics->increment_cdbg_node(unode->meta());
+                auto slot = unitig_nodes.insert(id, std::move(unode));
+                unitig_slots.insert(id, slot);
+                node_index.insert(left_end, INDEX_UNODE_END, slot);
+                node_index.insert(right_end, INDEX_UNODE_END, slot);
+                component_index.insert(unitig_nodes.at(slot));
+                ++_n_unitig_nodes;
+            }
+        } catch (std::ifstream::failure &e) {
+            throw BoinkFileException("Unexpected end of cDBG snapshot file: " + filename);
+        }
+    }
+
+    void write(const std::string& filename, cDBGFormat format,
+               unsigned int n_threads=1) {
         std::ofstream out;
         out.open(filename);
-        write(out, format);
+        write(out, format, n_threads);
         out.close();
     }
 
-    void write(std::ofstream& out, cDBGFormat format) {
+    void write(std::ofstream& out, cDBGFormat format,
+               unsigned int n_threads=1) {
         switch (format) {
             case GRAPHML:
                 write_graphml(out);
                 break;
             case FASTA:
-                write_fasta(out);
+                write_fasta(out, n_threads);
                 break;
             case GFA1:
-                write_gfa1(out);
+                write_gfa1(out, n_threads);
                 break;
             default:
                 throw BoinkException("Invalid cDBG format.");
         };
     }
 
-    void write_fasta(const std::string& filename) {
-        std::ofstream out;
-        out.open(filename);
-        write_fasta(out);
-        out.close();
-    }
-
-    void write_fasta(std::ofstream& out) {
-        auto lock = lock_nodes();
-
-        for (auto it = unitig_nodes.begin(); it != unitig_nodes.end(); ++it) {
-            out << ">ID=" << it->first 
-                << " L=" << it->second->sequence.length()
-                << " type=" << node_meta_repr(it->second->meta())
-                << std::endl
-                << it->second->sequence
-                << std::endl;
-        }
-    }
-
-    void write_gfa1(const std::string& filename) {
+    void write_fasta(const std::string& filename, unsigned int n_threads=1) {
         std::ofstream out;
         out.open(filename);
-        write_gfa1(out);
+        write_fasta(out, n_threads);
         out.close();
     }
 
-    void write_gfa1(std::ofstream& out) {
+    /* Copy the nodes and their links as of now. Only this copy holds
+     * the lock; formatting a snapshot does not, so writers built on it
+     * do not stall updates.
+     */
+    cDBGSnapshot snapshot() {
         auto lock = lock_nodes();
 
-        gfak::GFAKluge gfa;
+        cDBGSnapshot snap(this->_K, _n_updates);
+        snap.unitig_nodes.reserve(_n_unitig_nodes);
         for (auto it = unitig_nodes.begin(); it != unitig_nodes.end(); ++it) {
-            gfak::sequence_elem s;
-            s.sequence = it->second->sequence;
-            s.name = it->second->get_name();
-
-            gfak::opt_elem ln_elem;
-            ln_elem.key = "LN";
-            ln_elem.val = std::to_string(it->second->sequence.length());
-            ln_elem.type = "i";
-            s.opt_fields.push_back(ln_elem);
-
-            gfa.add_sequence(s);
+            const UnitigNode * unode = it->second.get();
+            snap.unitig_nodes.push_back({unode->node_id,
+                                         unode->meta(),
+                                         unode->sequence,
+                                         unode->kmer_count(),
+                                         unode->read_count()});
         }
 
+        snap.decision_nodes.reserve(decision_nodes.size());
         for (auto it = decision_nodes.begin(); it != decision_nodes.end(); ++it) {
-            gfak::sequence_elem s;
-            s.sequence = it->second->sequence;
-            s.name = it->second->get_name();
-
-            gfak::opt_elem ln_elem;
-            ln_elem.key = "LN";
-            ln_elem.val = std::to_string(it->second->sequence.length());
-            ln_elem.type = "i";
-            s.opt_fields.push_back(ln_elem);
-
-            gfa.add_sequence(s);
-        }
-
-        auto get_link_name = [](id_t l, id_t r) { return std::string("LINK-") +
-                                                         std::to_string(l) +
-                                                         "-" +
-                                                         std::to_string(r); };
-
-        for (auto it = decision_nodes.begin(); it != decision_nodes.end(); ++it) {
-            std::string root = it->second->get_name();
-            auto neighbors = find_dnode_neighbors(it->second.get());
-
+            DecisionNode * dnode = it->second.get();
+            snap.decision_nodes.push_back({dnode->node_id,
+                                           dnode->meta(),
+                                           dnode->sequence,
+                                           dnode->count(),
+                                           0});
+            auto neighbors = find_dnode_neighbors(dnode);
             for (auto in_node : neighbors.first) {
-
-                gfak::link_elem l;
-                l.source_name = in_node->get_name();
-                l.sink_name = root;
-                l.source_orientation_forward = true;
-                l.sink_orientation_forward = true;
-                l.cigar = std::to_string(_K) + "M";
-
-                std::string link_name = get_link_name(in_node->node_id, it->second->node_id);
-                gfak::opt_elem id_elem;
-                id_elem.key = "ID";
-                id_elem.type = "Z";
-                id_elem.val = link_name;
-                l.opt_fields["ID"] = id_elem;
-
-                gfa.add_link(in_node->get_name(), l);
+                snap.links.emplace_back(in_node->node_id, dnode->node_id);
             }
             for (auto out_node : neighbors.second) {
-
-                gfak::link_elem l;
-                l.source_name = root;
-                l.sink_name = out_node->get_name();
-                l.source_orientation_forward = true;
-                l.sink_orientation_forward = true;
-                l.cigar = std::to_string(_K) + "M";
-
-                std::string link_name = get_link_name(it->second->node_id, out_node->node_id);
-                gfak::opt_elem id_elem;
-                id_elem.key = "ID";
-                id_elem.type = "Z";
-                id_elem.val = link_name;
-                l.opt_fields["ID"] = id_elem;
-                gfa.add_link(root, l);
+                snap.links.emplace_back(dnode->node_id, out_node->node_id);
             }
         }
-        out << gfa;
+
+        return snap;
     }
 
+    void write_fasta(std::ostream& out, unsigned int n_threads=1) {
+        snapshot().write_fasta(out, n_threads);
+    }
+
+    void write_gfa1(const std::string& filename, unsigned int n_threads=1) {
+        std::ofstream out;
+        out.open(filename);
+        write_gfa1(out, n_threads);
+        out.close();
+    }
+
+    void write_gfa1(std::ostream& out, unsigned int n_threads=1) {
+        snapshot().write_gfa1(out, n_threads);
+    }
 
     void write_graphml(const std::string& filename,
                        const std::string graph_name="cDBG") {
@@ -1121,7 +1691,7 @@ public:
                 {
                     auto * data = static_cast<BuildDNodeEvent*>(event.get());
                     auto lock = this->lock_dnodes();
-                    this->build_dnode(data->hash, data->kmer);
+                    this->build_dnode(data->hash, data->kmer, 1);
                 }
                 return;
             case boink::event_types::MSG_ADD_UNODE:
@@ -13,11 +13,14 @@
 #include <climits>
 #include <string>
 #include <iostream>
+#include <memory>
 #include <sstream>
 #include <vector>
 
 #include "boink/boink.hh"
 #include "boink/hashing/alphabets.hh"
+#include "boink/cdbg/node_pool.hh"
+#include "boink/cdbg/packed_sequence.hh"
 
 #define NULL_ID             ULLONG_MAX
 #define UNITIG_START_ID     0
@@ -105,6 +108,37 @@ enum update_meta_t {
 };
 
 
+/* Up to four neighbors on one side of a d-node, by node ID. */
+struct neighbor_ids_t {
+    id_t    ids[4];
+    uint8_t n;
+    // bit i is set when ids[i] is a d-node
+    uint8_t dnode_mask;
+
+    neighbor_ids_t()
+        : n(0),
+          dnode_mask(0)
+    {
+    }
+
+    void clear() {
+        n = 0;
+        dnode_mask = 0;
+    }
+
+    void push_back(id_t id, bool is_dnode) {
+        if (n < 4) {
+            dnode_mask |= uint8_t(is_dnode) << n;
+            ids[n++] = id;
+        }
+    }
+
+    bool is_dnode(uint8_t i) const {
+        return dnode_mask >> i & 1;
+    }
+};
+
+
 class CompactNode {
 
 protected:
@@ -115,7 +149,10 @@ public:
 
     const id_t node_id;
     id_t component_id;
-    std::string sequence;
+    // whether the cached neighbors below are current; see
+    // cDBG::invalidate_near
+    bool adjacency_valid;
+    PackedSequence sequence;
     
     CompactNode(id_t node_id,
                 const std::string& sequence,
@@ -123,12 +160,13 @@ public:
         : _meta(meta),
           node_id(node_id),
           component_id(NULL_ID),
+          adjacency_valid(false),
           sequence(sequence)
     {
     }
 
     std::string revcomp() const {
-        return hashing::revcomp(sequence);
+        return hashing::revcomp(sequence.str());
     }
 
     size_t length() const {
@@ -161,6 +199,10 @@ protected:
 
 public:
 
+    // adjacent nodes: d-nodes, and unitigs by the end facing this node
+    neighbor_ids_t left_neighbors;
+    neighbor_ids_t right_neighbors;
+
     DecisionNode(id_t node_id, const std::string& sequence)
         : CompactNode(node_id, sequence, DECISION),
           _dirty(true),
@@ -170,6 +212,14 @@ public:
     {    
     }
 
+    static void * operator new(size_t size) {
+        return NodePool<DecisionNode>::instance().allocate(size);
+    }
+
+    static void operator delete(void * ptr, size_t size) {
+        NodePool<DecisionNode>::instance().deallocate(ptr, size);
+    }
+
     const bool is_dirty() const {
         return _dirty;
     }
@@ -186,6 +236,10 @@ public:
         _count++;
     }
 
+    void set_count(uint32_t count) {
+        _count = count;
+    }
+
     const uint8_t degree() const {
         return left_degree() + right_degree();
     }
@@ -206,6 +260,32 @@ public:
         _right_degree++;
     }
 
+    void save(std::ostream& out) const {
+        uint8_t dirty = _dirty;
+        out.write((const char *) &node_id, sizeof(node_id));
+        out.write((const char *) &component_id, sizeof(component_id));
+        out.write((const char *) &_count, sizeof(_count));
+        out.write((const char *) &_left_degree, sizeof(_left_degree));
+        out.write((const char *) &_right_degree, sizeof(_right_degree));
+        out.write((const char *) &dirty, sizeof(dirty));
+        sequence.save(out);
+    }
+
+    static std::unique_ptr<DecisionNode> load(std::istream& in) {
+        id_t node_id;
+        uint8_t dirty;
+        in.read((char *) &node_id, sizeof(node_id));
+        auto dnode = std::make_unique<DecisionNode>(node_id, "");
+        in.read((char *) &dnode->component_id, sizeof(dnode->component_id));
+        in.read((char *) &dnode->_count, sizeof(dnode->_count));
+        in.read((char *) &dnode->_left_degree, sizeof(dnode->_left_degree));
+        in.read((char *) &dnode->_right_degree, sizeof(dnode->_right_degree));
+        in.read((char *) &dirty, sizeof(dirty));
+        dnode->_dirty = dirty;
+        dnode->sequence.load(in);
+        return dnode;
+    }
+
     std::string repr() const {
         std::ostringstream os;
         os << *this;
@@ -232,10 +312,21 @@ class UnitigNode : public CompactNode {
 protected:
 
     hash_t _left_end, _right_end;
+    // coordinate of the first base; moves as the unitig grows or is
+    // clipped on the left, so coordinates of interior k-mers are stable
+    int64_t _origin;
+    // observations of the unitig's k-mers, summed, and the number of
+    // sequences that covered it; see cDBG::add_coverage
+    uint64_t _kmer_count;
+    uint64_t _read_count;
 
 public:
 
+    // hashes of the k-mers sampled into the cDBG's position index
     std::vector<hash_t> tags;
+    // adjacent d-nodes, or NULL_ID
+    id_t left_dnode;
+    id_t right_dnode;
 
     UnitigNode(id_t node_id,
                hash_t left_end,
@@ -243,7 +334,20 @@ public:
                const std::string& sequence)
         : CompactNode(node_id, sequence, ISLAND),
           _left_end(left_end),
-          _right_end(right_end) { 
+          _right_end(right_end),
+          _origin(0),
+          _kmer_count(0),
+          _read_count(0),
+          left_dnode(NULL_ID),
+          right_dnode(NULL_ID) { 
+    }
+
+    static void * operator new(size_t size) {
+        return NodePool<UnitigNode>::instance().allocate(size);
+    }
+
+    static void operator delete(void * ptr, size_t size) {
+        NodePool<UnitigNode>::instance().deallocate(ptr, size);
     }
 
     void set_node_meta(node_meta_t new_meta) {
@@ -259,23 +363,101 @@ public:
     }
 
     void extend_right(hash_t right_end, const std::string& new_sequence) {
-        sequence += new_sequence;
+        sequence.append(new_sequence);
         _right_end = right_end;
     }
 
     void extend_left(hash_t left_end, const std::string& new_sequence) {
-        sequence = new_sequence + sequence;
+        sequence.prepend(new_sequence);
+        _origin -= new_sequence.size();
+        _left_end = left_end;
+    }
+
+    void clip_left(hash_t left_end) {
+        sequence.trim_left(1);
+        ++_origin;
         _left_end = left_end;
     }
 
+    void clip_right(hash_t right_end) {
+        sequence.trim_right(1);
+        _right_end = right_end;
+    }
+
+    const int64_t origin() const {
+        return _origin;
+    }
+
+    size_t n_kmers(uint16_t K) const {
+        return sequence.size() < K ? 0 : sequence.size() - K + 1;
+    }
+
     const hash_t right_end() const {
         return _right_end;
     }
 
+    const uint64_t kmer_count() const {
+        return _kmer_count;
+    }
+
+    const uint64_t read_count() const {
+        return _read_count;
+    }
+
+    void add_coverage(uint64_t n_kmers, uint64_t n_reads) {
+        _kmer_count += n_kmers;
+        _read_count += n_reads;
+    }
+
+    void set_coverage(uint64_t kmer_count, uint64_t read_count) {
+        _kmer_count = kmer_count;
+        _read_count = read_count;
+    }
+
+    /* Mean observations per k-mer. */
+    double mean_coverage(uint16_t K) const {
+        size_t n = n_kmers(K);
+        return n ? double(_kmer_count) / n : 0.0;
+    }
+
     void set_right_end(hash_t right_end) {
         _right_end = right_end;
     }
 
+    /* Tags are left to the owner, which holds their coordinates. */
+    void save(std::ostream& out) const {
+        uint8_t meta = _meta;
+        out.write((const char *) &node_id, sizeof(node_id));
+        out.write((const char *) &component_id, sizeof(component_id));
+        out.write((const char *) &meta, sizeof(meta));
+        out.write((const char *) &_left_end, sizeof(_left_end));
+        out.write((const char *) &_right_end, sizeof(_right_end));
+        out.write((const char *) &_origin, sizeof(_origin));
+        out.write((const char *) &_kmer_count, sizeof(_kmer_count));
+        out.write((const char *) &_read_count, sizeof(_read_count));
+        sequence.save(out);
+    }
+
+    static std::unique_ptr<UnitigNode> load(std::istream& in) {
+        id_t node_id;
+        uint8_t meta;
+        in.read((char *) &node_id, sizeof(node_id));
+        auto unode = std::make_unique<UnitigNode>(node_id, 0, 0, "");
+        in.read((char *) &unode->component_id, sizeof(unode->component_id));
+        in.read((char *) &meta, sizeof(meta));
+        if (meta > DECISION) {
+            throw BoinkException("Corrupt UnitigNode meta");
+        }
+        unode->_meta = static_cast<node_meta_t>(meta);
+        in.read((char *) &unode->_left_end, sizeof(unode->_left_end));
+        in.read((char *) &unode->_right_end, sizeof(unode->_right_end));
+        in.read((char *) &unode->_origin, sizeof(unode->_origin));
+        in.read((char *) &unode->_kmer_count, sizeof(unode->_kmer_count));
+        in.read((char *) &unode->_read_count, sizeof(unode->_read_count));
+        unode->sequence.load(in);
+        return unode;
+    }
+
     std::string repr() const {
         std::ostringstream os;
         os << *this;
@@ -294,6 +476,8 @@ inline std::ostream& operator<<(std::ostream& o, const UnitigNode& un) {
       << " sequence=" << un.sequence
       << " length=" << un.sequence.length()
       << " meta=" << node_meta_repr(un.meta())
+      << " KC=" << un.kmer_count()
+      << " RC=" << un.read_count()
       << ">";
     return o;
 }
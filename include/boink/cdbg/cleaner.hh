@@ -0,0 +1,421 @@
+/* cleaner.hh -- tip clipping and bubble popping on a streaming cDBG
+ *
+ * Copyright (C) 2018 Camille Scott
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+
+#ifndef BOINK_CLEANER_HH
+#define BOINK_CLEANER_HH
+
+#include <algorithm>
+#include <limits>
+#include <memory>
+#include <set>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "boink/boink.hh"
+#include "boink/assembly.hh"
+#include "boink/dbg.hh"
+#include "boink/events.hh"
+#include "boink/event_types.hh"
+#include "boink/hashing/alphabets.hh"
+#include "boink/hashing/kmeriterator.hh"
+#include "boink/cdbg/cdbg.hh"
+#include "boink/cdbg/compactor.hh"
+#include "boink/storage/storage.hh"
+
+
+namespace boink {
+namespace cdbg {
+
+using namespace boink::hashing;
+
+
+/* Removes likely sequencing errors from a StreamingCompactor's cDBG:
+ * tips no longer than max_tip_length whose mean k-mer coverage is below
+ * min_tip_coverage, and the weak sides of bubbles, unitigs no longer
+ * than max_bubble_length between two d-nodes that are also joined by a
+ * path with at least 1 / bubble_coverage_ratio times their coverage. A
+ * tip is only clipped if its d-node branches on the tip's side too, so
+ * the end of a real path is never lost.
+ *
+ * The removed k-mers leave the dBG as well, so the compactor treats
+ * them as new if they turn up again; the storage must support removal.
+ * A d-node left without a branch is merged with its neighbors into one
+ * unitig. Removals go in the cDBG history as deletions, and the merges
+ * as merges into the new unitig.
+ *
+ * clean() can be called between updates, or the cleaner registered
+ * with a processor to clean at each TimeIntervalEvent of the given
+ * level; either way it holds the compactor's update lock throughout.
+ */
+template <class GraphType>
+class cDBGCleaner : public events::EventListener {
+
+protected:
+
+    using ShifterType   = typename GraphType::shifter_type;
+    using StorageType   = typename GraphType::storage_type;
+    using CompactorType = CompactorMixin<GraphType>;
+
+    shared_ptr<StreamingCompactor<GraphType>> compactor;
+    shared_ptr<cDBG<GraphType>>               cdbg;
+    shared_ptr<GraphType>                     dbg;
+    CompactorType                             walker;
+
+    uint16_t _K;
+    size_t   _max_tip_length;
+    double   _min_tip_coverage;
+    size_t   _max_bubble_length;
+    double   _bubble_coverage_ratio;
+    events::TimeIntervalEvent::interval_level_t _level;
+
+    uint64_t _n_tips_clipped;
+    uint64_t _n_bubbles_popped;
+    uint64_t _n_dnodes_merged;
+
+    template<typename U = GraphType>
+    auto _remove_kmers(const std::string& sequence)
+    -> std::enable_if_t<storage::supports_removal<typename U::storage_type>::value>
+    {
+        KmerIterator<ShifterType> kmers(sequence, _K);
+        while (!kmers.done()) {
+            dbg->remove(kmers.next());
+        }
+    }
+
+    template<typename U = GraphType>
+    auto _remove_kmers(const std::string& sequence)
+    -> std::enable_if_t<!storage::supports_removal<typename U::storage_type>::value>
+    {
+    }
+
+    /* Drop unode from the cDBG and its k-mers from the dBG; its d-nodes
+     * become candidates for merging. The caller holds the cDBG lock.
+     */
+    void _remove_unode(UnitigNode * unode, std::set<hash_t>& candidates) {
+        auto neighbors = cdbg->find_unode_neighbors(unode);
+        if (neighbors.first != nullptr) {
+            candidates.insert(neighbors.first->node_id);
+        }
+        if (neighbors.second != nullptr) {
+            candidates.insert(neighbors.second->node_id);
+        }
+        _remove_kmers(unode->sequence.str());
+        cdbg->delete_unode(unode);
+    }
+
+    bool _is_clippable(UnitigNode * unode) {
+        auto neighbors = cdbg->find_unode_neighbors(unode);
+        DecisionNode * dnode = neighbors.first != nullptr ? neighbors.first
+                                                          : neighbors.second;
+        if (dnode == nullptr || (neighbors.first != nullptr && neighbors.second != nullptr) ||
+            unode->sequence.size() > _max_tip_length ||
+            unode->mean_coverage(_K) >= _min_tip_coverage) {
+            return false;
+        }
+
+        auto branches = cdbg->find_dnode_neighbors(dnode);
+        for (auto side : {&branches.first, &branches.second}) {
+            if (std::find(side->begin(), side->end(), unode) != side->end()) {
+                return side->size() > 1;
+            }
+        }
+        return false;
+    }
+
+    uint64_t _clip_tips(std::set<hash_t>& candidates) {
+        std::vector<id_t> tips;
+        for (auto it = cdbg->unodes_begin(); it != cdbg->unodes_end(); ++it) {
+            auto meta = it->second->meta();
+            if (meta == TIP || meta == TRIVIAL) {
+                tips.push_back(it->first);
+            }
+        }
+
+        // re-checked one at a time, as clipping one tip can make its
+        // sibling the only branch left
+        uint64_t n_clipped = 0;
+        for (auto id : tips) {
+            UnitigNode * unode = cdbg->query_unode_id(id);
+            if (unode != nullptr && _is_clippable(unode)) {
+                _remove_unode(unode, candidates);
+                ++n_clipped;
+            }
+        }
+        return n_clipped;
+    }
+
+    /* The k-mer of dnode as it adjoins kmer, to the right of kmer if
+     * right is set and to its left otherwise.
+     */
+    std::string _adjoining(DecisionNode * dnode, const std::string& kmer, bool right) {
+        for (auto symbol : std::string("ACGT")) {
+            std::string neighbor = right ? kmer.substr(1) + symbol
+                                         : symbol + kmer.substr(0, _K - 1);
+            if (walker.hash(neighbor) == dnode->node_id) {
+                return neighbor;
+            }
+        }
+        return std::string();
+    }
+
+    /* Search out from source, in its orientation, for other paths of at
+     * most max_kmers k-mers to target which do not start with the k-mer
+     * hashed as excluded. Steps go a node at a time, and a bounded number
+     * are taken. Returns the best coverage of any path found, taking a
+     * path's coverage as that of its weakest node, or zero.
+     */
+    double _find_alternative(const std::string& source,
+                             const std::string& target,
+                             hash_t excluded,
+                             size_t max_kmers) {
+        struct frontier_t {
+            std::string kmer;
+            size_t      n_kmers;
+            double      coverage;
+        };
+        std::vector<frontier_t> stack{{source, 0, std::numeric_limits<double>::max()}};
+        double best = 0;
+        size_t budget = 64;
+
+        while (stack.size() && budget--) {
+            auto current = stack.back();
+            stack.pop_back();
+            for (auto symbol : std::string("ACGT")) {
+                std::string next = current.kmer.substr(1) + symbol;
+                hash_t h = walker.hash(next);
+                if ((current.n_kmers == 0 && h == excluded) || !dbg->query(h)) {
+                    continue;
+                }
+                if (next == target) {
+                    best = std::max(best, current.coverage);
+                    continue;
+                }
+
+                CompactNode * node = cdbg->query_cnode(h);
+                if (node == nullptr) {
+                    continue;
+                }
+                frontier_t step{next, current.n_kmers + 1, current.coverage};
+                if (node->meta() == DECISION) {
+                    step.coverage = std::min(step.coverage,
+                                             (double)static_cast<DecisionNode*>(node)->count());
+                } else {
+                    auto unode = static_cast<UnitigNode*>(node);
+                    std::string sequence = unode->sequence.str();
+                    if (sequence.compare(0, _K, next) != 0) {
+                        sequence = revcomp(sequence);
+                        if (sequence.compare(0, _K, next) != 0) {
+                            continue;
+                        }
+                    }
+                    step.kmer = sequence.substr(sequence.size() - _K);
+                    step.n_kmers = current.n_kmers + unode->n_kmers(_K);
+                    step.coverage = std::min(step.coverage, unode->mean_coverage(_K));
+                }
+                if (step.n_kmers <= max_kmers) {
+                    stack.push_back(step);
+                }
+            }
+        }
+        return best;
+    }
+
+    /* A unitig between two d-nodes is the weak side of a bubble if
+     * another path of no more than max_bubble_length leaves the first
+     * d-node on the same side and reaches the second from the same side,
+     * and its coverage is at most bubble_coverage_ratio of that path's.
+     */
+    bool _is_poppable(UnitigNode * unode) {
+        auto neighbors = cdbg->find_unode_neighbors(unode);
+        if (neighbors.first == nullptr || neighbors.second == nullptr ||
+            neighbors.first == neighbors.second) {
+            return false;
+        }
+
+        std::string sequence = unode->sequence.str();
+        std::string source = _adjoining(neighbors.first, sequence.substr(0, _K), false);
+        std::string target = _adjoining(neighbors.second,
+                                        sequence.substr(sequence.size() - _K), true);
+        if (source.empty() || target.empty()) {
+            return false;
+        }
+
+        double alternative = _find_alternative(source, target, unode->left_end(),
+                                               _max_bubble_length - _K + 1);
+        return alternative > 0 &&
+               unode->mean_coverage(_K) <= _bubble_coverage_ratio * alternative;
+    }
+
+    uint64_t _pop_bubbles(std::set<hash_t>& candidates) {
+        std::vector<std::pair<double, id_t>> paths;
+        for (auto it = cdbg->unodes_begin(); it != cdbg->unodes_end(); ++it) {
+            UnitigNode * unode = it->second.get();
+            auto meta = unode->meta();
+            if ((meta == FULL || meta == TRIVIAL) &&
+                unode->sequence.size() <= _max_bubble_length) {
+                paths.emplace_back(unode->mean_coverage(_K), it->first);
+            }
+        }
+
+        // weakest first, so that of two weak sides only one goes
+        std::sort(paths.begin(), paths.end());
+        uint64_t n_popped = 0;
+        for (auto& path : paths) {
+            UnitigNode * unode = cdbg->query_unode_id(path.second);
+            if (unode != nullptr && _is_poppable(unode)) {
+                _remove_unode(unode, candidates);
+                ++n_popped;
+            }
+        }
+        return n_popped;
+    }
+
+    /* Replace a d-node which no longer branches, and the nodes on
+     * either side of it, with the unitig through it in the dBG.
+     */
+    void _merge_dnode(const std::string& seed) {
+        std::string sequence;
+        hash_t left_end, right_end;
+        walker.compactify(seed, sequence, left_end, right_end);
+
+        std::vector<id_t> parents;
+        uint64_t kmer_count = 0, read_count = 0;
+        auto lock = cdbg->lock_nodes();
+        KmerIterator<ShifterType> kmers(sequence, _K);
+        while (!kmers.done()) {
+            hash_t h = kmers.next();
+            DecisionNode * dnode;
+            UnitigNode * unode;
+            if ((dnode = cdbg->query_dnode(h)) != nullptr) {
+                parents.push_back(dnode->node_id);
+                kmer_count += dnode->count();
+                cdbg->delete_dnode(dnode, true);
+            } else if ((unode = cdbg->query_unode_end(h)) != nullptr) {
+                parents.push_back(unode->node_id);
+                kmer_count += unode->kmer_count();
+                read_count += unode->read_count();
+                cdbg->delete_unode(unode, true);
+            }
+        }
+
+        UnitigNode * merged = cdbg->_build_unode(sequence, left_end, right_end);
+        merged->set_coverage(kmer_count, read_count);
+
+        id_t lparent = parents.front();
+        for (size_t i = std::min<size_t>(1, parents.size() - 1); i < parents.size(); ++i) {
+            cdbg->notify_history_merge(lparent, parents[i], merged->node_id,
+                                       merged->sequence, merged->meta());
+            lparent = merged->node_id;
+        }
+    }
+
+    uint64_t _merge_dnodes(const std::set<hash_t>& candidates) {
+        uint64_t n_merged = 0;
+        for (auto hash : candidates) {
+            std::string seed;
+            {
+                auto lock = cdbg->lock_nodes();
+                DecisionNode * dnode = cdbg->query_dnode(hash);
+                if (dnode == nullptr) {
+                    continue;
+                }
+                seed = dnode->sequence.str();
+            }
+            if (!walker.is_decision_kmer(seed)) {
+                _merge_dnode(seed);
+                ++n_merged;
+            }
+        }
+        return n_merged;
+    }
+
+public:
+
+    /* Lengths are in bases; zero means 2K for tips and 3K for bubbles.
+     */
+    cDBGCleaner(shared_ptr<StreamingCompactor<GraphType>> compactor,
+                size_t max_tip_length=0,
+                double min_tip_coverage=2.0,
+                size_t max_bubble_length=0,
+                double bubble_coverage_ratio=0.25,
+                events::TimeIntervalEvent::interval_level_t level =
+                    events::TimeIntervalEvent::MEDIUM)
+        : EventListener("cDBGCleaner"),
+          compactor(compactor),
+          cdbg(compactor->cdbg),
+          dbg(compactor->dbg),
+          walker(compactor->dbg),
+          _K(compactor->dbg->K()),
+          _max_tip_length(max_tip_length ? max_tip_length : 2 * _K),
+          _min_tip_coverage(min_tip_coverage),
+          _max_bubble_length(max_bubble_length ? max_bubble_length : 3 * _K),
+          _bubble_coverage_ratio(bubble_coverage_ratio),
+          _level(level),
+          _n_tips_clipped(0),
+          _n_bubbles_popped(0),
+          _n_dnodes_merged(0)
+    {
+        if (!storage::supports_removal<StorageType>::value) {
+            throw BoinkException("cDBGCleaner requires a dBG storage that supports removal.");
+        }
+
+        this->msg_type_whitelist.insert(events::MSG_TIME_INTERVAL);
+    }
+
+    /* Clip tips, pop bubbles, and merge the d-nodes that leaves without
+     * branches. Returns the number of unitigs removed.
+     */
+    uint64_t clean() {
+        auto update_lock = compactor->lock_updates();
+
+        std::set<hash_t> candidates;
+        uint64_t n_tips, n_bubbles;
+        {
+            auto lock = cdbg->lock_nodes();
+            n_tips = _clip_tips(candidates);
+            n_bubbles = _pop_bubbles(candidates);
+        }
+        _n_dnodes_merged += _merge_dnodes(candidates);
+
+        _n_tips_clipped += n_tips;
+        _n_bubbles_popped += n_bubbles;
+        return n_tips + n_bubbles;
+    }
+
+    uint64_t n_tips_clipped() const {
+        return _n_tips_clipped;
+    }
+
+    uint64_t n_bubbles_popped() const {
+        return _n_bubbles_popped;
+    }
+
+    uint64_t n_dnodes_merged() const {
+        return _n_dnodes_merged;
+    }
+
+    virtual void handle_msg(shared_ptr<events::Event> event) {
+        if (event->msg_type == events::MSG_TIME_INTERVAL) {
+            auto _event = static_cast<events::TimeIntervalEvent*>(event.get());
+            if (_event->level == _level) {
+                auto n_removed = clean();
+                _cerr(this->THREAD_NAME << ", t=" << _event->t <<
+                      ": removed " << n_removed << " unitigs.");
+            }
+        }
+    }
+};
+
+
+}
+}
+
+#endif
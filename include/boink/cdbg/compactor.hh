@@ -11,12 +11,16 @@
 #define BOINK_COMPACTOR_HH
 
 #include <assert.h>
+#include <exception>
+#include <mutex>
+#include <thread>
 
 #include "boink/assembly.hh"
 #include "boink/hashing/hashing_types.hh"
 #include "boink/hashing/kmeriterator.hh"
 #include "boink/dbg.hh"
 #include "boink/cdbg/cdbg.hh"
+#include "boink/metrics.hh"
 #include "boink/minimizers.hh"
 #include "boink/event_types.hh"
 #include "boink/reporting/report_types.hh"
@@ -36,6 +40,31 @@ using namespace boink::hashing;
 #   define pdebug(x) do {} while (0)
 # endif
 
+/* Per-stage timing of update_sequence, compiled in with
+ * BOINK_STAGE_TIMING. stage_lap(s) charges the time since the previous
+ * lap to stage s; stage_finish() records the whole update.
+ * stage_timed(s, statement) charges statement to s on a stopwatch of its
+ * own, for work done off the updating thread.
+ */
+# ifdef BOINK_STAGE_TIMING
+#   define stage_restart() this->_stage_timer.restart()
+#   define stage_lap(stage) this->stage_metrics->observe(stage, this->_stage_timer.lap())
+#   define stage_finish() do { \
+            this->stage_metrics->observe(STAGE_NOTIFY, this->cdbg->take_notify_ns()); \
+            this->stage_metrics->observe_update(this->_stage_timer.total()); \
+        } while (0)
+#   define stage_timed(stage, statement) do { \
+            boink::metrics::StageTimer _timer; \
+            statement; \
+            this->stage_metrics->observe(stage, _timer.lap()); \
+        } while (0)
+# else
+#   define stage_restart() do {} while (0)
+#   define stage_lap(stage) do {} while (0)
+#   define stage_finish() do {} while (0)
+#   define stage_timed(stage, statement) do { statement; } while (0)
+# endif
+
 
 /* Represents a segment of new k-mers from a sequence, relative to the current
  * state of the cDBG. Can either be: a null segment representing a portion
@@ -56,8 +85,6 @@ struct compact_segment {
     // length of the segment sequence (from beginning of first k-mer to
     // end of last k-mer)
     size_t length;
-    // tags associated with this segment
-    std::vector<hash_t> tags;
 
     // the default constructor creates a null segment
     compact_segment()
@@ -108,6 +135,98 @@ class StreamingCompactor : public CompactorMixin<GraphType>,
 protected:
 
     uint64_t _minimizer_window_size;
+    uint64_t _n_batch_conflicts;
+    // held for the whole of each update, so that the graph can be
+    // edited in between by someone else, like the cDBGCleaner
+    std::mutex _update_mutex;
+
+#ifdef BOINK_STAGE_TIMING
+    boink::metrics::StageTimer _stage_timer;
+#endif
+
+    // Result of optimistic segment discovery for one sequence; it is
+    // invalidated if any of its new k-mers, or any absent neighbor of a
+    // new k-mer or of the old k-mers flanking them (the footprint), is
+    // present in the dBG by the time it is applied.
+    struct segment_discovery {
+        bool                        valid;
+        std::vector<hash_t>         hashes;
+        std::set<hash_t>            new_kmers;
+        std::deque<compact_segment> segments;
+        std::set<hash_t>            new_decision_kmers;
+        std::deque<NeighborBundle>  decision_neighbors;
+        std::vector<hash_t>         footprint;
+
+        segment_discovery()
+            : valid(false)
+        {
+        }
+    };
+
+    void _add_footprint(typename GraphType::shifter_type * shifter,
+                        segment_discovery& discovery) {
+        for (auto neighbor : shifter->gather_left()) {
+            if (!discovery.new_kmers.count(neighbor.hash) &&
+                !dbg->query(neighbor.hash)) {
+                discovery.footprint.push_back(neighbor.hash);
+            }
+        }
+        for (auto neighbor : shifter->gather_right()) {
+            if (!discovery.new_kmers.count(neighbor.hash) &&
+                !dbg->query(neighbor.hash)) {
+                discovery.footprint.push_back(neighbor.hash);
+            }
+        }
+    }
+
+    void _discover(const std::string& sequence,
+                   segment_discovery& discovery) {
+        discovery = segment_discovery();
+        try {
+            find_new_segments(sequence,
+                              discovery.hashes,
+                              discovery.new_kmers,
+                              discovery.segments,
+                              discovery.new_decision_kmers,
+                              discovery.decision_neighbors);
+        } catch (InvalidCharacterException &e) {
+            return;
+        } catch (SequenceLengthException &e) {
+            return;
+        }
+
+        discovery.valid = true;
+        if (discovery.new_kmers.size() == 0) {
+            return;
+        }
+
+        // the segments also depend on the neighborhoods of the new k-mers
+        // and of the old k-mers next to them
+        const auto& hashes = discovery.hashes;
+        KmerIterator<typename GraphType::shifter_type> kmers(sequence, this->_K);
+        for (size_t i = 0; !kmers.done(); ++i) {
+            kmers.next();
+            if (discovery.new_kmers.count(hashes[i]) ||
+                (i > 0 && discovery.new_kmers.count(hashes[i-1])) ||
+                (i + 1 < hashes.size() && discovery.new_kmers.count(hashes[i+1]))) {
+                _add_footprint(kmers.shifter, discovery);
+            }
+        }
+    }
+
+    bool _is_stale(const segment_discovery& discovery) {
+        for (auto h : discovery.new_kmers) {
+            if (dbg->query(h)) {
+                return true;
+            }
+        }
+        for (auto h : discovery.footprint) {
+            if (dbg->query(h)) {
+                return true;
+            }
+        }
+        return false;
+    }
 
 public:
 
@@ -132,6 +251,8 @@ public:
 
     shared_ptr<GraphType> dbg;
     shared_ptr<cDBG<GraphType>> cdbg;
+    // null unless built with BOINK_STAGE_TIMING
+    shared_ptr<CompactorStageMetrics> stage_metrics;
 
     StreamingCompactor(shared_ptr<GraphType> dbg,
                        shared_ptr<prometheus::Registry> pr_registry,
@@ -139,11 +260,15 @@ public:
         : CompactorMixin<GraphType>(dbg),
           EventNotifier(),
           _minimizer_window_size(minimizer_window_size),
+          _n_batch_conflicts(0),
           dbg(dbg)
     {
         this->cdbg = make_shared<cDBG<GraphType>>(dbg,
                                                   pr_registry,
                                                   minimizer_window_size);
+#ifdef BOINK_STAGE_TIMING
+        stage_metrics = make_shared<CompactorStageMetrics>(pr_registry);
+#endif
     }
 
     ~StreamingCompactor() {
@@ -172,13 +297,48 @@ public:
         report.n_deletes         = cdbg->metrics->n_deletes.Value();
         report.n_circular_merges = cdbg->metrics->n_circular_merges.Value();
         report.n_unique          = dbg->n_unique();
-        //report.estimated_fp      = dbg->estimated_fp();
-        report.estimated_fp      = 0;
+        report.estimated_fp      = dbg->estimated_fp();
+
+        if (stage_metrics) {
+            report.t_find_segments = stage_metrics->stage_seconds(STAGE_FIND_SEGMENTS);
+            report.t_find_induced  = stage_metrics->stage_seconds(STAGE_FIND_INDUCED);
+            report.t_induce_dnodes = stage_metrics->stage_seconds(STAGE_INDUCE_DNODES);
+            report.t_update_unodes = stage_metrics->stage_seconds(STAGE_UPDATE_UNODES);
+            report.t_dbg_insert    = stage_metrics->stage_seconds(STAGE_DBG_INSERT);
+            report.t_coverage      = stage_metrics->stage_seconds(STAGE_COVERAGE);
+            report.t_notify        = stage_metrics->stage_seconds(STAGE_NOTIFY);
+            report.t_updates       = stage_metrics->update_seconds();
+            report.n_timed_updates = stage_metrics->n_updates.load();
+        }
 
         return report;
     }
 
+    std::unique_lock<std::mutex> lock_updates() {
+        return std::unique_lock<std::mutex>(_update_mutex);
+    }
+
+    /* Checkpoint the cDBG to prefix.cdbg and the dBG storage to
+     * prefix.dbg. Call between updates.
+     */
+    void save(const std::string& prefix) {
+        auto lock = lock_updates();
+        cdbg->save(prefix + ".cdbg");
+        dbg->save(prefix + ".dbg");
+    }
+
+    /* Restore a checkpoint written by save into this compactor, whose
+     * cDBG must be empty; update_sequence then carries on from it.
+     */
+    void load(const std::string& prefix) {
+        auto lock = lock_updates();
+        cdbg->load(prefix + ".cdbg");
+        dbg->load(prefix + ".dbg");
+    }
+
     void update_sequence(const std::string& sequence) {
+        auto lock = lock_updates();
+        stage_restart();
         std::set<hash_t> new_kmers;
         std::deque<compact_segment> segments;
         std::set<hash_t> new_decision_kmers;
@@ -191,6 +351,7 @@ public:
                           segments,
                           new_decision_kmers,
                           decision_neighbors);
+        stage_lap(STAGE_FIND_SEGMENTS);
 
         update_from_segments(sequence,
                              new_kmers,
@@ -201,6 +362,78 @@ public:
         for (auto h : hashes) {
             dbg->insert(h);
         }
+        stage_lap(STAGE_DBG_INSERT);
+        cdbg->add_coverage(sequence, hashes);
+        stage_lap(STAGE_COVERAGE);
+        stage_finish();
+    }
+
+    /* Compact a batch of sequences with n_threads. Segment discovery
+     * runs optimistically in parallel against the dBG as it stood at
+     * the start of the batch; the cDBG and dBG are then updated in input
+     * order. A sequence whose new k-mers, or the absent neighbors around
+     * them, were inserted earlier in the same batch has its discovery
+     * redone first, so the result is the same as calling update_sequence
+     * on each in turn.
+     * Sequences that are too short or contain invalid characters are
+     * skipped; returns the number skipped.
+     * With stage timing, each discovery is charged to find_segments on
+     * the thread that ran it, so that stage sums time across threads;
+     * the update times cover only the serial part of each update.
+     */
+    uint64_t update_sequences(const std::vector<std::string>& sequences,
+                              unsigned int n_threads) {
+        auto lock = lock_updates();
+        std::vector<segment_discovery> discoveries(sequences.size());
+
+        n_threads = std::max(1u, std::min<unsigned int>(n_threads, sequences.size()));
+        std::vector<std::thread> workers;
+        for (unsigned int t = 0; t < n_threads; ++t) {
+            workers.emplace_back([&, t] {
+                for (size_t i = t; i < sequences.size(); i += n_threads) {
+                    stage_timed(STAGE_FIND_SEGMENTS,
+                                _discover(sequences[i], discoveries[i]));
+                }
+            });
+        }
+        for (auto& worker : workers) {
+            worker.join();
+        }
+
+        uint64_t n_skipped = 0;
+        for (size_t i = 0; i < sequences.size(); ++i) {
+            auto& discovery = discoveries[i];
+            if (!discovery.valid) {
+                ++n_skipped;
+                continue;
+            }
+
+            stage_restart();
+            if (i > 0 && _is_stale(discovery)) {
+                ++_n_batch_conflicts;
+                _discover(sequences[i], discovery);
+                stage_lap(STAGE_FIND_SEGMENTS);
+            }
+
+            update_from_segments(sequences[i],
+                                 discovery.new_kmers,
+                                 discovery.segments,
+                                 discovery.new_decision_kmers,
+                                 discovery.decision_neighbors);
+            for (auto h : discovery.hashes) {
+                dbg->insert(h);
+            }
+            stage_lap(STAGE_DBG_INSERT);
+            cdbg->add_coverage(sequences[i], discovery.hashes);
+            stage_lap(STAGE_COVERAGE);
+            stage_finish();
+        }
+
+        return n_skipped;
+    }
+
+    uint64_t n_batch_conflicts() const {
+        return _n_batch_conflicts;
     }
 
     compact_segment init_segment(hash_t left_anchor,
@@ -531,8 +764,11 @@ public:
             ++i;
         }
 
+        stage_lap(STAGE_FIND_INDUCED);
+
         // Induce all the decision k-mers we found
         _induce_decision_nodes(induced, new_kmers);
+        stage_lap(STAGE_INDUCE_DNODES);
 
         // Now, with the cDBG in a correct state, update its unitigs
         // from our new segments
@@ -541,6 +777,7 @@ public:
                 _update_unode(segment, sequence);
             }
         }
+        stage_lap(STAGE_UPDATE_UNODES);
     }
 
     void _induce_decision_nodes(std::deque<DecisionKmer>& induced_decision_kmers,
@@ -602,29 +839,30 @@ public:
 
             if (unode_to_split->meta() == TRIVIAL) {
                 pdebug("Induced a trivial u-node, delete it.");
-                cdbg->delete_unode(unode_to_split);
+                auto lock = cdbg->lock_nodes();
+                cdbg->delete_unode(unode_to_split, true);
                 return true;
             }
 
             if (unode_to_split->meta() == CIRCULAR) {
-                auto unitig = unode_to_split->sequence;
+                auto& unitig = unode_to_split->sequence;
                 cdbg->split_unode(unode_to_split->node_id,
                                   0,
                                   root.kmer,
                                   this->hash(unitig.substr(unitig.size() - this->_K)),
-                                  this->hash(unitig.c_str() +1));
+                                  this->hash(unitig.substr(1, this->_K)));
                 return true;
             }
 
             hash_t new_end;
             direction_t clip_from;
             if (root.hash == unode_to_split->left_end()) {
-                new_end = this->hash(unode_to_split->sequence.c_str() + 1);
+                new_end = this->hash(unode_to_split->sequence.substr(1, this->_K));
                 clip_from = DIR_LEFT;
             } else {
-                new_end = this->hash(unode_to_split->sequence.c_str()
-                                     + unode_to_split->sequence.size()
-                                     - this->_K - 1);
+                new_end = this->hash(unode_to_split->sequence.substr(
+                                         unode_to_split->sequence.size()
+                                         - this->_K - 1, this->_K));
                 clip_from = DIR_RIGHT;
             }
             cdbg->clip_unode(clip_from,
@@ -671,8 +909,8 @@ public:
                 pdebug("split point is " << split_point <<
                         " new_right is " << left_unode_new_right
                        << " root was " << root.hash);
-                hash_t right_unode_new_left = this->hash(unode_to_split->sequence.c_str() + 
-                                                         split_point + 1);
+                hash_t right_unode_new_left = this->hash(unode_to_split->sequence.substr(
+                                                             split_point + 1, this->_K));
                 if (rfiltered.size()) {
                     assert(right_unode_new_left == rfiltered.back().hash);
                 }
@@ -717,8 +955,8 @@ public:
                 size_t split_point = unode_to_split->sequence.size()
                                                      - path.size()
                                                      - 1 - this->_K;
-                hash_t new_right = this->hash(unode_to_split->sequence.c_str() + 
-                                              split_point - 1);
+                hash_t new_right = this->hash(unode_to_split->sequence.substr(
+                                                  split_point - 1, this->_K));
                 hash_t new_left = start.hash;
                 if (lfiltered.size()) {
                     assert(lfiltered.back().hash == new_right);
@@ -770,7 +1008,6 @@ public:
             
             pdebug("Special case: segment is a loop.");
             cdbg->build_unode(sequence.substr(segment.start_pos, segment.length),
-                              segment.tags,
                               segment.left_anchor,
                               segment.left_anchor);
             return;
@@ -785,8 +1022,7 @@ public:
             cdbg->extend_unode(DIR_RIGHT,
                                trimmed_seq,
                                segment.left_flank,
-                               segment.right_anchor,
-                               segment.tags);
+                               segment.right_anchor);
 
         } else if (!has_left_unode && has_right_unode) {
             auto trimmed_seq = sequence.substr(segment.start_pos,
@@ -794,8 +1030,7 @@ public:
             cdbg->extend_unode(DIR_LEFT,
                                trimmed_seq,
                                segment.right_flank,
-                               segment.left_anchor,
-                               segment.tags);
+                               segment.left_anchor);
         } else if (has_left_unode && has_right_unode) {
             std::string trimmed_seq;
             pdebug("Segment is " << segment.length);
@@ -812,11 +1047,9 @@ public:
             cdbg->merge_unodes(trimmed_seq,
                                span_kmers,
                                segment.left_flank,
-                               segment.right_flank,
-                               segment.tags);
+                               segment.right_flank);
         } else {
             cdbg->build_unode(sequence.substr(segment.start_pos, segment.length),
-                              segment.tags,
                               segment.left_anchor,
                               segment.right_anchor);
         }
@@ -941,7 +1174,8 @@ public:
     }
 
     virtual void _build_dnode(kmer_t kmer) {
-        cdbg->build_dnode(kmer.hash, kmer.kmer);
+        // the sequence being compacted is not inserted yet
+        cdbg->build_dnode(kmer.hash, kmer.kmer, dbg->query(kmer.hash));
     }
 
     uint8_t _add_neighbor_bundle(NeighborBundle& bundle) {
@@ -984,6 +1218,7 @@ public:
             visited.insert(it->second->node_id);
         }
      
+        auto lock = cdbg->lock_nodes();
         for (auto node : rc_nodes_to_delete) {
             if (node->meta() == DECISION) {
                 cdbg->delete_dnode((DecisionNode*)node);
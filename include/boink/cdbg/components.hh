@@ -0,0 +1,285 @@
+/* cdbg/components.hh -- incrementally maintained cDBG components
+ *
+ * Copyright (C) 2018 Camille Scott
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+
+#ifndef BOINK_CDBG_COMPONENTS_HH
+#define BOINK_CDBG_COMPONENTS_HH
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// save diagnostic state
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wsign-compare"
+#include "sparsepp/spp.h"
+#pragma GCC diagnostic pop
+
+#include "boink/boink.hh"
+#include "boink/cdbg/cdbg_types.hh"
+
+namespace boink {
+namespace cdbg {
+
+
+struct component_member {
+    id_t id;
+    bool is_dnode;
+
+    component_member(id_t id, bool is_dnode)
+        : id(id),
+          is_dnode(is_dnode)
+    {
+    }
+
+    friend bool operator==(const component_member& lhs, const component_member& rhs) {
+        return lhs.id == rhs.id && lhs.is_dnode == rhs.is_dnode;
+    }
+};
+
+
+struct component_member_hash {
+    size_t operator()(const component_member& member) const {
+        return std::hash<id_t>()(member.id) ^ member.is_dnode;
+    }
+};
+
+
+/* Union-find over cDBG nodes, keyed by the nodes' own component_id
+ * fields: uniting two components relabels the members of the smaller,
+ * so finding a node's component is a field read. Inserting k-mers only
+ * ever joins components; removing a node that takes its k-mers with it
+ * can split one, so such components are marked dirty and re-traversed
+ * on the next refresh. Member lists may hold nodes that have since been
+ * removed or relabeled; callers pass a lookup from member to live node
+ * (or nullptr) so those can be skipped and pruned.
+ */
+class ComponentIndex {
+
+public:
+
+    typedef std::vector<component_member> members_t;
+
+    struct component_t {
+        members_t members;
+        // number of live nodes; members may also hold stale entries
+        size_t    size;
+
+        component_t()
+            : size(0)
+        {
+        }
+    };
+
+    typedef spp::sparse_hash_map<id_t, component_t> component_map_t;
+
+protected:
+
+    component_map_t            _components;
+    spp::sparse_hash_set<id_t> _dirty;
+    id_t                       _next_id;
+
+    template <class Lookup>
+    bool _is_member(const component_member& member, id_t component_id, Lookup& lookup) {
+        CompactNode * node = lookup(member);
+        return node != nullptr && node->component_id == component_id;
+    }
+
+    template <class Lookup>
+    void _prune(component_t& component, id_t component_id, Lookup& lookup) {
+        members_t live;
+        spp::sparse_hash_set<component_member, component_member_hash> seen;
+        for (auto& member : component.members) {
+            if (_is_member(member, component_id, lookup) && seen.insert(member).second) {
+                live.push_back(member);
+            }
+        }
+        component.members.swap(live);
+        component.size = component.members.size();
+    }
+
+public:
+
+    ComponentIndex()
+        : _next_id(0)
+    {
+    }
+
+    /* Give node a new singleton component. */
+    id_t add(CompactNode * node) {
+        id_t component_id = _next_id++;
+        node->component_id = component_id;
+        auto& component = _components[component_id];
+        component.members.emplace_back(node->node_id, node->meta() == DECISION);
+        component.size = 1;
+        return component_id;
+    }
+
+    template <class Lookup>
+    void unite(CompactNode * a, CompactNode * b, Lookup lookup) {
+        if (a->component_id == NULL_ID) {
+            add(a);
+        }
+        if (b->component_id == NULL_ID) {
+            add(b);
+        }
+        id_t into = a->component_id, from = b->component_id;
+        if (into == from) {
+            return;
+        }
+        // relabel the smaller side; on a tie the older ID survives
+        size_t into_size = _components[into].members.size();
+        size_t from_size = _components[from].members.size();
+        if (into_size < from_size || (into_size == from_size && from < into)) {
+            std::swap(into, from);
+        }
+
+        auto& target = _components[into];
+        for (auto& member : _components[from].members) {
+            CompactNode * node = lookup(member);
+            if (node != nullptr && node->component_id == from) {
+                node->component_id = into;
+                target.members.push_back(member);
+                ++target.size;
+            }
+        }
+        if (_dirty.erase(from)) {
+            _dirty.insert(into);
+        }
+        _components.erase(from);
+    }
+
+    /* Put node back into the component its component_id names, as when
+     * restoring a saved cDBG; the component is re-traversed on the next
+     * refresh in case the saved IDs are stale.
+     */
+    void insert(CompactNode * node) {
+        if (node->component_id == NULL_ID) {
+            add(node);
+            return;
+        }
+        auto& component = _components[node->component_id];
+        component.members.emplace_back(node->node_id, node->meta() == DECISION);
+        ++component.size;
+        _dirty.insert(node->component_id);
+        if (node->component_id >= _next_id) {
+            _next_id = node->component_id + 1;
+        }
+    }
+
+    /* Forget node, which is about to be destroyed. If its k-mers are
+     * being absorbed into a neighbor, its component stays connected;
+     * otherwise the component is re-traversed on the next refresh.
+     */
+    template <class Lookup>
+    void remove(CompactNode * node, bool absorbed, Lookup lookup) {
+        auto search = _components.find(node->component_id);
+        if (search == _components.end()) {
+            return;
+        }
+        id_t component_id = node->component_id;
+        auto& component = search->second;
+        --component.size;
+        node->component_id = NULL_ID;
+
+        if (!absorbed) {
+            _dirty.insert(component_id);
+        } else if (component.members.size() > 2 * component.size + 16) {
+            _prune(component, component_id, lookup);
+        }
+        if (component.size == 0) {
+            _components.erase(component_id);
+            _dirty.erase(component_id);
+        }
+    }
+
+    /* Re-traverse the dirty components from their surviving members.
+     * The first piece of a component keeps its ID; any others get new
+     * ones. traverse(node) returns every node connected to node.
+     */
+    template <class Lookup, class Traverse>
+    void refresh(Lookup lookup, Traverse traverse) {
+        while (_dirty.size()) {
+            id_t component_id = *_dirty.begin();
+            _dirty.erase(_dirty.begin());
+
+            auto search = _components.find(component_id);
+            if (search == _components.end()) {
+                continue;
+            }
+            members_t old_members;
+            old_members.swap(search->second.members);
+            _components.erase(search);
+
+            // unlabel the survivors; each traversal claims its piece
+            std::vector<CompactNode*> roots;
+            for (auto& member : old_members) {
+                CompactNode * root = lookup(member);
+                if (root != nullptr && root->component_id == component_id) {
+                    root->component_id = NULL_ID;
+                    roots.push_back(root);
+                }
+            }
+
+            bool first = true;
+            for (auto root : roots) {
+                if (root->component_id != NULL_ID) {
+                    continue;
+                }
+
+                id_t piece_id = first ? component_id : _next_id++;
+                first = false;
+                members_t members;
+                for (auto node : traverse(root)) {
+                    auto other = _components.find(node->component_id);
+                    if (node->component_id != NULL_ID && other != _components.end()) {
+                        // joined without being united; settle it next round
+                        --other->second.size;
+                        _dirty.insert(node->component_id);
+                    }
+                    node->component_id = piece_id;
+                    members.emplace_back(node->node_id, node->meta() == DECISION);
+                }
+                auto& piece = _components[piece_id];
+                piece.members.swap(members);
+                piece.size = piece.members.size();
+            }
+        }
+    }
+
+    bool is_dirty() const {
+        return _dirty.size() > 0;
+    }
+
+    size_t n_components() const {
+        return _components.size();
+    }
+
+    const component_map_t& components() const {
+        return _components;
+    }
+
+    void clear() {
+        _components.clear();
+        _dirty.clear();
+    }
+
+    id_t next_id() const {
+        return _next_id;
+    }
+
+    void set_next_id(id_t next_id) {
+        _next_id = next_id;
+    }
+};
+
+
+}
+}
+
+#endif
@@ -10,6 +10,8 @@
 #ifndef BOINK_CDBG_METRICS_HH
 #define BOINK_CDBG_METRICS_HH
 
+#include <array>
+#include <atomic>
 #include <string>
 #include <iostream>
 #include <sstream>
@@ -139,6 +141,114 @@ inline std::ostream& operator<<(std::ostream& o, const cDBGMetrics& c) {
     return o;
 }
 
+
+
+/* The phases of StreamingCompactor::update_sequence. NOTIFY is the
+ * time spent handing events to listeners, which happens inside the
+ * INDUCE_DNODES and UPDATE_UNODES phases and is counted in them too.
+ */
+enum compactor_stage_t {
+    STAGE_FIND_SEGMENTS,
+    STAGE_FIND_INDUCED,
+    STAGE_INDUCE_DNODES,
+    STAGE_UPDATE_UNODES,
+    STAGE_DBG_INSERT,
+    STAGE_COVERAGE,
+    STAGE_NOTIFY,
+    N_COMPACTOR_STAGES
+};
+
+
+inline const char * compactor_stage_repr(compactor_stage_t stage) {
+    switch(stage) {
+        case STAGE_FIND_SEGMENTS:
+            return "find_segments";
+        case STAGE_FIND_INDUCED:
+            return "find_induced";
+        case STAGE_INDUCE_DNODES:
+            return "induce_dnodes";
+        case STAGE_UPDATE_UNODES:
+            return "update_unodes";
+        case STAGE_DBG_INSERT:
+            return "dbg_insert";
+        case STAGE_COVERAGE:
+            return "coverage";
+        case STAGE_NOTIFY:
+            return "notify";
+        default:
+            return "unknown";
+    }
+}
+
+
+/* Latency histograms for each compactor stage and for whole updates,
+ * plus running totals for StreamingCompactorReport. Only built when
+ * boink is compiled with BOINK_STAGE_TIMING.
+ */
+struct CompactorStageMetrics {
+
+private:
+
+    prometheus::Family<prometheus::Histogram>& stage_time_family;
+    prometheus::Family<prometheus::Histogram>& update_time_family;
+
+public:
+
+    std::array<prometheus::Histogram*, N_COMPACTOR_STAGES> stage_time;
+    prometheus::Histogram&                                  update_time;
+
+    std::array<std::atomic<uint64_t>, N_COMPACTOR_STAGES>   stage_ns;
+    std::atomic<uint64_t>                                   update_ns;
+    std::atomic<uint64_t>                                   n_updates;
+
+    // 1us to ~0.26s, by factors of four
+    static prometheus::Histogram::BucketBoundaries buckets() {
+        prometheus::Histogram::BucketBoundaries bounds;
+        for (double b = 1e-6; b < 0.5; b *= 4) {
+            bounds.push_back(b);
+        }
+        return bounds;
+    }
+
+    CompactorStageMetrics(std::shared_ptr<prometheus::Registry> registry)
+        : stage_time_family  (prometheus::BuildHistogram()
+                                           .Name("boink_compactor_stage_seconds")
+                                           .Register(*registry)),
+          update_time_family (prometheus::BuildHistogram()
+                                           .Name("boink_compactor_update_seconds")
+                                           .Register(*registry)),
+          update_time        (update_time_family.Add({{"update", "sequence"}}, buckets())),
+          update_ns          (0),
+          n_updates          (0)
+    {
+        for (int stage = 0; stage < N_COMPACTOR_STAGES; ++stage) {
+            auto name = compactor_stage_repr(static_cast<compactor_stage_t>(stage));
+            stage_time[stage] = &stage_time_family.Add({{"stage", name}}, buckets());
+            stage_ns[stage].store(0);
+        }
+    }
+
+    void observe(compactor_stage_t stage, uint64_t ns) {
+        stage_time[stage]->Observe(ns * 1e-9);
+        stage_ns[stage].fetch_add(ns, std::memory_order_relaxed);
+    }
+
+    void observe_update(uint64_t ns) {
+        update_time.Observe(ns * 1e-9);
+        update_ns.fetch_add(ns, std::memory_order_relaxed);
+        n_updates.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    double stage_seconds(compactor_stage_t stage) const {
+        return stage_ns[stage].load(std::memory_order_relaxed) * 1e-9;
+    }
+
+    double update_seconds() const {
+        return update_ns.load(std::memory_order_relaxed) * 1e-9;
+    }
+};
+
+
 }
 }
 
@@ -0,0 +1,116 @@
+/* cdbg/node_pool.hh -- slab allocator for cDBG nodes
+ *
+ * Copyright (C) 2018 Camille Scott
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+
+#ifndef BOINK_NODE_POOL_HH
+#define BOINK_NODE_POOL_HH
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <vector>
+
+#define DEFAULT_NODE_SLAB_SIZE 4096
+
+namespace boink {
+namespace cdbg {
+
+
+/* Fixed-size block allocator shared by every node of type T. Blocks are
+ * carved out of slabs of DEFAULT_NODE_SLAB_SIZE and recycled through a
+ * free list; slabs are only returned when the process exits. Node types
+ * route their class operator new / delete here, so owners can keep
+ * using make_unique.
+ */
+template <class T>
+class NodePool {
+
+protected:
+
+    union block_t {
+        block_t * next;
+        alignas(T) unsigned char storage[sizeof(T)];
+    };
+
+    std::mutex                                _mutex;
+    std::vector<std::unique_ptr<block_t[]>>   _slabs;
+    block_t *                                 _free;
+    size_t                                    _n_allocated;
+
+    NodePool()
+        : _free(nullptr),
+          _n_allocated(0)
+    {
+    }
+
+    void _add_slab() {
+        block_t * slab = new block_t[DEFAULT_NODE_SLAB_SIZE];
+        _slabs.emplace_back(slab);
+        for (size_t i = 0; i < DEFAULT_NODE_SLAB_SIZE; ++i) {
+            slab[i].next = _free;
+            _free = &slab[i];
+        }
+    }
+
+public:
+
+    NodePool(const NodePool&) = delete;
+    NodePool& operator=(const NodePool&) = delete;
+
+    // never destroyed, so nodes outliving static destruction are safe
+    static NodePool& instance() {
+        static NodePool * pool = new NodePool();
+        return *pool;
+    }
+
+    void * allocate(size_t size) {
+        if (size != sizeof(T)) {
+            return ::operator new(size);
+        }
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (_free == nullptr) {
+            _add_slab();
+        }
+        block_t * block = _free;
+        _free = block->next;
+        ++_n_allocated;
+        return block;
+    }
+
+    void deallocate(void * ptr, size_t size) {
+        if (ptr == nullptr) {
+            return;
+        }
+        if (size != sizeof(T)) {
+            ::operator delete(ptr);
+            return;
+        }
+        std::lock_guard<std::mutex> lock(_mutex);
+        block_t * block = static_cast<block_t*>(ptr);
+        block->next = _free;
+        _free = block;
+        --_n_allocated;
+    }
+
+    size_t n_allocated() {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _n_allocated;
+    }
+
+    size_t n_slabs() {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _slabs.size();
+    }
+};
+
+
+}
+}
+
+#endif
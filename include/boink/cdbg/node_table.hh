@@ -0,0 +1,527 @@
+/* cdbg/node_table.hh -- dense node tables and the k-mer node index
+ *
+ * Copyright (C) 2018 Camille Scott
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+
+#ifndef BOINK_NODE_TABLE_HH
+#define BOINK_NODE_TABLE_HH
+
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "boink/boink.hh"
+#include "boink/hashing/hashing_types.hh"
+#include "boink/cdbg/cdbg_types.hh"
+
+#define DEFAULT_NODE_INDEX_CAPACITY 1024
+
+namespace boink {
+namespace cdbg {
+
+using boink::hashing::hash_t;
+
+
+/* Nodes stored densely by slot. Each slot holds the node's ID alongside
+ * the owning pointer, so iterators dereference to (ID, node) pairs like
+ * a map's would; empty slots are skipped. Freed slots are reused, so
+ * the table stays as large as the most nodes ever live at once.
+ */
+template <class NodeType>
+class NodeTable {
+
+public:
+
+    typedef std::pair<id_t, std::unique_ptr<NodeType>> slot_t;
+
+    class const_iterator {
+
+        const std::vector<slot_t> * _slots;
+        size_t                      _pos;
+
+        void _skip_empty() {
+            while (_pos < _slots->size() && !(*_slots)[_pos].second) {
+                ++_pos;
+            }
+        }
+
+    public:
+
+        typedef std::forward_iterator_tag iterator_category;
+        typedef slot_t                    value_type;
+        typedef std::ptrdiff_t            difference_type;
+        typedef const slot_t *            pointer;
+        typedef const slot_t &            reference;
+
+        const_iterator()
+            : _slots(nullptr),
+              _pos(0)
+        {
+        }
+
+        const_iterator(const std::vector<slot_t> * slots, size_t pos)
+            : _slots(slots),
+              _pos(pos)
+        {
+            _skip_empty();
+        }
+
+        reference operator*() const {
+            return (*_slots)[_pos];
+        }
+
+        pointer operator->() const {
+            return &(*_slots)[_pos];
+        }
+
+        const_iterator& operator++() {
+            ++_pos;
+            _skip_empty();
+            return *this;
+        }
+
+        const_iterator operator++(int) {
+            const_iterator old = *this;
+            ++(*this);
+            return old;
+        }
+
+        friend bool operator==(const const_iterator& lhs, const const_iterator& rhs) {
+            return lhs._pos == rhs._pos;
+        }
+
+        friend bool operator!=(const const_iterator& lhs, const const_iterator& rhs) {
+            return lhs._pos != rhs._pos;
+        }
+    };
+
+protected:
+
+    std::vector<slot_t>   _slots;
+    std::vector<uint64_t> _free;
+    size_t                _size;
+
+public:
+
+    NodeTable()
+        : _size(0)
+    {
+    }
+
+    uint64_t insert(id_t id, std::unique_ptr<NodeType> node) {
+        uint64_t slot;
+        if (_free.size()) {
+            slot = _free.back();
+            _free.pop_back();
+            _slots[slot] = slot_t(id, std::move(node));
+        } else {
+            slot = _slots.size();
+            _slots.emplace_back(id, std::move(node));
+        }
+        ++_size;
+        return slot;
+    }
+
+    NodeType * at(uint64_t slot) const {
+        if (slot >= _slots.size()) {
+            return nullptr;
+        }
+        return _slots[slot].second.get();
+    }
+
+    void erase(uint64_t slot) {
+        if (slot >= _slots.size() || !_slots[slot].second) {
+            return;
+        }
+        _slots[slot].second.reset();
+        --_size;
+        _free.push_back(slot);
+    }
+
+    size_t size() const {
+        return _size;
+    }
+
+    const_iterator cbegin() const {
+        return const_iterator(&_slots, 0);
+    }
+
+    const_iterator cend() const {
+        return const_iterator(&_slots, _slots.size());
+    }
+
+    const_iterator begin() const {
+        return cbegin();
+    }
+
+    const_iterator end() const {
+        return cend();
+    }
+};
+
+
+/* Open-addressing (linear probing) table keyed by k-mer hash. Entries
+ * are value-initialized when empty and report occupancy themselves;
+ * deletion shifts later entries of the cluster back rather than leaving
+ * tombstones, so probes stay short under churn.
+ */
+template <class EntryType>
+class LinearProbeIndex {
+
+protected:
+
+    std::vector<EntryType> _table;
+    uint64_t               _mask;
+    size_t                 _size;
+
+    size_t _home(hash_t key) const {
+        // the k-mer hashes are not always well mixed in the low bits
+        return (key * 0x9E3779B97F4A7C15ULL) >> 17 & _mask;
+    }
+
+    void _grow() {
+        std::vector<EntryType> old(_table.size() * 2);
+        old.swap(_table);
+        _mask = _table.size() - 1;
+        for (auto& entry : old) {
+            if (entry.occupied()) {
+                size_t pos = _home(entry.key);
+                while (_table[pos].occupied()) {
+                    pos = (pos + 1) & _mask;
+                }
+                _table[pos] = entry;
+            }
+        }
+    }
+
+public:
+
+    LinearProbeIndex(size_t capacity=DEFAULT_NODE_INDEX_CAPACITY)
+        : _size(0)
+    {
+        size_t size = 16;
+        while (size < capacity) {
+            size <<= 1;
+        }
+        _table.resize(size);
+        _mask = size - 1;
+    }
+
+    /* Call visit(entry) on each entry for key, in probe order,
+     * until it returns true.
+     */
+    template <class Visitor>
+    void probe(hash_t key, Visitor visit) const {
+        for (size_t pos = _home(key); _table[pos].occupied(); pos = (pos + 1) & _mask) {
+            if (_table[pos].key == key && visit(_table[pos])) {
+                return;
+            }
+        }
+    }
+
+    /* Insert unless an entry for the same key satisfies same(entry);
+     * returns whether it was inserted.
+     */
+    template <class Match>
+    bool insert(const EntryType& entry, Match same) {
+        if ((_size + 1) * 2 > _table.size()) {
+            _grow();
+        }
+        size_t pos = _home(entry.key);
+        for (; _table[pos].occupied(); pos = (pos + 1) & _mask) {
+            if (_table[pos].key == entry.key && same(_table[pos])) {
+                return false;
+            }
+        }
+        _table[pos] = entry;
+        ++_size;
+        return true;
+    }
+
+    /* Remove the first entry for key satisfying match(entry). */
+    template <class Match>
+    bool erase(hash_t key, Match match) {
+        size_t pos = _home(key);
+        for (; _table[pos].occupied(); pos = (pos + 1) & _mask) {
+            if (_table[pos].key == key && match(_table[pos])) {
+                break;
+            }
+        }
+        if (!_table[pos].occupied()) {
+            return false;
+        }
+        --_size;
+
+        size_t hole = pos;
+        for (size_t next = (hole + 1) & _mask; _table[next].occupied(); next = (next + 1) & _mask) {
+            size_t home = _home(_table[next].key);
+            bool movable = hole <= next ? (home <= hole || home > next)
+                                        : (home <= hole && home > next);
+            if (movable) {
+                _table[hole] = _table[next];
+                hole = next;
+            }
+        }
+        _table[hole] = EntryType();
+        return true;
+    }
+
+    size_t size() const {
+        return _size;
+    }
+
+    size_t capacity() const {
+        return _table.size();
+    }
+};
+
+
+enum node_index_t {
+    INDEX_DNODE     = 1,
+    INDEX_UNODE_END = 2
+};
+
+
+struct node_index_entry {
+    static const uint64_t KIND_SHIFT = 62;
+    static const uint64_t VALUE_MASK = (1ULL << KIND_SHIFT) - 1;
+
+    hash_t   key;
+    // entry kind in the top two bits, node slot below
+    uint64_t value;
+
+    node_index_entry()
+        : key(0),
+          value(0)
+    {
+    }
+
+    node_index_entry(hash_t key, node_index_t kind, uint64_t slot)
+        : key(key),
+          value((uint64_t(kind) << KIND_SHIFT) | (slot & VALUE_MASK))
+    {
+    }
+
+    bool occupied() const {
+        return value != 0;
+    }
+
+    node_index_t kind() const {
+        return static_cast<node_index_t>(value >> KIND_SHIFT);
+    }
+
+    uint64_t slot() const {
+        return value & VALUE_MASK;
+    }
+};
+
+
+/* Index from k-mer hash to node slot, shared by d-nodes and unitig
+ * ends. An entry is two words, and the same k-mer can carry entries of
+ * different kinds.
+ */
+class NodeIndex : public LinearProbeIndex<node_index_entry> {
+
+protected:
+
+    size_t _counts[3];
+
+public:
+
+    NodeIndex(size_t capacity=DEFAULT_NODE_INDEX_CAPACITY)
+        : LinearProbeIndex<node_index_entry>(capacity),
+          _counts{0, 0, 0}
+    {
+    }
+
+    /* Call visit(kind, slot) on each entry for key, in probe order,
+     * until it returns true.
+     */
+    template <class Visitor>
+    void probe(hash_t key, Visitor visit) const {
+        LinearProbeIndex<node_index_entry>::probe(key, [&](const node_index_entry& entry) {
+            return visit(entry.kind(), entry.slot());
+        });
+    }
+
+    bool find(hash_t key, node_index_t kind, uint64_t& slot) const {
+        bool found = false;
+        probe(key, [&](node_index_t entry_kind, uint64_t entry_slot) {
+            if (entry_kind == kind) {
+                slot = entry_slot;
+                found = true;
+            }
+            return found;
+        });
+        return found;
+    }
+
+    bool contains(hash_t key, node_index_t kind) const {
+        uint64_t slot;
+        return find(key, kind, slot);
+    }
+
+    /* Insert unless key already has an entry of this kind; returns
+     * whether it was inserted.
+     */
+    bool insert(hash_t key, node_index_t kind, uint64_t slot) {
+        bool inserted = LinearProbeIndex<node_index_entry>::insert(
+            node_index_entry(key, kind, slot),
+            [&](const node_index_entry& entry) { return entry.kind() == kind; });
+        if (inserted) {
+            ++_counts[kind];
+        }
+        return inserted;
+    }
+
+    bool erase(hash_t key, node_index_t kind) {
+        bool erased = LinearProbeIndex<node_index_entry>::erase(key,
+            [&](const node_index_entry& entry) { return entry.kind() == kind; });
+        if (erased) {
+            --_counts[kind];
+        }
+        return erased;
+    }
+
+    size_t count(node_index_t kind) const {
+        return _counts[kind];
+    }
+};
+
+
+struct unitig_position_entry {
+    hash_t   key;
+    // unitig ID + 1, so a zeroed entry is empty
+    uint64_t id_plus_one;
+    // position in the unitig's coordinates; see UnitigNode::origin
+    int64_t  coord;
+
+    unitig_position_entry()
+        : key(0),
+          id_plus_one(0),
+          coord(0)
+    {
+    }
+
+    unitig_position_entry(hash_t key, id_t id, int64_t coord)
+        : key(key),
+          id_plus_one(id + 1),
+          coord(coord)
+    {
+    }
+
+    bool occupied() const {
+        return id_plus_one != 0;
+    }
+
+    id_t id() const {
+        return id_plus_one - 1;
+    }
+};
+
+
+/* Sampled index from interior unitig k-mers to (unitig ID, coordinate).
+ * A k-mer belongs to at most one unitig, so there is one entry per
+ * hash.
+ */
+class UnitigPositionIndex : public LinearProbeIndex<unitig_position_entry> {
+
+public:
+
+    using LinearProbeIndex<unitig_position_entry>::LinearProbeIndex;
+
+    bool find(hash_t key, id_t& id, int64_t& coord) const {
+        bool found = false;
+        probe(key, [&](const unitig_position_entry& entry) {
+            id = entry.id();
+            coord = entry.coord;
+            found = true;
+            return true;
+        });
+        return found;
+    }
+
+    bool insert(hash_t key, id_t id, int64_t coord) {
+        return LinearProbeIndex<unitig_position_entry>::insert(
+            unitig_position_entry(key, id, coord),
+            [](const unitig_position_entry&) { return true; });
+    }
+
+    /* Erase key only if it is sampled from unitig id. */
+    bool erase(hash_t key, id_t id) {
+        return LinearProbeIndex<unitig_position_entry>::erase(key,
+            [&](const unitig_position_entry& entry) { return entry.id() == id; });
+    }
+};
+
+
+struct unitig_slot_entry {
+    // unitig ID
+    hash_t   key;
+    // table slot + 1, so a zeroed entry is empty
+    uint64_t slot_plus_one;
+
+    unitig_slot_entry()
+        : key(0),
+          slot_plus_one(0)
+    {
+    }
+
+    unitig_slot_entry(id_t id, uint64_t slot)
+        : key(id),
+          slot_plus_one(slot + 1)
+    {
+    }
+
+    bool occupied() const {
+        return slot_plus_one != 0;
+    }
+
+    uint64_t slot() const {
+        return slot_plus_one - 1;
+    }
+};
+
+
+/* Index from unitig ID to the unitig's slot in its NodeTable. IDs are
+ * never reused but slots are, so this holds only the live unitigs.
+ */
+class UnitigSlotIndex : public LinearProbeIndex<unitig_slot_entry> {
+
+public:
+
+    using LinearProbeIndex<unitig_slot_entry>::LinearProbeIndex;
+
+    bool find(id_t id, uint64_t& slot) const {
+        bool found = false;
+        probe(id, [&](const unitig_slot_entry& entry) {
+            slot = entry.slot();
+            found = true;
+            return true;
+        });
+        return found;
+    }
+
+    bool insert(id_t id, uint64_t slot) {
+        return LinearProbeIndex<unitig_slot_entry>::insert(
+            unitig_slot_entry(id, slot),
+            [](const unitig_slot_entry&) { return true; });
+    }
+
+    bool erase(id_t id) {
+        return LinearProbeIndex<unitig_slot_entry>::erase(id,
+            [](const unitig_slot_entry&) { return true; });
+    }
+};
+
+
+}
+}
+
+#endif
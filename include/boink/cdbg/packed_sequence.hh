@@ -0,0 +1,298 @@
+/* cdbg/packed_sequence.hh -- 2-bit packed, double-ended node sequences
+ *
+ * Copyright (C) 2018 Camille Scott
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+
+#ifndef BOINK_PACKED_SEQUENCE_HH
+#define BOINK_PACKED_SEQUENCE_HH
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <atomic>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "boink/boink.hh"
+#include "boink/hashing/exceptions.hh"
+
+namespace boink {
+namespace cdbg {
+
+
+/* DNA sequence stored at 2 bits per base, with slack kept at both ends
+ * of the buffer so that appending or prepending n bases costs amortized
+ * O(n) rather than a copy of the whole sequence, and trimming either end
+ * is O(1). Reading it back out (str, substr) decodes.
+ *
+ * Copies share the packed bytes until one of them writes, so copying a
+ * sequence is O(1); the cDBG relies on this to snapshot its nodes.
+ * Copying from and writing to one PackedSequence still needs outside
+ * locking, but a copy may be read from another thread while the
+ * original is modified.
+ */
+class PackedSequence {
+
+protected:
+
+    std::shared_ptr<std::vector<uint8_t>> _data;
+    // half-open range of base positions within _data in use
+    size_t _begin;
+    size_t _end;
+
+    static uint8_t _encode(char c) {
+        switch(c) {
+            case 'A':
+            case 'a':
+                return 0;
+            case 'C':
+            case 'c':
+                return 1;
+            case 'G':
+            case 'g':
+                return 2;
+            case 'T':
+            case 't':
+                return 3;
+            default:
+                throw hashing::InvalidCharacterException("Cannot pack "
+                                                         "non-ACGT character");
+        }
+    }
+
+    static char _decode(uint8_t code) {
+        return "ACGT"[code];
+    }
+
+    uint8_t _get(size_t pos) const {
+        return ((*_data)[pos >> 2] >> ((pos & 3) << 1)) & 3;
+    }
+
+    // callers must _own() the buffer first
+    void _set(size_t pos, uint8_t code) {
+        uint8_t& byte = (*_data)[pos >> 2];
+        const uint8_t shift = (pos & 3) << 1;
+        byte = (byte & ~(3 << shift)) | (code << shift);
+    }
+
+    size_t _capacity() const {
+        return _data ? _data->size() << 2 : 0;
+    }
+
+    /* Take a private copy of the bytes if any other sequence shares
+     * them. The fence orders our writes after the other owners' reads,
+     * which happened before they released the buffer.
+     */
+    void _own() {
+        if (_data.use_count() > 1) {
+            _data = std::make_shared<std::vector<uint8_t>>(*_data);
+        } else {
+            std::atomic_thread_fence(std::memory_order_acquire);
+        }
+    }
+
+    /* Make room for at least front bases before _begin and back bases
+     * after _end, doubling the slack on the side that ran out. The new
+     * _begin keeps its offset within a byte so the packed bytes can be
+     * moved with a single memcpy.
+     */
+    void _reserve(size_t front, size_t back) {
+        const size_t len = size();
+        const size_t cur_front = _begin;
+        const size_t cur_back = _capacity() - _end;
+        if (front <= cur_front && back <= cur_back) {
+            return;
+        }
+
+        size_t new_front = front > cur_front ? front + len : cur_front;
+        size_t new_back = back > cur_back ? back + len : cur_back;
+        new_front += (4 + (_begin & 3) - (new_front & 3)) & 3;
+
+        auto data = std::make_shared<std::vector<uint8_t>>((new_front + len + new_back + 3) >> 2, 0);
+        if (len) {
+            std::memcpy(data->data() + (new_front >> 2),
+                        _data->data() + (_begin >> 2),
+                        ((_end - 1) >> 2) - (_begin >> 2) + 1);
+        }
+        _data.swap(data);
+        _begin = new_front;
+        _end = new_front + len;
+    }
+
+public:
+
+    static const size_t npos = std::string::npos;
+
+    PackedSequence()
+        : _begin(0),
+          _end(0)
+    {
+    }
+
+    PackedSequence(const std::string& sequence)
+        : _data(std::make_shared<std::vector<uint8_t>>((sequence.size() + 3) >> 2, 0)),
+          _begin(0),
+          _end(sequence.size())
+    {
+        for (size_t i = 0; i < sequence.size(); ++i) {
+            _set(i, _encode(sequence[i]));
+        }
+    }
+
+    PackedSequence& operator=(const std::string& sequence) {
+        *this = PackedSequence(sequence);
+        return *this;
+    }
+
+    size_t size() const {
+        return _end - _begin;
+    }
+
+    size_t length() const {
+        return size();
+    }
+
+    bool empty() const {
+        return _end == _begin;
+    }
+
+    char operator[](size_t pos) const {
+        return _decode(_get(_begin + pos));
+    }
+
+    std::string substr(size_t pos, size_t len=npos) const {
+        if (pos > size()) {
+            throw BoinkException("PackedSequence::substr position out of range");
+        }
+        len = std::min(len, size() - pos);
+        std::string result(len, 'A');
+        for (size_t i = 0; i < len; ++i) {
+            result[i] = _decode(_get(_begin + pos + i));
+        }
+        return result;
+    }
+
+    std::string str() const {
+        return substr(0);
+    }
+
+    /* Decode onto the end of out, without a temporary. */
+    void append_to(std::string& out) const {
+        for (size_t pos = _begin; pos < _end; ++pos) {
+            out.push_back(_decode(_get(pos)));
+        }
+    }
+
+    /* Decode into out, which must have room for size() chars. */
+    void copy_to(char * out) const {
+        for (size_t pos = _begin; pos < _end; ++pos) {
+            *out++ = _decode(_get(pos));
+        }
+    }
+
+    operator std::string() const {
+        return str();
+    }
+
+    size_t find(const std::string& query) const {
+        return str().find(query);
+    }
+
+    void append(const std::string& sequence) {
+        _reserve(0, sequence.size());
+        _own();
+        for (auto c : sequence) {
+            _set(_end++, _encode(c));
+        }
+    }
+
+    void prepend(const std::string& sequence) {
+        _reserve(sequence.size(), 0);
+        _own();
+        _begin -= sequence.size();
+        for (size_t i = 0; i < sequence.size(); ++i) {
+            _set(_begin + i, _encode(sequence[i]));
+        }
+    }
+
+    void trim_left(size_t n) {
+        _begin += std::min(n, size());
+    }
+
+    void trim_right(size_t n) {
+        _end -= std::min(n, size());
+    }
+
+    /* Keep only the first len bases. */
+    void truncate(size_t len) {
+        if (len < size()) {
+            _end = _begin + len;
+        }
+    }
+
+    /* Release slack left by earlier growth or trimming. */
+    void shrink_to_fit() {
+        PackedSequence packed(str());
+        _data.swap(packed._data);
+        _begin = packed._begin;
+        _end = packed._end;
+    }
+
+    /* Binary form: length, the first base's offset within its byte, then
+     * the packed bytes covering the sequence, slack excluded.
+     */
+    void save(std::ostream& out) const {
+        uint64_t len = size();
+        uint8_t offset = _begin & 3;
+        out.write((const char *) &len, sizeof(len));
+        out.write((const char *) &offset, sizeof(offset));
+        if (len) {
+            out.write((const char *) _data->data() + (_begin >> 2),
+                      ((_end - 1) >> 2) - (_begin >> 2) + 1);
+        }
+    }
+
+    void load(std::istream& in) {
+        uint64_t len;
+        uint8_t offset;
+        in.read((char *) &len, sizeof(len));
+        in.read((char *) &offset, sizeof(offset));
+        if (offset > 3) {
+            throw BoinkException("Corrupt PackedSequence offset");
+        }
+        _data = std::make_shared<std::vector<uint8_t>>((offset + len + 3) >> 2, 0);
+        if (len) {
+            in.read((char *) _data->data(), _data->size());
+        }
+        _begin = offset;
+        _end = offset + len;
+    }
+
+    friend bool operator==(const PackedSequence& lhs, const std::string& rhs) {
+        if (lhs.size() != rhs.size()) {
+            return false;
+        }
+        for (size_t i = 0; i < rhs.size(); ++i) {
+            if (lhs[i] != rhs[i]) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    friend std::ostream& operator<<(std::ostream& o, const PackedSequence& seq) {
+        return o << seq.str();
+    }
+};
+
+
+}
+}
+
+#endif
@@ -0,0 +1,185 @@
+/* cdbg/snapshot.hh -- point-in-time views of a cDBG
+ *
+ * Copyright (C) 2018 Camille Scott
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+
+#ifndef BOINK_CDBG_SNAPSHOT_HH
+#define BOINK_CDBG_SNAPSHOT_HH
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "boink/boink.hh"
+#include "boink/cdbg/cdbg_types.hh"
+#include "boink/cdbg/packed_sequence.hh"
+
+#define DEFAULT_WRITE_CHUNK_NODES 4096
+
+
+namespace boink {
+namespace cdbg {
+
+
+/* Format items in chunks of DEFAULT_WRITE_CHUNK_NODES and write the
+ * chunks in order, so that at most n_threads formatted chunks are in
+ * memory at once. With n_threads > 1 the chunks of each round are
+ * formatted concurrently; format must then be safe to call from
+ * several threads.
+ */
+template <class ItemType, class Formatter>
+void write_chunked(std::ostream& out,
+                   const std::vector<ItemType>& items,
+                   unsigned int n_threads,
+                   Formatter format) {
+    n_threads = std::max(n_threads, 1u);
+    const size_t chunk = DEFAULT_WRITE_CHUNK_NODES;
+    std::vector<std::string> buffers(n_threads);
+
+    auto format_chunk = [&](size_t begin, std::string& buffer) {
+        buffer.clear();
+        const size_t end = std::min(begin + chunk, items.size());
+        for (size_t i = begin; i < end; ++i) {
+            format(items[i], buffer);
+        }
+    };
+
+    for (size_t round = 0; round < items.size(); round += chunk * n_threads) {
+        if (n_threads == 1) {
+            format_chunk(round, buffers[0]);
+        } else {
+            std::vector<std::thread> workers;
+            for (unsigned int t = 0; t < n_threads; ++t) {
+                size_t begin = round + t * chunk;
+                if (begin >= items.size()) {
+                    buffers[t].clear();
+                    continue;
+                }
+                workers.emplace_back(format_chunk, begin, std::ref(buffers[t]));
+            }
+            for (auto& worker : workers) {
+                worker.join();
+            }
+        }
+        for (auto& buffer : buffers) {
+            out.write(buffer.data(), buffer.size());
+        }
+    }
+}
+
+
+/* The nodes and links of a cDBG as they were at one update. Node
+ * sequences are copy-on-write PackedSequences, so taking a snapshot
+ * costs a pass over the node tables under the cDBG lock but copies no
+ * bases; the snapshot can then be formatted from another thread while
+ * the cDBG keeps changing.
+ */
+class cDBGSnapshot {
+
+public:
+
+    struct Node {
+        id_t           node_id;
+        node_meta_t    meta;
+        PackedSequence sequence;
+        // for d-nodes, the k-mer count is the d-node's count
+        uint64_t       kmer_count;
+        uint64_t       read_count;
+
+        std::string get_name() const {
+            return std::string("NODE") + std::to_string(node_id);
+        }
+    };
+
+    // (source, sink) node IDs, in the order GFA links are written
+    typedef std::pair<id_t, id_t> link_t;
+
+    const uint16_t K;
+    const uint64_t n_updates;
+
+    std::vector<Node>   unitig_nodes;
+    std::vector<Node>   decision_nodes;
+    std::vector<link_t> links;
+
+    cDBGSnapshot(uint16_t K, uint64_t n_updates)
+        : K(K),
+          n_updates(n_updates)
+    {
+    }
+
+    void write_fasta(std::ostream& out, unsigned int n_threads=1) const {
+        write_chunked(out, unitig_nodes, n_threads,
+                      [&](const Node& unode, std::string& buffer) {
+            buffer += ">ID=";
+            buffer += std::to_string(unode.node_id);
+            buffer += " L=";
+            buffer += std::to_string(unode.sequence.length());
+            buffer += " type=";
+            buffer += node_meta_repr(unode.meta);
+            buffer += " KC=";
+            buffer += std::to_string(unode.kmer_count);
+            buffer += " RC=";
+            buffer += std::to_string(unode.read_count);
+            buffer += '\n';
+            unode.sequence.append_to(buffer);
+            buffer += '\n';
+        });
+    }
+
+    /* Segment (S) lines for every node, then link (L) lines for the
+     * edges at each d-node, formatted and written chunk by chunk rather
+     * than built up as a whole document first.
+     */
+    void write_gfa1(std::ostream& out, unsigned int n_threads=1) const {
+        out << "H\tVN:Z:1.0\n";
+
+        auto add_segment = [&](const Node& node, std::string& buffer) {
+            buffer += "S\t";
+            buffer += node.get_name();
+            buffer += '\t';
+            node.sequence.append_to(buffer);
+            buffer += "\tLN:i:";
+            buffer += std::to_string(node.sequence.length());
+            buffer += "\tKC:i:";
+            buffer += std::to_string(node.kmer_count);
+            if (node.meta != DECISION) {
+                buffer += "\tRC:i:";
+                buffer += std::to_string(node.read_count);
+            }
+            buffer += '\n';
+        };
+        write_chunked(out, unitig_nodes, n_threads, add_segment);
+        write_chunked(out, decision_nodes, n_threads, add_segment);
+
+        const std::string overlap = std::to_string(K) + "M";
+        write_chunked(out, links, n_threads,
+                      [&](const link_t& link, std::string& buffer) {
+            buffer += "L\tNODE";
+            buffer += std::to_string(link.first);
+            buffer += "\t+\tNODE";
+            buffer += std::to_string(link.second);
+            buffer += "\t+\t";
+            buffer += overlap;
+            buffer += "\tID:Z:LINK-";
+            buffer += std::to_string(link.first);
+            buffer += '-';
+            buffer += std::to_string(link.second);
+            buffer += '\n';
+        });
+    }
+};
+
+
+}
+}
+
+#endif
@@ -41,6 +41,7 @@ protected:
 
 public:
 
+    typedef StorageType                                   storage_type;
     typedef HashShifter                                   shifter_type;
 	typedef AssemblerMixin<dBG<StorageType, HashShifter>> assembler_type;
     typedef hashing::KmerIterator<HashShifter>            kmer_iter_type;
@@ -146,6 +147,48 @@ public:
         return S->query(hashed_kmer);
     }
 
+    /**
+     * @Synopsis  Start loading a k-mer's storage into cache, so that a
+     *            batch of queries can overlap their misses.
+     *
+     * @Param hashed_kmer The k-mer's hash.
+     */
+    inline void prefetch(hashing::hash_t hashed_kmer) const {
+        S->prefetch(hashed_kmer);
+    }
+
+    /**
+     * @Synopsis  Gets the counts of a batch of k-mers, prefetching them
+     *            all before the first lookup.
+     *
+     * @Param hashed_kmers The k-mers' hashes.
+     *
+     * @Returns   The counts, in the same order.
+     */
+    std::vector<storage::count_t> query_many(const std::vector<hashing::hash_t>& hashed_kmers) const {
+        for (auto h : hashed_kmers) {
+            S->prefetch(h);
+        }
+        std::vector<storage::count_t> counts;
+        counts.reserve(hashed_kmers.size());
+        for (auto h : hashed_kmers) {
+            counts.push_back(S->query(h));
+        }
+        return counts;
+    }
+
+    /**
+     * @Synopsis  Remove a k-mer, if the StorageType can forget k-mers.
+     *
+     * @Returns   True if the k-mer was present.
+     */
+    template<typename U = StorageType>
+    auto remove(hashing::hash_t hashed_kmer)
+    -> std::enable_if_t<storage::supports_removal<U>::value, bool>
+    {
+        return S->remove(hashed_kmer);
+    }
+
     /**
      * @Synopsis  Number of unique k-mers in the storage.
      *
@@ -323,13 +366,29 @@ public:
      *
      * @Returns   The false-positive rate; 0 if an exact structure.
      */
-    template<typename Dummy = double>
-    auto estimated_fp() 
-    -> std::enable_if_t<storage::is_probabilistic<StorageType>::value, Dummy>
-    {
+    double estimated_fp() {
         return S->estimated_fp();
     }
 
+    /**
+     * @Synopsis  Number of inserts that found the k-mer's counters
+     *            already saturated.
+     *
+     * @Returns   Saturated inserts; 0 for storages that can't saturate.
+     */
+    uint64_t n_saturated() const {
+        return S->n_saturated();
+    }
+
+    /**
+     * @Synopsis  The underlying storage, for reporting on.
+     *
+     * @Returns   The storage.
+     */
+    StorageType& storage() {
+        return *S;
+    }
+
     uint64_t insert_sequence(const std::string&          sequence,
                           std::vector<hashing::hash_t>&  kmer_hashes,
                           std::vector<storage::count_t>& counts) {
@@ -10,10 +10,18 @@
 #ifndef EVENT_TYPES_HH
 #define EVENT_TYPES_HH
 
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <ostream>
 #include <string>
+#include <vector>
 
 #include "boink/boink.hh"
 #include "boink/cdbg/cdbg_types.hh"
+#include "boink/cdbg/node_pool.hh"
+#include "boink/cdbg/packed_sequence.hh"
 
 
 namespace boink {
@@ -21,6 +29,143 @@ namespace events {
 
 using boink::cdbg::node_meta_t;
 
+
+/* A sequence held in a SequenceBuffer. Copies share the chunk it lives
+ * in rather than the bases, which stay put until the last view into the
+ * chunk goes away.
+ */
+class SequenceView {
+
+    std::shared_ptr<const std::vector<char>> _chunk;
+    const char *                             _data;
+    size_t                                   _length;
+
+public:
+
+    SequenceView()
+        : _data(nullptr),
+          _length(0)
+    {
+    }
+
+    SequenceView(std::shared_ptr<const std::vector<char>> chunk,
+                 const char *                             data,
+                 size_t                                   length)
+        : _chunk(std::move(chunk)),
+          _data(data),
+          _length(length)
+    {
+    }
+
+    const char * data() const {
+        return _data;
+    }
+
+    size_t size() const {
+        return _length;
+    }
+
+    bool empty() const {
+        return _length == 0;
+    }
+
+    std::string str() const {
+        return std::string(_data, _length);
+    }
+
+    friend bool operator==(const SequenceView& lhs, const std::string& rhs) {
+        return lhs._length == rhs.size() &&
+               std::equal(lhs._data, lhs._data + lhs._length, rhs.begin());
+    }
+
+    friend std::ostream& operator<<(std::ostream& o, const SequenceView& seq) {
+        return o.write(seq._data, seq._length);
+    }
+};
+
+
+/* Append-only store for the sequences events carry. Each sequence is
+ * decoded or copied once, into the current chunk, and handed out as a
+ * SequenceView; chunks are freed by their last view, so building an
+ * event's sequence costs an allocation per chunk rather than per event.
+ */
+class SequenceBuffer {
+
+    static const size_t CHUNK_SIZE = 1 << 20;
+
+    std::mutex                         _mutex;
+    std::shared_ptr<std::vector<char>> _chunk;
+    size_t                             _used;
+
+    char * _reserve(size_t length, std::shared_ptr<std::vector<char>>& chunk) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (!_chunk || _used + length > _chunk->size()) {
+            _chunk = std::make_shared<std::vector<char>>(std::max(length, size_t(CHUNK_SIZE)));
+            _used = 0;
+        }
+        chunk = _chunk;
+        char * out = _chunk->data() + _used;
+        _used += length;
+        return out;
+    }
+
+public:
+
+    SequenceBuffer()
+        : _used(0)
+    {
+    }
+
+    SequenceView add(const std::string& sequence) {
+        std::shared_ptr<std::vector<char>> chunk;
+        char * out = _reserve(sequence.size(), chunk);
+        std::memcpy(out, sequence.data(), sequence.size());
+        return SequenceView(std::move(chunk), out, sequence.size());
+    }
+
+    SequenceView add(const cdbg::PackedSequence& sequence) {
+        std::shared_ptr<std::vector<char>> chunk;
+        char * out = _reserve(sequence.size(), chunk);
+        sequence.copy_to(out);
+        return SequenceView(std::move(chunk), out, sequence.size());
+    }
+};
+
+
+/* Allocator for allocate_shared which takes blocks from a NodePool, so
+ * that an event and its control block land in a recycled slab block
+ * rather than a fresh heap allocation.
+ */
+template <class T>
+struct EventAllocator {
+
+    typedef T value_type;
+
+    EventAllocator() {}
+
+    template <class U>
+    EventAllocator(const EventAllocator<U>&) {}
+
+    T * allocate(size_t n) {
+        return static_cast<T*>(cdbg::NodePool<T>::instance().allocate(n * sizeof(T)));
+    }
+
+    void deallocate(T * ptr, size_t n) {
+        cdbg::NodePool<T>::instance().deallocate(ptr, n * sizeof(T));
+    }
+};
+
+template <class T, class U>
+bool operator==(const EventAllocator<T>&, const EventAllocator<U>&) {
+    return true;
+}
+
+template <class T, class U>
+bool operator!=(const EventAllocator<T>&, const EventAllocator<U>&) {
+    return false;
+}
+
+
 /* All event types. 
  */
 
@@ -31,6 +176,7 @@ enum event_t {
 
     // Data events
     MSG_TIME_INTERVAL,
+    MSG_FP_WARNING,
 
     // cDBG events
     MSG_ADD_DNODE,
@@ -66,7 +212,7 @@ struct Event {
 
 /* cDBG history events. These all encode the sequence of the new node,
  * the parents (if necessary), the children (if necessary), and related node
- * meta.
+ * meta. Sequences are views into the emitting cDBG's SequenceBuffer.
  */
 
 struct HistoryNewEvent : public Event {
@@ -74,7 +220,7 @@ struct HistoryNewEvent : public Event {
         : Event(MSG_HISTORY_NEW)
     {}
 
-    std::string sequence;
+    SequenceView sequence;
     id_t id;
     node_meta_t meta;
 };
@@ -85,7 +231,7 @@ struct HistoryMergeEvent : public Event {
         : Event(MSG_HISTORY_MERGE)
     {}
 
-    std::string sequence;
+    SequenceView sequence;
     id_t lparent, rparent, child;
     node_meta_t meta;
 };
@@ -97,7 +243,7 @@ struct HistoryExtendEvent : public Event {
     {}
 
     id_t id;
-    std::string sequence;
+    SequenceView sequence;
     node_meta_t meta;
 };
 
@@ -118,7 +264,7 @@ struct HistoryClipEvent : public Event {
     {}
 
     id_t id;
-    std::string sequence;
+    SequenceView sequence;
     node_meta_t meta;
 };
 
@@ -130,7 +276,7 @@ struct HistorySplitEvent : public Event {
 
     id_t parent, lchild, rchild;
     node_meta_t lmeta, rmeta;
-    std::string lsequence, rsequence;
+    SequenceView lsequence, rsequence;
 };
 
 
@@ -140,7 +286,7 @@ struct HistorySplitCircularEvent : public Event {
     {}
 
     id_t id;
-    std::string sequence;
+    SequenceView sequence;
     node_meta_t meta;
 };
 
@@ -150,7 +296,9 @@ struct HistorySplitCircularEvent : public Event {
 
 struct TimeIntervalEvent : public Event {
     TimeIntervalEvent()
-        : Event(MSG_TIME_INTERVAL)
+        : Event(MSG_TIME_INTERVAL),
+          t(0),
+          n_bases(0)
     {}
 
     enum interval_level_t {
@@ -161,9 +309,34 @@ struct TimeIntervalEvent : public Event {
     };
 
     interval_level_t level;
+    // reads and bases the processor has consumed so far
+    uint64_t t;
+    uint64_t n_bases;
+};
+
+
+/* Sent when the dBG's estimated false positive rate first rises above
+ * the processor's warning threshold.
+ */
+struct FPWarningEvent : public Event {
+    FPWarningEvent()
+        : Event(MSG_FP_WARNING)
+    {}
+
+    double   estimated_fp;
+    double   threshold;
     uint64_t t;
 };
 
+
+/* Build an event in pooled memory; events are created per node change,
+ * so they should not cost a heap allocation each.
+ */
+template <class EventType>
+std::shared_ptr<EventType> make_event() {
+    return std::allocate_shared<EventType>(EventAllocator<EventType>());
+}
+
 }
 }
 
@@ -16,14 +16,15 @@
 
 #include <iostream>
 #include <sstream>
-#include <deque>
 #include <thread>
 #include <memory>
 #include <mutex>
 #include <atomic>
 #include <condition_variable>
 #include <set>
+#include <vector>
 #include <chrono>
+#include <cstdint>
 
 #include "boink.hh"
 #include "event_types.hh"
@@ -77,18 +78,131 @@ public:
 };
 
 
+/* Bounded lock-free queue for many producers and a single consumer,
+ * after Vyukov's bounded MPMC queue: each cell carries a sequence
+ * number that says whether it is free for the producer at a given
+ * position or filled for the consumer at it. Capacity is rounded up to
+ * a power of two.
+ */
+template <typename T>
+class MPSCRing {
+
+    struct cell_t {
+        std::atomic<size_t> sequence;
+        T                   data;
+    };
+
+    std::unique_ptr<cell_t[]> _buffer;
+    const size_t              _mask;
+
+    // producers and the consumer each get their own cache line
+    char                      _pad0[64];
+    std::atomic<size_t>       _enqueue_pos;
+    char                      _pad1[64];
+    size_t                    _dequeue_pos;
+
+    static size_t _round_up(size_t n) {
+        size_t capacity = 2;
+        while (capacity < n) {
+            capacity <<= 1;
+        }
+        return capacity;
+    }
+
+public:
+
+    MPSCRing(size_t capacity)
+        : _buffer(new cell_t[_round_up(capacity)]),
+          _mask(_round_up(capacity) - 1),
+          _enqueue_pos(0),
+          _dequeue_pos(0)
+    {
+        for (size_t i = 0; i <= _mask; ++i) {
+            _buffer[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    size_t capacity() const {
+        return _mask + 1;
+    }
+
+    // positions claimed by producers so far; a position below this has
+    // been or is being pushed
+    size_t enqueue_pos() const {
+        return _enqueue_pos.load(std::memory_order_acquire);
+    }
+
+    // consumer only; the position the next pop takes
+    size_t dequeue_pos() const {
+        return _dequeue_pos;
+    }
+
+    // moves from data only on success; false if the ring is full
+    bool push(T& data) {
+        cell_t * cell;
+        size_t pos = _enqueue_pos.load(std::memory_order_relaxed);
+        while (1) {
+            cell = &_buffer[pos & _mask];
+            size_t seq = cell->sequence.load(std::memory_order_acquire);
+            intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+            if (diff == 0) {
+                if (_enqueue_pos.compare_exchange_weak(pos, pos + 1,
+                                                       std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = _enqueue_pos.load(std::memory_order_relaxed);
+            }
+        }
+        cell->data = std::move(data);
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    // consumer only; false if the next cell hasn't been filled yet
+    bool pop(T& data) {
+        cell_t * cell = &_buffer[_dequeue_pos & _mask];
+        size_t seq = cell->sequence.load(std::memory_order_acquire);
+        if ((intptr_t)seq - (intptr_t)(_dequeue_pos + 1) < 0) {
+            return false;
+        }
+        data = std::move(cell->data);
+        cell->sequence.store(_dequeue_pos + _mask + 1, std::memory_order_release);
+        ++_dequeue_pos;
+        return true;
+    }
+};
+
+
+/* Runs handle_msg on its own thread for every whitelisted event it is
+ * notified of. Events go through an MPSCRing, so notifying never takes
+ * a lock unless it wakes the worker, which happens only when the queue
+ * goes from empty to non-empty; the worker then drains in batches.
+ * _to_process counts events queued or being handled: past MAX_EVENTS,
+ * notify blocks until the worker gets it down to MIN_EVENTS_RESTART.
+ */
 class EventListener  {
 protected:
 
+    static const uint64_t DRAIN_BATCH = 256;
+
     std::mutex m_mutex;
+    // the worker waits on m_cv for events; everyone else on
+    // m_processed_cv for the worker
     std::condition_variable m_cv;
+    std::condition_variable m_processed_cv;
     std::unique_ptr<ScopedThread> m_thread;
-    std::deque<shared_ptr<events::Event>> m_queue;
     std::set<events::event_t> msg_type_whitelist;
     bool _shutdown;
-    uint64_t _to_process;
+    std::atomic<uint64_t> _to_process;
+    std::atomic<uint64_t> _n_waiting;
+    // ring positions below this are dropped instead of handled
+    std::atomic<size_t>   _discard_until;
     uint64_t MAX_EVENTS;
     uint64_t MIN_EVENTS_RESTART;
+    MPSCRing<shared_ptr<events::Event>> m_queue;
 
 public:
 
@@ -97,10 +211,14 @@ public:
     EventListener(const std::string& thread_name)
         : m_mutex(),
           m_cv(),
+          m_processed_cv(),
           _shutdown(false),
           _to_process(0),
+          _n_waiting(0),
+          _discard_until(0),
           MAX_EVENTS(50000),
           MIN_EVENTS_RESTART(MAX_EVENTS * 0.9),
+          m_queue(MAX_EVENTS + MAX_EVENTS / 4),
           THREAD_NAME("EventListener::" + thread_name)
     {
         msg_type_whitelist.insert(MSG_EXIT_THREAD);
@@ -118,16 +236,10 @@ public:
 
     void exit_thread() {
 		auto _exit_event = make_shared<Event>(MSG_EXIT_THREAD);
-        {
-            std::unique_lock<std::mutex> lock(m_mutex);
-            m_queue.push_back(_exit_event);
-        }
-        m_cv.notify_all();
+        _enqueue(_exit_event);
 
-        {
-            std::unique_lock<std::mutex> lk(m_mutex);
-            m_cv.wait(lk, [this]{ return _shutdown; });
-        }
+        std::unique_lock<std::mutex> lk(m_mutex);
+        m_processed_cv.wait(lk, [this]{ return _shutdown; });
 	}
 
     /// Get the ID of this thread instance
@@ -146,32 +258,43 @@ public:
     void notify(shared_ptr<events::Event> event) {
         //std::this_thread::sleep_for(std::chrono::milliseconds(250));
         if (msg_type_whitelist.count(event->msg_type)) {
-            {
-                std::unique_lock<std::mutex> lk(m_mutex);
-                if (_to_process > MAX_EVENTS) {
-                    _cerr(THREAD_NAME << " hit MAX_EVENTS ("
-                          << MAX_EVENTS << ") on queue; blocking "
-                          "until " << MIN_EVENTS_RESTART << " events.");
-                    wait_on_processing(MIN_EVENTS_RESTART);
-
-                }
-                ++_to_process;
-                m_queue.push_back(event);
+            if (_to_process.load() > MAX_EVENTS) {
+                _cerr(THREAD_NAME << " hit MAX_EVENTS ("
+                      << MAX_EVENTS << ") on queue; blocking "
+                      "until " << MIN_EVENTS_RESTART << " events.");
+                wait_on_processing(MIN_EVENTS_RESTART);
             }
-            m_cv.notify_one();
+            _enqueue(event);
         } else {
             pdebug("Filtered event of type " << event->msg_type);
         }
 	}
 
+    bool accepts(events::event_t msg_type) const {
+        return msg_type_whitelist.count(msg_type) > 0;
+    }
+
+    // events queued or being handled; safe to poll from any thread
+    uint64_t queue_depth() const {
+        return _to_process.load();
+    }
+
+    // drop the events in the queue now instead of handling them; ones
+    // the worker has already taken, and ones notified later, are handled
     void clear_events() {
-        std::unique_lock<std::mutex> lock(m_mutex);
-        m_queue.clear();
+        size_t until = m_queue.enqueue_pos();
+        size_t current = _discard_until.load();
+        while (current < until &&
+               !_discard_until.compare_exchange_weak(current, until)) {
+        }
     }
 
     void wait_on_processing(uint64_t min_events_restart) {
         std::unique_lock<std::mutex> lock(m_mutex);
-        m_cv.wait(lock, [&]{ return _to_process <= min_events_restart; });
+        ++_n_waiting;
+        m_processed_cv.wait(lock, [&]{ return _shutdown ||
+                                              _to_process.load() <= min_events_restart; });
+        --_n_waiting;
     }
 
 protected:
@@ -179,46 +302,72 @@ protected:
     EventListener(const EventListener&);
     EventListener& operator=(const EventListener&);
 
+    void _enqueue(shared_ptr<events::Event>& event) {
+        // counted before it's pushed, so the count never runs behind
+        // what the worker has popped
+        const bool was_empty = _to_process.fetch_add(1) == 0;
+        while (!m_queue.push(event)) {
+            std::this_thread::yield();
+        }
+        if (was_empty) {
+            // taking the lock orders this against the worker's check
+            // of _to_process before it sleeps
+            { std::lock_guard<std::mutex> lk(m_mutex); }
+            m_cv.notify_one();
+        }
+    }
+
+    void _processed(uint64_t n_processed) {
+        _to_process.fetch_sub(n_processed);
+        if (_n_waiting.load() > 0) {
+            { std::lock_guard<std::mutex> lk(m_mutex); }
+            m_processed_cv.notify_all();
+        }
+    }
+
 	void process() {
         _cerr(THREAD_NAME << " listening "
               << "at thread ID " << get_current_thread_id());
 
+        shared_ptr<Event> msg;
 		while (1) {
-			shared_ptr<Event> msg;
 			{
 				// Wait for a message to be added to the queue
 				std::unique_lock<std::mutex> lk(m_mutex);
-				m_cv.wait(lk, [this]{ return !m_queue.empty(); });
-
-				if (m_queue.empty())
-					continue;
-
-				msg = m_queue.front();
-				m_queue.pop_front();
-
-                if (m_queue.size() < MIN_EVENTS_RESTART) {
-                    m_cv.notify_one();
-                }
+				m_cv.wait(lk, [this]{ return _to_process.load() > 0; });
 			}
 
-			if (msg->msg_type == MSG_EXIT_THREAD) {
-                handle_exit();
-                _cerr("Exit " << THREAD_NAME 
-                      << " listener at thread ID " << get_current_thread_id());
-                {
-                    std::unique_lock<std::mutex> lk(m_mutex);
-                    _shutdown = true;
+            uint64_t n_processed = 0;
+            size_t pos = m_queue.dequeue_pos();
+            while (n_processed < DRAIN_BATCH && m_queue.pop(msg)) {
+                ++n_processed;
+
+                if (msg->msg_type == MSG_EXIT_THREAD) {
+                    handle_exit();
+                    _cerr("Exit " << THREAD_NAME 
+                          << " listener at thread ID " << get_current_thread_id());
+                    _to_process.fetch_sub(n_processed);
+                    {
+                        std::unique_lock<std::mutex> lk(m_mutex);
+                        _shutdown = true;
+                    }
+                    m_processed_cv.notify_all();
+                    return;
                 }
-                m_cv.notify_all();
-                return;
-	        }
 
-            handle_msg(msg);
+                if (pos++ < _discard_until.load()) {
+                    pdebug("Discarded event of type " << msg->msg_type);
+                } else {
+                    handle_msg(msg);
+                }
+                msg.reset();
+            }
 
-            {
-                std::unique_lock<std::mutex> lk(m_mutex);
-                --_to_process;
-                m_cv.notify_all();
+            if (n_processed) {
+                _processed(n_processed);
+            } else {
+                // a producer has counted an event it hasn't pushed yet
+                std::this_thread::yield();
             }
 		}
 	}
@@ -233,15 +382,77 @@ protected:
 };
 
 
+/* Keeps the t of each TimeIntervalEvent it handles, in the order they
+ * are handled. hold() stalls the worker at its next event until
+ * release(), so a queue can be filled up behind it; lets the queue's
+ * ordering and back-pressure be checked from outside.
+ */
+class EventRecorder : public EventListener {
+protected:
+
+    std::mutex              _hold_mutex;
+    std::condition_variable _hold_cv;
+    bool                    _held;
+    std::vector<uint64_t>   _handled;
+
+public:
+
+    EventRecorder()
+        : EventListener("EventRecorder"),
+          _held(false)
+    {
+        msg_type_whitelist.insert(MSG_TIME_INTERVAL);
+    }
+
+    void hold() {
+        std::lock_guard<std::mutex> lock(_hold_mutex);
+        _held = true;
+    }
+
+    void release() {
+        {
+            std::lock_guard<std::mutex> lock(_hold_mutex);
+            _held = false;
+        }
+        _hold_cv.notify_all();
+    }
+
+    // only once the worker has exited
+    const std::vector<uint64_t>& handled() const {
+        return _handled;
+    }
+
+protected:
+
+    virtual void handle_msg(shared_ptr<events::Event> event) {
+        {
+            std::unique_lock<std::mutex> lock(_hold_mutex);
+            _hold_cv.wait(lock, [this]{ return !_held; });
+        }
+        if (event->msg_type == MSG_TIME_INTERVAL) {
+            _handled.push_back(static_cast<TimeIntervalEvent*>(event.get())->t);
+        }
+    }
+};
+
+
 class EventNotifier {
 
 protected:
 
     std::set<EventListener*> registered_listeners;
 
+#ifdef BOINK_STAGE_TIMING
+    // time spent in notify since the last take_notify_ns
+    uint64_t _notify_ns;
+#endif
+
 public:
 
     EventNotifier()
+#ifdef BOINK_STAGE_TIMING
+        : _notify_ns(0)
+#endif
     {
     }
 
@@ -253,11 +464,37 @@ public:
     void notify(shared_ptr<events::Event> event) {
         //pdebug("Notifying " << registered_listeners.size()
         //       << " listeners of event of type " << event->msg_type);
+#ifdef BOINK_STAGE_TIMING
+        auto start = std::chrono::steady_clock::now();
+#endif
         for (auto listener : registered_listeners) {
             if (listener != nullptr) {
                 listener->notify(event);
             }
         }
+#ifdef BOINK_STAGE_TIMING
+        _notify_ns += std::chrono::duration_cast<std::chrono::nanoseconds>
+            (std::chrono::steady_clock::now() - start).count();
+#endif
+    }
+
+#ifdef BOINK_STAGE_TIMING
+    uint64_t take_notify_ns() {
+        uint64_t ns = _notify_ns;
+        _notify_ns = 0;
+        return ns;
+    }
+#endif
+
+    // whether anyone listening would take an event of this type, so
+    // that it needn't be built otherwise
+    bool wants(events::event_t msg_type) const {
+        for (auto listener : registered_listeners) {
+            if (listener != nullptr && listener->accepts(msg_type)) {
+                return true;
+            }
+        }
+        return false;
     }
 
     void register_listener(EventListener* listener) {
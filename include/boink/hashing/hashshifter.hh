@@ -134,15 +134,15 @@ public:
         return h;
     }
 
+    // kmer_window is a ring over kmer_buffer: once the cursor has been
+    // shifted left, the k-mer no longer starts at kmer_buffer[0]
     std::string get_cursor() const {
-        return std::string(kmer_buffer,
-                           kmer_buffer + this->_K);
+        return std::string(kmer_window.cbegin(),
+                           kmer_window.cend());
     }
 
     void get_cursor(std::deque<char>& d) const {
-        for (uint16_t i = 0; i < this->_K; ++i) {
-            d.push_back(kmer_buffer[i]);
-        }
+        d.insert(d.end(), kmer_window.cbegin(), kmer_window.cend());
     }
 
 private:
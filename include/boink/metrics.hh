@@ -11,6 +11,8 @@
 #define BOINK_UTILITY_METRICS_HH
 
 #include <algorithm>
+#include <chrono>
+#include <cstdint>
 #include <iterator>
 #include <random>
 
@@ -108,6 +110,42 @@ public:
 };
 
 
+/**
+ * @Synopsis  Stopwatch for timing the stages of a hot path: lap() gives
+ *            the nanoseconds since the last lap (or restart), total()
+ *            those since the last restart.
+ */
+struct StageTimer {
+
+    typedef std::chrono::steady_clock clock_type;
+
+    clock_type::time_point start;
+    clock_type::time_point last;
+
+    StageTimer()
+        : start(clock_type::now()),
+          last(start)
+    {
+    }
+
+    void restart() {
+        start = last = clock_type::now();
+    }
+
+    uint64_t lap() {
+        auto now = clock_type::now();
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(now - last).count();
+        last = now;
+        return ns;
+    }
+
+    uint64_t total() const {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>
+            (clock_type::now() - start).count();
+    }
+};
+
+
 }
 }
 
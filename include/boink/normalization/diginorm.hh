@@ -130,6 +130,10 @@ public:
         ++n_seq_updates;
     }
 
+    double estimated_fp() {
+        return graph->estimated_fp();
+    }
+
     void report() {
         std::cerr << "\t" << n_seq_updates << " used for cDBG updates." << std::endl;
     }
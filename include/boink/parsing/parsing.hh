@@ -12,11 +12,14 @@
 
 
 #include <algorithm>
+#include <cstdint>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "boink/boink.hh"
 
+#define DEFAULT_PHRED_OFFSET 33
 
 namespace boink {
 namespace parsing {
@@ -88,6 +91,61 @@ bool check_is_right(const std::string& name);
 
 void filter_length(ReadBundle& bundle, uint32_t length);
 
+
+/* Masks bases whose Phred score falls below min_quality and splits
+ * reads into the maximal unmasked runs at least min_length long (ie,
+ * the K of the consuming graph), so that no k-mer containing a low
+ * quality base is ever passed on. Reads without qualities (FASTA)
+ * pass through untouched.
+ */
+class QualityFilter {
+
+    uint8_t  _min_quality;
+    uint16_t _min_length;
+    uint8_t  _offset;
+
+    uint64_t _n_reads_masked;
+    uint64_t _n_bases_masked;
+    uint64_t _n_kmers_filtered;
+
+    std::vector<uint8_t> _mask;
+
+public:
+
+    typedef std::pair<uint32_t, uint32_t> segment_t; // start, length
+
+    QualityFilter(uint8_t min_quality,
+                  uint16_t min_length,
+                  uint8_t offset=DEFAULT_PHRED_OFFSET);
+
+    // Fill segments with the passing runs of read; returns true if
+    // the whole read passes and can be used as-is.
+    bool find_segments(const Read& read,
+                       std::vector<segment_t>& segments);
+
+    Read make_segment(const Read& read, const segment_t& segment) const;
+
+    uint8_t min_quality() const {
+        return _min_quality;
+    }
+
+    uint16_t min_length() const {
+        return _min_length;
+    }
+
+    uint64_t n_reads_masked() const {
+        return _n_reads_masked;
+    }
+
+    uint64_t n_bases_masked() const {
+        return _n_bases_masked;
+    }
+
+    uint64_t n_kmers_filtered() const {
+        return _n_kmers_filtered;
+    }
+};
+
 }
 }
 
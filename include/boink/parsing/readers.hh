@@ -56,10 +56,20 @@
 #include <string>
 #include <utility>
 #include <memory>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 #include "boink/boink.hh"
 #include "boink/parsing/parsing.hh"
 
+#define DEFAULT_PREFETCH_READS 10000
+#define DEFAULT_FANOUT_CHUNK_SIZE 1000
+#define DEFAULT_FANOUT_CAPACITY 64
 
 namespace seqan
 {
@@ -277,6 +287,325 @@ public:
 };
 
 
+/* Presents a list of files as one continuous read stream. While reads
+ * are consumed from file N, file N+1 is opened on a background thread
+ * and its first prefetch_reads reads are decoded ahead of time, so that
+ * moving across a file boundary doesn't stall on opening and parsing.
+ */
+template <class ParserType = FastxReader>
+class MultiFileReader {
+
+    struct prefetch_t {
+        ReadParserPtr<ParserType> parser;
+        std::deque<Read>          reads;
+    };
+
+    std::vector<std::string> _filenames;
+    size_t                   _prefetch_reads;
+    size_t                   _file_index;
+    prefetch_t               _current;
+    std::future<prefetch_t>  _next;
+
+    static prefetch_t _open(const std::string filename,
+                            size_t prefetch_reads) {
+        prefetch_t result;
+        result.parser = get_parser<ParserType>(filename);
+        while (result.reads.size() < prefetch_reads &&
+               !result.parser->is_complete()) {
+            try {
+                result.reads.push_back(result.parser->get_next_read());
+            } catch (NoMoreReadsAvailable) {
+                result.parser.reset();
+                break;
+            }
+        }
+        return result;
+    }
+
+    void _prefetch(size_t index) {
+        if (index < _filenames.size()) {
+            _next = std::async(std::launch::async,
+                               &MultiFileReader::_open,
+                               _filenames[index],
+                               _prefetch_reads);
+        }
+    }
+
+    bool _current_complete() {
+        return _current.reads.empty() &&
+               (!_current.parser || _current.parser->is_complete());
+    }
+
+    // Move on to the next file with reads remaining, blocking on the
+    // prefetch if it hasn't finished; false if all files are exhausted.
+    bool _next_file() {
+        while (_current_complete()) {
+            if (!_next.valid()) {
+                return false;
+            }
+            _current = _next.get();
+            ++_file_index;
+            _prefetch(_file_index + 1);
+        }
+        return true;
+    }
+
+public:
+
+    MultiFileReader(const std::vector<std::string>& filenames,
+                    size_t prefetch_reads=DEFAULT_PREFETCH_READS)
+        : _filenames(filenames),
+          _prefetch_reads(prefetch_reads),
+          _file_index(0) {
+
+        if (_filenames.size() == 0) {
+            throw BoinkFileException("No input files given.");
+        }
+        _prefetch(1);
+        _current = _open(_filenames.front(), _prefetch_reads);
+    }
+
+    bool is_complete() {
+        return !_next_file();
+    }
+
+    Read get_next_read() {
+        while (_next_file()) {
+            if (!_current.reads.empty()) {
+                Read read = std::move(_current.reads.front());
+                _current.reads.pop_front();
+                return read;
+            }
+            try {
+                return _current.parser->get_next_read();
+            } catch (NoMoreReadsAvailable) {
+                _current.parser.reset();
+            }
+        }
+        throw NoMoreReadsAvailable();
+    }
+
+    size_t n_files() const {
+        return _filenames.size();
+    }
+
+    const std::string& current_filename() const {
+        return _filenames[_file_index];
+    }
+};
+
+
+/* Parses a set of files once and broadcasts the reads to several
+ * consumers, each usually running on its own thread. Reads are handed
+ * out in chunks from a bounded ring: the parser thread blocks once it
+ * is capacity chunks ahead of the slowest subscriber, so memory stays
+ * bounded and the slowest consumer sets the pace.
+ */
+template <class ParserType = FastxReader>
+class FanOutReader {
+
+    typedef std::vector<Read>                chunk_t;
+    typedef std::shared_ptr<const chunk_t>   chunk_ptr_t;
+
+public:
+
+    // Duck-types the reader interface used by FileProcessor::advance.
+    class Subscriber {
+
+        FanOutReader* _source;
+        size_t        _id;
+        uint64_t      _next_chunk;
+        chunk_ptr_t   _chunk;
+        size_t        _pos;
+
+        bool _fill() {
+            while (!_chunk || _pos == _chunk->size()) {
+                _chunk = _source->_acquire(_id, _next_chunk);
+                _pos = 0;
+                if (!_chunk) {
+                    return false;
+                }
+                ++_next_chunk;
+            }
+            return true;
+        }
+
+    public:
+
+        Subscriber(FanOutReader* source, size_t id)
+            : _source(source),
+              _id(id),
+              _next_chunk(0),
+              _pos(0)
+        {
+        }
+
+        bool is_complete() {
+            return !_fill();
+        }
+
+        Read get_next_read() {
+            if (!_fill()) {
+                throw NoMoreReadsAvailable();
+            }
+            return (*_chunk)[_pos++];
+        }
+
+        // Stop taking part in back-pressure, eg. when a consumer bails.
+        void close() {
+            _source->_release(_id);
+            _chunk.reset();
+        }
+    };
+
+protected:
+
+    MultiFileReader<ParserType> _reader;
+    size_t                      _chunk_size;
+    size_t                      _capacity;
+
+    std::vector<chunk_ptr_t>    _ring;
+    std::vector<uint64_t>       _cursors;
+    std::vector<Subscriber>     _subscribers;
+    uint64_t                    _n_chunks;
+    bool                        _done;
+    bool                        _shutdown;
+    std::exception_ptr          _error;
+
+    std::mutex                  _mutex;
+    std::condition_variable     _cv;
+    std::thread                 _producer;
+
+    uint64_t _min_cursor() const {
+        uint64_t result = UINT64_MAX;
+        for (auto cursor : _cursors) {
+            result = std::min(result, cursor);
+        }
+        return result;
+    }
+
+    void _produce() {
+        try {
+            while (1) {
+                auto chunk = std::make_shared<chunk_t>();
+                chunk->reserve(_chunk_size);
+                while (chunk->size() < _chunk_size && !_reader.is_complete()) {
+                    try {
+                        chunk->push_back(_reader.get_next_read());
+                    } catch (NoMoreReadsAvailable) {
+                        break;
+                    }
+                }
+                if (chunk->size() == 0) {
+                    break;
+                }
+
+                std::unique_lock<std::mutex> lock(_mutex);
+                _cv.wait(lock, [this]{
+                    uint64_t slowest = _min_cursor();
+                    return _shutdown ||
+                           slowest == UINT64_MAX ||
+                           _n_chunks < slowest + _capacity;
+                });
+                // nobody left to read it
+                if (_shutdown || _min_cursor() == UINT64_MAX) {
+                    break;
+                }
+                _ring[_n_chunks % _capacity] = chunk;
+                ++_n_chunks;
+                lock.unlock();
+                _cv.notify_all();
+            }
+        } catch (...) {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _error = std::current_exception();
+        }
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _done = true;
+        }
+        _cv.notify_all();
+    }
+
+    chunk_ptr_t _acquire(size_t id, uint64_t index) {
+        chunk_ptr_t chunk;
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _cv.wait(lock, [&]{ return index < _n_chunks || _done; });
+            if (index < _n_chunks) {
+                chunk = _ring[index % _capacity];
+                _cursors[id] = index + 1;
+            } else if (_error) {
+                std::rethrow_exception(_error);
+            }
+        }
+        _cv.notify_all();
+        return chunk;
+    }
+
+    void _release(size_t id) {
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _cursors[id] = UINT64_MAX;
+        }
+        _cv.notify_all();
+    }
+
+public:
+
+    FanOutReader(const std::vector<std::string>& filenames,
+                 size_t n_subscribers,
+                 size_t chunk_size=DEFAULT_FANOUT_CHUNK_SIZE,
+                 size_t capacity=DEFAULT_FANOUT_CAPACITY)
+        : _reader(filenames),
+          _chunk_size(chunk_size),
+          _capacity(capacity),
+          _ring(capacity),
+          _cursors(n_subscribers, 0),
+          _n_chunks(0),
+          _done(false),
+          _shutdown(false) {
+
+        if (n_subscribers == 0 || chunk_size == 0 || capacity == 0) {
+            throw BoinkException("FanOutReader needs at least one subscriber, "
+                                 "chunk, and ring slot.");
+        }
+        for (size_t i = 0; i < n_subscribers; ++i) {
+            _subscribers.emplace_back(this, i);
+        }
+        _producer = std::thread(&FanOutReader::_produce, this);
+    }
+
+    ~FanOutReader() {
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _shutdown = true;
+        }
+        _cv.notify_all();
+        if (_producer.joinable()) {
+            _producer.join();
+        }
+    }
+
+    FanOutReader(const FanOutReader&) = delete;
+    FanOutReader& operator=(const FanOutReader&) = delete;
+
+    Subscriber& subscriber(size_t id) {
+        return _subscribers.at(id);
+    }
+
+    size_t n_subscribers() const {
+        return _subscribers.size();
+    }
+
+    // chunks handed to the ring so far
+    uint64_t n_published() {
+        std::unique_lock<std::mutex> lock(_mutex);
+        return _n_chunks;
+    }
+};
+
+
 } // namespace parsing
 
 } // namespace boink
@@ -309,6 +309,14 @@ public:
         return S->n_occupied();
     }
 
+    uint64_t n_saturated() const {
+        return S->n_saturated();
+    }
+
+    double estimated_fp() {
+        return S->estimated_fp();
+    }
+
     uint64_t n_partitions() const {
         return S->n_partition_stores();
     }
@@ -10,10 +10,16 @@
 #ifndef BOINK_PROCESSORS_HH
 #define BOINK_PROCESSORS_HH
 
+#include <algorithm>
+#include <array>
+#include <thread>
 #include <tuple>
+#include <vector>
 #include <memory>
 #include <fstream>
+#include <iomanip>
 #include <iostream>
+#include <limits>
 
 #include "boink/boink.hh"
 #include "boink/parsing/parsing.hh"
@@ -22,6 +28,7 @@
 #include "boink/event_types.hh"
 #include "boink/hashing/hashing_types.hh"
 #include "boink/hashing/exceptions.hh"
+#include "boink/reporting/record_writer.hh"
 #include "boink/cdbg/compactor.hh"
 #include "boink/ukhs_signature.hh"
 
@@ -31,6 +38,8 @@
 #define DEFAULT_FINE_INTERVAL 10000
 #define DEFAULT_MEDIUM_INTERVAL 100000
 #define DEFAULT_COARSE_INTERVAL 1000000
+#define DEFAULT_COMPACTOR_BATCH_SIZE 1000
+#define DEFAULT_FP_WARNING_THRESHOLD 0.15
 
 namespace boink {
 
@@ -87,35 +96,44 @@ protected:
 
     std::array<IntervalCounter, 3> counters;
     uint64_t _n_reads;
+    // bases read, before quality filtering
+    uint64_t _n_bases;
+
+    double _fp_threshold;
+    bool   _fp_warned;
+
+    std::unique_ptr<parsing::QualityFilter> _quality_filter;
+    std::vector<parsing::QualityFilter::segment_t> _quality_segments;
 
     bool _ticked(interval_state tick) {
         return tick.fine || tick.medium || tick.coarse || tick.end;
     }
 
+    shared_ptr<events::TimeIntervalEvent>
+    _make_interval_event(events::TimeIntervalEvent::interval_level_t level) {
+        auto event = events::make_event<events::TimeIntervalEvent>();
+        event->level = level;
+        event->t = _n_reads;
+        event->n_bases = _n_bases;
+        return event;
+    }
+
     interval_state _notify_tick(uint64_t n_ticks) {
         interval_state result;
 
         if (counters[0].poll(n_ticks)) {
              //std::cerr << "processed " << _n_reads << " sequences." << std::endl;               
              derived().report();
-             auto event = make_shared<events::TimeIntervalEvent>();
-             event->level = events::TimeIntervalEvent::FINE;
-             event->t = _n_reads;
-             notify(event);
+             _check_fp();
+             notify(_make_interval_event(events::TimeIntervalEvent::FINE));
              result.fine = true;
         }
         if (counters[1].poll(n_ticks)) {
-             auto event = make_shared<events::TimeIntervalEvent>();
-             event->level = events::TimeIntervalEvent::MEDIUM;
-             event->t = _n_reads;
-             notify(event);
+             notify(_make_interval_event(events::TimeIntervalEvent::MEDIUM));
              result.medium = true;
         }
         if (counters[2].poll(n_ticks)) {
-             auto event = make_shared<events::TimeIntervalEvent>();
-             event->level = events::TimeIntervalEvent::COARSE;
-             event->t = _n_reads;
-             notify(event);
+             notify(_make_interval_event(events::TimeIntervalEvent::COARSE));
              result.coarse = true;
         }
 
@@ -123,13 +141,74 @@ protected:
         return result;
     }
 
-    void _notify_stop() {
-        auto event = make_shared<events::TimeIntervalEvent>();
-        event->level = events::TimeIntervalEvent::END;
+    /* Warn, on stderr and with an FPWarningEvent, the first time the
+     * estimated FP rate rises above the threshold.
+     */
+    void _check_fp() {
+        if (_fp_threshold <= 0 || _fp_warned) {
+            return;
+        }
+        double fp = derived().estimated_fp();
+        if (fp <= _fp_threshold) {
+            return;
+        }
+        _fp_warned = true;
+
+        _cerr("WARNING: estimated false positive rate " << fp
+              << " exceeds " << _fp_threshold << " at read "
+              << _n_reads << "; the storage is too small.");
+        auto event = events::make_event<events::FPWarningEvent>();
+        event->estimated_fp = fp;
+        event->threshold = _fp_threshold;
         event->t = _n_reads;
         notify(event);
     }
 
+    void _notify_stop() {
+        derived().flush();
+        _check_fp();
+        notify(_make_interval_event(events::TimeIntervalEvent::END));
+    }
+
+    void _process_read(const parsing::Read& read) {
+        _n_bases += read.sequence.size();
+        if (!_quality_filter ||
+            _quality_filter->find_segments(read, _quality_segments)) {
+            derived().process_sequence(read);
+            return;
+        }
+        for (auto segment : _quality_segments) {
+            derived().process_sequence(_quality_filter->make_segment(read, segment));
+        }
+    }
+
+    template <class ReaderType>
+    interval_state _advance_reads(ReaderType& reader) {
+        parsing::Read read;
+
+        // Iterate through the reads and consume their k-mers.
+        while (!reader.is_complete()) {
+            try {
+                read = reader.get_next_read( );
+            } catch (parsing::NoMoreReadsAvailable) {
+                break;
+            }
+
+            read.set_clean_seq();
+            _process_read(read);
+
+            __sync_add_and_fetch( &_n_reads, 1 );
+            auto tick_result = _notify_tick(1);
+
+            if (_ticked(tick_result)) {
+                return tick_result;
+            }
+
+        }
+        _notify_stop();
+        return interval_state(false, false, false, true);
+    }
+
 
 public:
 
@@ -143,7 +222,10 @@ public:
            counters ({{ fine_interval, 
                         medium_interval,
                         coarse_interval }}),
-          _n_reads(0) {
+          _n_reads(0),
+          _n_bases(0),
+          _fp_threshold(DEFAULT_FP_WARNING_THRESHOLD),
+          _fp_warned(false) {
 
     }
 
@@ -163,6 +245,38 @@ public:
         return process(parser);
     }
 
+    /* Process several files as a single stream: the interval counters
+     * carry across file boundaries and END is only emitted once, after
+     * the last file. The next file is opened and read ahead of time.
+     */
+    uint64_t process(const std::vector<std::string>& filenames,
+                     size_t prefetch_reads=DEFAULT_PREFETCH_READS) {
+        parsing::MultiFileReader<ParserType> reader(filenames, prefetch_reads);
+        return process(reader);
+    }
+
+    uint64_t process(parsing::MultiFileReader<ParserType>& reader) {
+        while(1) {
+            auto state = advance(reader);
+            if (state.end) {
+                break;
+            }
+        }
+
+        return _n_reads;
+    }
+
+    uint64_t process(typename parsing::FanOutReader<ParserType>::Subscriber& reader) {
+        while(1) {
+            auto state = advance(reader);
+            if (state.end) {
+                break;
+            }
+        }
+
+        return _n_reads;
+    }
+
     uint64_t process(parsing::SplitPairedReader<ParserType>& reader) {
         while(1) {
             auto state = advance(reader);
@@ -187,10 +301,10 @@ public:
 
     void process_sequence(parsing::ReadBundle& bundle) {
         if (bundle.has_left) {
-            derived().process_sequence(bundle.left);
+            _process_read(bundle.left);
         }
         if (bundle.has_right) {
-            derived().process_sequence(bundle.right);
+            _process_read(bundle.right);
         }
     }
 
@@ -214,39 +328,79 @@ public:
     }
 
     interval_state advance(parsing::ReadParserPtr<ParserType>& parser) {
-        parsing::Read read;
+        return _advance_reads(*parser);
+    }
 
-        // Iterate through the reads and consume their k-mers.
-        while (!parser->is_complete()) {
-            try {
-                read = parser->get_next_read( );
-            } catch (parsing::NoMoreReadsAvailable) {
-                break;
-            }
+    interval_state advance(parsing::MultiFileReader<ParserType>& reader) {
+        return _advance_reads(reader);
+    }
 
-            read.set_clean_seq();
-            derived().process_sequence(read);
+    interval_state advance(typename parsing::FanOutReader<ParserType>::Subscriber& reader) {
+        return _advance_reads(reader);
+    }
 
-            __sync_add_and_fetch( &_n_reads, 1 );
-              auto tick_result = _notify_tick(1);
+    uint64_t n_reads() const {
+        return _n_reads;
+    }
 
-            bool end = false;
-            if (_ticked(tick_result)) {
-                return tick_result;
-            }
+    uint64_t n_bases() const {
+        return _n_bases;
+    }
 
-        }
-        _notify_stop();
-        return interval_state(false, false, false, true);
+    // Called once input is exhausted, before END is sent; processors
+    // that buffer reads override it to drain them.
+    void flush() {
     }
 
-    uint64_t n_reads() const {
-        return _n_reads;
+    // Processors that fill a dBG override this with its estimate.
+    double estimated_fp() {
+        return 0.0;
+    }
+
+    /* Threshold for the false positive warning; <= 0 turns it off. */
+    void set_fp_warning_threshold(double threshold) {
+        _fp_threshold = threshold;
+        _fp_warned = false;
+    }
+
+    double get_fp_warning_threshold() const {
+        return _fp_threshold;
+    }
+
+    /* Only pass on k-mers made entirely of bases with Phred score
+     * >= min_quality; min_length should be the K of the consumer.
+     */
+    void set_quality_filter(uint8_t min_quality,
+                            uint16_t min_length,
+                            uint8_t phred_offset=DEFAULT_PHRED_OFFSET) {
+        _quality_filter = std::make_unique<parsing::QualityFilter>(min_quality,
+                                                                   min_length,
+                                                                   phred_offset);
+    }
+
+    void clear_quality_filter() {
+        _quality_filter.reset();
+    }
+
+    uint64_t n_reads_masked() const {
+        return _quality_filter ? _quality_filter->n_reads_masked() : 0;
+    }
+
+    uint64_t n_bases_masked() const {
+        return _quality_filter ? _quality_filter->n_bases_masked() : 0;
+    }
+
+    uint64_t n_kmers_filtered() const {
+        return _quality_filter ? _quality_filter->n_kmers_filtered() : 0;
     }
 
 private:
 
-    FileProcessor() : _n_reads(0) {}
+    FileProcessor()
+        : _n_reads(0),
+          _n_bases(0),
+          _fp_threshold(DEFAULT_FP_WARNING_THRESHOLD),
+          _fp_warned(false) {}
 
     friend Derived;
 
@@ -292,6 +446,10 @@ public:
         __sync_add_and_fetch( &_n_consumed, this_n_consumed );
     }
 
+    double estimated_fp() {
+        return graph->estimated_fp();
+    }
+
     void report() {
         std::cerr << "\t and " << _n_consumed << " new k-mers." << std::endl;
     }
@@ -423,6 +581,10 @@ public:
         }
     }
 
+    double estimated_fp() {
+        return graph->estimated_fp();
+    }
+
     void report() {};
 
 };
@@ -439,25 +601,56 @@ protected:
     shared_ptr<cdbg::StreamingCompactor<GraphType>> compactor;
     shared_ptr<GraphType> graph;
 
+    unsigned int             _n_threads;
+    size_t                   _batch_size;
+    std::vector<std::string> _batch;
+
     typedef FileProcessor<StreamingCompactorProcessor<GraphType, ParserType>,
                           ParserType> Base;
 
+    void _flush_batch() {
+        if (_batch.size() == 0) {
+            return;
+        }
+        auto n_skipped = compactor->update_sequences(_batch, _n_threads);
+        if (n_skipped) {
+            std::cerr << "NOTE: Skipped " << n_skipped
+                      << " short or invalid sequences in batch ending at read "
+                      << this->_n_reads << std::endl;
+        }
+        _batch.clear();
+    }
+
 public:
 
     using Base::process_sequence;
     using events::EventNotifier::register_listener;
     
+    /* With n_threads > 1, reads are compacted in batches of batch_size
+     * through StreamingCompactor::update_sequences.
+     */
     StreamingCompactorProcessor(shared_ptr<cdbg::StreamingCompactor<GraphType>> compactor,
                                 uint64_t fine_interval=DEFAULT_FINE_INTERVAL,
                                 uint64_t medium_interval=DEFAULT_MEDIUM_INTERVAL,
-                                uint64_t coarse_interval=DEFAULT_COARSE_INTERVAL)
+                                uint64_t coarse_interval=DEFAULT_COARSE_INTERVAL,
+                                unsigned int n_threads=1,
+                                size_t batch_size=DEFAULT_COMPACTOR_BATCH_SIZE)
         : Base(fine_interval, medium_interval, coarse_interval),
           compactor(compactor),
-          graph(compactor->dbg)
+          graph(compactor->dbg),
+          _n_threads(n_threads > 0 ? n_threads : 1),
+          _batch_size(batch_size > 0 ? batch_size : 1)
     {
     }
 
     void process_sequence(const parsing::Read& read) {
+        if (_n_threads > 1) {
+            _batch.push_back(read.cleaned_seq);
+            if (_batch.size() >= _batch_size) {
+                _flush_batch();
+            }
+            return;
+        }
         try {
             compactor->update_sequence(read.cleaned_seq);
         } catch (hashing::InvalidCharacterException &e) {
@@ -480,6 +673,14 @@ public:
         }
     }
 
+    void flush() {
+        _flush_batch();
+    }
+
+    double estimated_fp() {
+        return graph->estimated_fp();
+    }
+
     void report() {
         //std::cerr << "\tcurrently " << compactor->cdbg->n_decision_nodes()
         //          << " d-nodes, " << compactor->cdbg->n_unitig_nodes()
@@ -540,5 +741,539 @@ public:
     void report() {}
 };
 
+/* Median of the given counts, averaging the two middle values when
+ * there is an even number of them (as python's statistics.median).
+ * Reorders counts in place rather than sorting a copy.
+ */
+inline double median_count(std::vector<storage::count_t>& counts) {
+    if (counts.size() == 0) {
+        return 0.0;
+    }
+    auto mid = counts.begin() + counts.size() / 2;
+    std::nth_element(counts.begin(), mid, counts.end());
+    if (counts.size() % 2) {
+        return *mid;
+    }
+    auto lower = std::max_element(counts.begin(), mid);
+    return (static_cast<double>(*lower) + *mid) / 2.0;
+}
+
+
+/* Split [0, n_items) into n_threads contiguous ranges and run
+ * func(begin, end, thread_index) on each in its own thread.
+ */
+template <class Func>
+void parallel_batch(size_t n_items, size_t n_threads, Func func) {
+    if (n_items == 0) {
+        return;
+    }
+    n_threads = std::max<size_t>(1, std::min(n_threads, n_items));
+    if (n_threads == 1) {
+        func(0, n_items, 0);
+        return;
+    }
+    size_t per_thread = (n_items + n_threads - 1) / n_threads;
+    std::vector<std::thread> workers;
+    for (size_t t = 0; t < n_threads; ++t) {
+        size_t begin = t * per_thread;
+        size_t end = std::min(begin + per_thread, n_items);
+        if (begin >= end) {
+            break;
+        }
+        workers.emplace_back(func, begin, end, t);
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+
+enum sequence_function_t {
+    KMER_COVERAGE,  // k-mer count
+    MEDIAN_COUNT,   // median k-mer count; per sequence only
+    KMER_DEGREE,    // k-mer degree
+    DEGREE_BIAS     // k-mer degree, plus heptamer-by-degree table
+};
+
+
+inline const char * sequence_function_repr(sequence_function_t func) {
+    switch(func) {
+        case KMER_COVERAGE:
+            return "KmerCoverage";
+        case MEDIAN_COUNT:
+            return "MedianCount";
+        case KMER_DEGREE:
+            return "KmerDegree";
+        case DEGREE_BIAS:
+            return "DegreeBias";
+        default:
+            return "FUNCTION";
+    }
+}
+
+
+enum function_scope_t {
+    PER_SEQUENCE,   // one value per read: the mean over its k-mers
+    PER_KMER        // one value per k-mer of each read
+};
+
+
+enum function_output_t {
+    OUTPUT_TSV,
+    OUTPUT_BINARY
+};
+
+
+#define DEFAULT_FUNCTION_BATCH_SIZE 10000
+#define N_HEPTAMERS 16384
+#define MAX_DBG_DEGREE 9
+
+
+/* Evaluates a built-in function against a dBG that has already been
+ * built; the graph is only queried. Reads are collected into batches
+ * which are split across n_threads worker threads, and the results
+ * are written in input order.
+ *
+ * PER_SEQUENCE writes a row per read, with the mean over its k-mers
+ * (the median for MEDIAN_COUNT); reads shorter than K get 0. PER_KMER
+ * writes a row per k-mer, with its position in the read. TSV output
+ * has columns read_n, name, [position,] value. Binary output is a
+ * reporting::RecordWriter file with the same columns minus the name;
+ * read it with boink.records.read_records.
+ */
+template <class GraphType,
+          class ParserType = parsing::FastxReader>
+class SequenceFunctionProcessor : public FileProcessor<SequenceFunctionProcessor<GraphType, ParserType>,
+                                                       ParserType> {
+
+protected:
+
+    typedef FileProcessor<SequenceFunctionProcessor<GraphType, ParserType>,
+                          ParserType> Base;
+    typedef std::array<uint64_t, MAX_DBG_DEGREE> degree_counts_t;
+
+    // what each worker thread keeps between batches
+    struct worker_t {
+        std::shared_ptr<typename GraphType::assembler_type> assembler;
+        std::vector<storage::count_t>                       counts;
+        std::vector<uint8_t>                                degrees;
+        std::vector<degree_counts_t>                        heptamers;
+    };
+
+    shared_ptr<GraphType>       graph;
+    sequence_function_t         _function;
+    function_scope_t            _scope;
+    function_output_t           _output_format;
+    std::string                 _output_filename;
+    std::ofstream               _output_stream;
+    std::unique_ptr<reporting::RecordWriter> _records;
+    size_t                      _batch_size;
+
+    std::vector<parsing::Read>        _batch;
+    std::vector<uint64_t>             _batch_read_n;
+    std::vector<std::vector<double>>  _values;
+    std::vector<worker_t>             _workers;
+
+    static size_t _heptamer_index(const std::string& sequence, size_t start) {
+        size_t index = 0;
+        for (size_t i = start; i < start + 7; ++i) {
+            index <<= 2;
+            switch(sequence[i]) {
+                case 'C': index |= 1; break;
+                case 'G': index |= 2; break;
+                case 'T': index |= 3; break;
+                default: break;
+            }
+        }
+        return index;
+    }
+
+    // Fill worker.degrees with the degree of each k-mer in sequence,
+    // and count heptamers by degree if asked to.
+    void _find_degrees(const std::string& sequence,
+                       worker_t& worker,
+                       bool count_heptamers) {
+        auto& assembler = worker.assembler;
+        const uint16_t K = graph->K();
+        size_t pos = 0;
+
+        worker.degrees.clear();
+        assembler->set_cursor(sequence);
+        while (1) {
+            uint8_t degree = std::min<uint8_t>(assembler->degree(),
+                                               MAX_DBG_DEGREE - 1);
+            worker.degrees.push_back(degree);
+            if (count_heptamers && K >= 7) {
+                for (size_t i = pos; i + 7 <= pos + K; ++i) {
+                    ++worker.heptamers[_heptamer_index(sequence, i)][degree];
+                }
+            }
+            if (pos + K >= sequence.length()) {
+                break;
+            }
+            assembler->shift_right(sequence[pos + K]);
+            ++pos;
+        }
+    }
+
+    template <class Container>
+    void _put_values(const Container& kmer_values,
+                     std::vector<double>& values) {
+        if (_scope == PER_KMER) {
+            values.assign(kmer_values.begin(), kmer_values.end());
+            return;
+        }
+        uint64_t total = 0;
+        for (auto value : kmer_values) {
+            total += value;
+        }
+        values.push_back(static_cast<double>(total) / kmer_values.size());
+    }
+
+    void _evaluate(const std::string& sequence,
+                   worker_t& worker,
+                   std::vector<double>& values) {
+        values.clear();
+        if (sequence.length() < graph->K()) {
+            if (_scope == PER_SEQUENCE) {
+                values.push_back(0.0);
+            }
+            return;
+        }
+        switch(_function) {
+            case KMER_COVERAGE:
+                worker.counts = graph->query_sequence(sequence);
+                _put_values(worker.counts, values);
+                break;
+            case MEDIAN_COUNT:
+                worker.counts = graph->query_sequence(sequence);
+                values.push_back(median_count(worker.counts));
+                break;
+            case KMER_DEGREE:
+            case DEGREE_BIAS:
+                _find_degrees(sequence, worker, _function == DEGREE_BIAS);
+                _put_values(worker.degrees, values);
+                break;
+        }
+    }
+
+    void _flush_batch() {
+        if (_batch.size() == 0) {
+            return;
+        }
+        _values.resize(_batch.size());
+
+        parallel_batch(_batch.size(), _workers.size(),
+            [&](size_t begin, size_t end, size_t t) {
+                for (size_t i = begin; i < end; ++i) {
+                    _evaluate(_batch[i].cleaned_seq, _workers[t], _values[i]);
+                }
+            });
+
+        if (_records) {
+            _write_records();
+        } else {
+            _write_tsv();
+        }
+        _batch.clear();
+        _batch_read_n.clear();
+    }
+
+    void _write_tsv() {
+        for (size_t i = 0; i < _batch.size(); ++i) {
+            for (size_t pos = 0; pos < _values[i].size(); ++pos) {
+                _output_stream << _batch_read_n[i] << "\t"
+                               << _batch[i].name << "\t";
+                if (_scope == PER_KMER) {
+                    _output_stream << pos << "\t";
+                }
+                _output_stream << _values[i][pos] << "\n";
+            }
+        }
+    }
+
+    void _write_records() {
+        for (size_t i = 0; i < _batch.size(); ++i) {
+            for (size_t pos = 0; pos < _values[i].size(); ++pos) {
+                _records->put(_batch_read_n[i]);
+                if (_scope == PER_KMER) {
+                    _records->put(static_cast<uint64_t>(pos));
+                }
+                _records->put(_values[i][pos]);
+                _records->end_record();
+            }
+        }
+    }
+
+public:
+
+    using Base::process_sequence;
+
+    SequenceFunctionProcessor(shared_ptr<GraphType> graph,
+                              sequence_function_t function,
+                              const std::string& output_filename,
+                              function_output_t output_format=OUTPUT_TSV,
+                              function_scope_t scope=PER_SEQUENCE,
+                              unsigned int n_threads=1,
+                              size_t batch_size=DEFAULT_FUNCTION_BATCH_SIZE,
+                              uint64_t fine_interval=DEFAULT_FINE_INTERVAL,
+                              uint64_t medium_interval=DEFAULT_MEDIUM_INTERVAL,
+                              uint64_t coarse_interval=DEFAULT_COARSE_INTERVAL)
+        : Base(fine_interval, medium_interval, coarse_interval),
+          graph(graph),
+          _function(function),
+          _scope(scope),
+          _output_format(output_format),
+          _output_filename(output_filename),
+          _output_stream(_output_filename.c_str(),
+                         output_format == OUTPUT_BINARY ?
+                            std::ios::out | std::ios::binary : std::ios::out),
+          _batch_size(batch_size > 0 ? batch_size : 1),
+          _workers(n_threads > 0 ? n_threads : 1) {
+
+        if (_function == MEDIAN_COUNT && _scope == PER_KMER) {
+            throw BoinkException("MedianCount is only defined per sequence.");
+        }
+
+        for (auto& worker : _workers) {
+            worker.assembler = graph->get_assembler();
+            if (_function == DEGREE_BIAS) {
+                worker.heptamers.resize(N_HEPTAMERS, degree_counts_t{});
+            }
+        }
+
+        if (_output_format == OUTPUT_BINARY) {
+            _records = make_unique<reporting::RecordWriter>(_output_stream);
+            _records->add_column("read_n", reporting::records::COLUMN_UINT64);
+            if (_scope == PER_KMER) {
+                _records->add_column("position", reporting::records::COLUMN_UINT64);
+            }
+            _records->add_column(sequence_function_repr(_function),
+                                 reporting::records::COLUMN_FLOAT64);
+            _records->write_header();
+        } else {
+            // enough digits that large coverages don't print as 1.23457e+06
+            _output_stream << std::setprecision(std::numeric_limits<double>::digits10);
+            _output_stream << "read_n\tname\t"
+                           << (_scope == PER_KMER ? "position\t" : "")
+                           << sequence_function_repr(_function) << std::endl;
+        }
+        _batch.reserve(_batch_size);
+    }
+
+    ~SequenceFunctionProcessor() {
+        _records.reset();
+        _output_stream.close();
+    }
+
+    void process_sequence(const parsing::Read& read) {
+        _batch.push_back(read);
+        _batch_read_n.push_back(this->_n_reads);
+        if (_batch.size() >= _batch_size) {
+            _flush_batch();
+        }
+    }
+
+    void flush() {
+        _flush_batch();
+        if (_records) {
+            _records->flush();
+        }
+        _output_stream.flush();
+    }
+
+    double estimated_fp() {
+        return graph->estimated_fp();
+    }
+
+    void report() {}
+
+    /* Write the heptamer-by-degree table accumulated by DEGREE_BIAS:
+     * one row per heptamer, one column per k-mer degree.
+     */
+    void save_degree_bias(const std::string& filename) const {
+        if (_function != DEGREE_BIAS) {
+            throw BoinkException("Degree bias is only collected by DEGREE_BIAS.");
+        }
+        std::ofstream out(filename.c_str());
+        const char bases[] = "ACGT";
+        for (size_t h = 0; h < N_HEPTAMERS; ++h) {
+            std::string heptamer(7, 'A');
+            for (int i = 6, index = h; i >= 0; --i, index >>= 2) {
+                heptamer[i] = bases[index & 3];
+            }
+            out << heptamer;
+            for (size_t d = 0; d < MAX_DBG_DEGREE; ++d) {
+                uint64_t count = 0;
+                for (auto& worker : _workers) {
+                    count += worker.heptamers[h][d];
+                }
+                out << ", " << count;
+            }
+            out << "\n";
+        }
+    }
+};
+
+
+/* Per-read k-mer abundance summary, as written by scripts/count-kmers:
+ * max, median, first and last k-mer counts, and the max over the
+ * internal k-mers (None for reads with two or fewer k-mers). Meant to
+ * run over reads after the graph has been built; batches are split
+ * across n_threads, and each worker reuses its count buffer so memory
+ * stays bounded by the batch and longest read.
+ */
+template <class GraphType,
+          class ParserType = parsing::FastxReader>
+class AbundanceSummaryProcessor : public FileProcessor<AbundanceSummaryProcessor<GraphType, ParserType>,
+                                                       ParserType> {
+
+public:
+
+    struct summary_t {
+        storage::count_t max;
+        double           median;
+        bool             even;
+        storage::count_t start;
+        storage::count_t end;
+        storage::count_t internal_max;
+        bool             has_internal;
+        // false for reads shorter than K; kept per summary rather than
+        // in a vector<bool>, whose packed bits workers can't write safely
+        bool             valid;
+    };
+
+protected:
+
+    typedef FileProcessor<AbundanceSummaryProcessor<GraphType, ParserType>,
+                          ParserType> Base;
+
+    shared_ptr<GraphType>       graph;
+    std::string                 _output_filename;
+    std::ofstream               _output_stream;
+    size_t                      _batch_size;
+    unsigned int                _n_threads;
+
+    std::vector<parsing::Read>  _batch;
+    std::vector<summary_t>      _summaries;
+
+    void _summarize_range(size_t begin, size_t end) {
+        std::vector<storage::count_t> counts;
+        for (size_t i = begin; i < end; ++i) {
+            _summaries[i].valid = summarize(_batch[i].cleaned_seq, counts, _summaries[i]);
+        }
+    }
+
+    void _flush_batch() {
+        if (_batch.size() == 0) {
+            return;
+        }
+        _summaries.resize(_batch.size());
+
+        parallel_batch(_batch.size(), _n_threads,
+            [this](size_t begin, size_t end, size_t) {
+                _summarize_range(begin, end);
+            });
+
+        for (size_t i = 0; i < _batch.size(); ++i) {
+            auto& summary = _summaries[i];
+            if (!summary.valid) {
+                continue;
+            }
+            _output_stream << '"' << _batch[i].name << "\"\t"
+                           << summary.max << "\t";
+            if (summary.even) {
+                _output_stream << std::fixed << std::setprecision(1)
+                               << summary.median << std::defaultfloat;
+            } else {
+                _output_stream << static_cast<uint64_t>(summary.median);
+            }
+            _output_stream << "\t" << summary.start
+                           << "\t" << summary.end << "\t";
+            if (summary.has_internal) {
+                _output_stream << summary.internal_max;
+            } else {
+                _output_stream << "None";
+            }
+            _output_stream << "\n";
+        }
+        _batch.clear();
+    }
+
+public:
+
+    using Base::process_sequence;
+
+    AbundanceSummaryProcessor(shared_ptr<GraphType> graph,
+                              const std::string& output_filename,
+                              unsigned int n_threads=1,
+                              size_t batch_size=DEFAULT_FUNCTION_BATCH_SIZE,
+                              uint64_t fine_interval=DEFAULT_FINE_INTERVAL,
+                              uint64_t medium_interval=DEFAULT_MEDIUM_INTERVAL,
+                              uint64_t coarse_interval=DEFAULT_COARSE_INTERVAL)
+        : Base(fine_interval, medium_interval, coarse_interval),
+          graph(graph),
+          _output_filename(output_filename),
+          _output_stream(_output_filename.c_str()),
+          _batch_size(batch_size > 0 ? batch_size : 1),
+          _n_threads(n_threads > 0 ? n_threads : 1) {
+
+        _output_stream << "name\tmax\tmedian\tstart\tend\tinternal_max" << std::endl;
+        _batch.reserve(_batch_size);
+    }
+
+    ~AbundanceSummaryProcessor() {
+        _output_stream.close();
+    }
+
+    /* Summarize one sequence, using counts as scratch space. Returns
+     * false if the sequence is shorter than K.
+     */
+    bool summarize(const std::string& sequence,
+                   std::vector<storage::count_t>& counts,
+                   summary_t& summary) {
+        if (sequence.length() < graph->K()) {
+            return false;
+        }
+        counts.clear();
+        hashing::KmerIterator<typename GraphType::shifter_type> iter(sequence, graph->K());
+        while (!iter.done()) {
+            counts.push_back(graph->query(iter.next()));
+        }
+
+        summary.start = counts.front();
+        summary.end = counts.back();
+        summary.has_internal = counts.size() > 2;
+        summary.internal_max = 0;
+        if (summary.has_internal) {
+            summary.internal_max = *std::max_element(counts.begin() + 1,
+                                                     counts.end() - 1);
+        }
+        summary.max = std::max({summary.internal_max, summary.start, summary.end});
+        summary.even = counts.size() % 2 == 0;
+        summary.median = median_count(counts);
+        return true;
+    }
+
+    void process_sequence(const parsing::Read& read) {
+        _batch.push_back(read);
+        if (_batch.size() >= _batch_size) {
+            _flush_batch();
+        }
+    }
+
+    void flush() {
+        _flush_batch();
+        _output_stream.flush();
+    }
+
+    double estimated_fp() {
+        return graph->estimated_fp();
+    }
+
+    void report() {}
+};
+
+
 } //namespace boink
 #endif
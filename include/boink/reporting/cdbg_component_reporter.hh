@@ -24,6 +24,7 @@
 #include "boink/event_types.hh"
 #include "boink/metrics.hh"
 #include "boink/reporting/reporters.hh"
+#include "boink/reporting/record_writer.hh"
 #include "boink/reporting/report_types.hh"
 
 #include "sparsepp/spp.h"
@@ -88,14 +89,17 @@ private:
     metrics::ReservoirSample<size_t>              component_size_sample;
 
     std::unique_ptr<cDBGComponentReporterMetrics> metrics;
+    std::unique_ptr<RecordWriter>                 _records;
 
 public:
 
     cDBGComponentReporter(std::shared_ptr<cdbg::cDBG<GraphType>> cdbg,
                           const std::string&                     filename,
                           std::shared_ptr<prometheus::Registry>  registry,
-                          size_t                                 sample_size = 10000)
-        : SingleFileReporter       (filename, "cDBGComponentReporter"),
+                          size_t                                 sample_size = 10000,
+                          ReportFormat                           format = CSV_REPORT)
+        : SingleFileReporter       (filename, "cDBGComponentReporter",
+                                    records::openmode(format)),
           cdbg                     (cdbg),
           min_component            (ULLONG_MAX),
           max_component            (0),
@@ -104,7 +108,20 @@ public:
     {
         _cerr(this->THREAD_NAME << " reporting at MEDIUM interval.");
         this->msg_type_whitelist.insert(events::MSG_TIME_INTERVAL);
-        _output_stream << "read_n,n_components,max_component,min_component,sample_size,component_size_sample" << std::endl;
+
+        if (format == BINARY_REPORT) {
+            _records = make_unique<RecordWriter>(_output_stream);
+            for (auto name : {"read_n", "n_components", "max_component",
+                              "min_component", "sample_size"}) {
+                _records->add_column(name, records::COLUMN_UINT64);
+            }
+            // the reservoir is zero-filled, so the sample is always sample_size wide
+            _records->add_column("component_size_sample", records::COLUMN_UINT64,
+                                 sample_size);
+            _records->write_header();
+        } else {
+            _output_stream << "read_n,n_components,max_component,min_component,sample_size,component_size_sample" << std::endl;
+        }
 
         metrics = make_unique<cDBGComponentReporterMetrics>(registry);
     }
@@ -116,6 +133,17 @@ public:
                 _event->level == events::TimeIntervalEvent::END) {
                 
                 this->recompute_components();
+                if (_records) {
+                    _records->put(_event->t);
+                    _records->put(component_size_sample.get_n_sampled());
+                    _records->put(max_component);
+                    _records->put(min_component);
+                    _records->put(component_size_sample.get_sample_size());
+                    _records->put_all(component_size_sample.get_result());
+                    _records->end_record();
+                    _records->flush();
+                    return;
+                }
                 _output_stream << _event->t << ","
                                << component_size_sample.get_n_sampled() << ","
                                << max_component << ","
@@ -131,15 +159,14 @@ public:
         auto time_start = std::chrono::system_clock::now();
 
         component_size_sample.clear();
-        auto components = cdbg->find_connected_components();
-        for (auto id_comp_pair : components) {
-            size_t component_size = id_comp_pair.second.size();
+        auto component_sizes = cdbg->component_sizes();
+        for (auto component_size : component_sizes) {
             component_size_sample.sample(component_size);
             max_component = (component_size > max_component) ? component_size : max_component;
             min_component = (component_size < min_component) ? component_size : min_component;
         }
 
-        metrics->n_components.Set(components.size());
+        metrics->n_components.Set(component_sizes.size());
         metrics->max_component_size.Set(max_component);
         metrics->min_component_size.Set(min_component);
 
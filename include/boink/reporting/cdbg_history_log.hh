@@ -0,0 +1,658 @@
+/* cdbg_history_log.hh -- binary cDBG history log
+ *
+ * Copyright (C) 2018 Camille Scott
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+
+#ifndef BOINK_CDBG_HISTORY_LOG_HH
+#define BOINK_CDBG_HISTORY_LOG_HH
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <zlib.h>
+
+#include "boink/boink.hh"
+#include "boink/event_types.hh"
+#include "boink/cdbg/cdbg_types.hh"
+#include "boink/reporting/reporters.hh"
+#include "boink/reporting/cdbg_history_reporter.hh"
+
+
+namespace boink {
+namespace reporting {
+
+using boink::cdbg::id_t;
+using boink::cdbg::node_meta_t;
+
+
+/* Layout of the history log. The file is an 8 byte header followed by
+ * tagged blocks:
+ *
+ *   DATA:  n_records, raw_size, compressed_size (varints), then the
+ *          zlib-compressed records.
+ *   INDEX: n_entries, offset of the previous INDEX or 0, then an
+ *          (offset, first record) pair per DATA block since the last one.
+ *   END:   offset of the last INDEX and the record count, as fixed
+ *          width little-endian uint64s, then the magic again.
+ *
+ * A record is an op code, varint node IDs, node meta as a byte, and
+ * sequences as a varint length plus 2-bit packed bases. The END trailer
+ * is only written on a clean exit; readers treat a missing trailer or a
+ * truncated final block as the end of the log.
+ */
+namespace history_log {
+
+    static const char     MAGIC[6]       = {'B', 'K', 'H', 'L', 'O', 'G'};
+    static const uint8_t  VERSION        = 1;
+    static const size_t   HEADER_SIZE    = 8;
+    static const size_t   TRAILER_SIZE   = 1 + 8 + 8 + 6;
+    static const size_t   BLOCK_SIZE     = 1 << 16;
+    static const size_t   INDEX_INTERVAL = 64;
+
+    enum block_t : uint8_t {
+        BLOCK_DATA  = 'D',
+        BLOCK_INDEX = 'I',
+        BLOCK_END   = 'E'
+    };
+
+    enum op_t : uint8_t {
+        OP_NEW,
+        OP_SPLIT,
+        OP_MERGE,
+        OP_EXTEND,
+        OP_CLIP,
+        OP_SPLIT_CIRCULAR,
+        OP_DELETE
+    };
+
+    inline void put_varint(std::string& out, uint64_t value) {
+        while (value >= 0x80) {
+            out.push_back(static_cast<char>((value & 0x7F) | 0x80));
+            value >>= 7;
+        }
+        out.push_back(static_cast<char>(value));
+    }
+
+    inline uint64_t get_varint(const char *& pos, const char * end) {
+        uint64_t value = 0;
+        for (unsigned shift = 0; shift < 64; shift += 7) {
+            if (pos == end) {
+                throw InvalidStream("History log record ends inside a varint");
+            }
+            uint8_t byte = static_cast<uint8_t>(*pos++);
+            value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) {
+                return value;
+            }
+        }
+        throw InvalidStream("History log varint is too long");
+    }
+
+    inline void put_uint64(std::string& out, uint64_t value) {
+        for (int i = 0; i < 8; ++i) {
+            out.push_back(static_cast<char>(value >> (8 * i)));
+        }
+    }
+
+    inline uint64_t get_uint64(const char * pos) {
+        uint64_t value = 0;
+        for (int i = 0; i < 8; ++i) {
+            value |= static_cast<uint64_t>(static_cast<uint8_t>(pos[i])) << (8 * i);
+        }
+        return value;
+    }
+
+    inline void put_sequence(std::string& out, const events::SequenceView& sequence) {
+        put_varint(out, sequence.size());
+        const char * bases = sequence.data();
+        uint8_t byte = 0;
+        for (size_t i = 0; i < sequence.size(); ++i) {
+            uint8_t code;
+            switch(bases[i]) {
+                case 'A': case 'a': code = 0; break;
+                case 'C': case 'c': code = 1; break;
+                case 'G': case 'g': code = 2; break;
+                case 'T': case 't': code = 3; break;
+                default:
+                    throw BoinkException("History log can only store ACGT sequences");
+            }
+            byte |= code << ((i & 3) << 1);
+            if ((i & 3) == 3) {
+                out.push_back(static_cast<char>(byte));
+                byte = 0;
+            }
+        }
+        if (sequence.size() & 3) {
+            out.push_back(static_cast<char>(byte));
+        }
+    }
+
+    inline void get_sequence(const char *& pos, const char * end, std::string& out) {
+        uint64_t length = get_varint(pos, end);
+        uint64_t n_bytes = (length + 3) >> 2;
+        if (static_cast<uint64_t>(end - pos) < n_bytes) {
+            throw InvalidStream("History log sequence runs past its block");
+        }
+        out.resize(length);
+        for (uint64_t i = 0; i < length; ++i) {
+            out[i] = "ACGT"[(static_cast<uint8_t>(pos[i >> 2]) >> ((i & 3) << 1)) & 3];
+        }
+        pos += n_bytes;
+    }
+}
+
+
+/* Streams the history events to a history log. Records are batched into
+ * blocks of about BLOCK_SIZE bytes, compressed and flushed one block at
+ * a time, so the listener keeps up with the compactor on runs where
+ * GraphML would not.
+ */
+class cDBGHistoryLogReporter : public SingleFileReporter {
+private:
+
+    std::string _block;
+    uint64_t    _block_records;
+    uint64_t    _n_records;
+    uint64_t    _offset;
+    uint64_t    _last_index;
+    std::string _compressed;
+
+    std::vector<std::pair<uint64_t, uint64_t>> _index;
+
+    void _write(const std::string& bytes) {
+        _output_stream.write(bytes.data(), bytes.size());
+        _offset += bytes.size();
+    }
+
+    void _flush_block() {
+        if (_block_records == 0) {
+            return;
+        }
+        uLongf compressed_size = compressBound(_block.size());
+        _compressed.resize(compressed_size);
+        int status = compress2(reinterpret_cast<Bytef*>(&_compressed[0]),
+                               &compressed_size,
+                               reinterpret_cast<const Bytef*>(_block.data()),
+                               _block.size(),
+                               Z_BEST_SPEED);
+        if (status != Z_OK) {
+            throw BoinkFileException("Failed to compress history log block");
+        }
+
+        std::string head;
+        head.push_back(static_cast<char>(history_log::BLOCK_DATA));
+        history_log::put_varint(head, _block_records);
+        history_log::put_varint(head, _block.size());
+        history_log::put_varint(head, compressed_size);
+
+        _index.emplace_back(_offset, _n_records - _block_records);
+        _write(head);
+        _output_stream.write(_compressed.data(), compressed_size);
+        _offset += compressed_size;
+
+        _block.clear();
+        _block_records = 0;
+        if (_index.size() >= history_log::INDEX_INTERVAL) {
+            _flush_index();
+        }
+        _output_stream.flush();
+    }
+
+    void _flush_index() {
+        if (_index.empty()) {
+            return;
+        }
+        std::string block;
+        block.push_back(static_cast<char>(history_log::BLOCK_INDEX));
+        history_log::put_varint(block, _index.size());
+        history_log::put_varint(block, _last_index);
+        for (auto& entry : _index) {
+            history_log::put_varint(block, entry.first);
+            history_log::put_varint(block, entry.second);
+        }
+        _last_index = _offset;
+        _write(block);
+        _index.clear();
+    }
+
+    void _begin_record(history_log::op_t op) {
+        _block.push_back(static_cast<char>(op));
+    }
+
+    void _end_record() {
+        ++_block_records;
+        ++_n_records;
+        if (_block.size() >= history_log::BLOCK_SIZE) {
+            _flush_block();
+        }
+    }
+
+    void _put_node(id_t id, node_meta_t meta) {
+        history_log::put_varint(_block, id);
+        _block.push_back(static_cast<char>(meta));
+    }
+
+public:
+
+    cDBGHistoryLogReporter(const std::string& filename)
+        : SingleFileReporter(filename, "cDBGHistoryLogReporter",
+                             std::ios_base::out | std::ios_base::binary),
+          _block_records(0),
+          _n_records(0),
+          _offset(0),
+          _last_index(0)
+    {
+        _cerr(this->THREAD_NAME << " reporting continuously.");
+
+        this->msg_type_whitelist.insert(events::MSG_HISTORY_NEW);
+        this->msg_type_whitelist.insert(events::MSG_HISTORY_SPLIT);
+        this->msg_type_whitelist.insert(events::MSG_HISTORY_SPLIT_CIRCULAR);
+        this->msg_type_whitelist.insert(events::MSG_HISTORY_MERGE);
+        this->msg_type_whitelist.insert(events::MSG_HISTORY_EXTEND);
+        this->msg_type_whitelist.insert(events::MSG_HISTORY_CLIP);
+        this->msg_type_whitelist.insert(events::MSG_HISTORY_DELETE);
+
+        std::string header(history_log::MAGIC, sizeof(history_log::MAGIC));
+        header.push_back(static_cast<char>(history_log::VERSION));
+        header.push_back(0);
+        _write(header);
+        _block.reserve(history_log::BLOCK_SIZE + 1024);
+    }
+
+    uint64_t n_records() const {
+        return _n_records;
+    }
+
+    virtual void handle_exit() {
+        _flush_block();
+        _flush_index();
+
+        std::string trailer;
+        trailer.push_back(static_cast<char>(history_log::BLOCK_END));
+        history_log::put_uint64(trailer, _last_index);
+        history_log::put_uint64(trailer, _n_records);
+        trailer.append(history_log::MAGIC, sizeof(history_log::MAGIC));
+        _write(trailer);
+        _output_stream.flush();
+    }
+
+    virtual void handle_msg(shared_ptr<events::Event> event) {
+        if (event->msg_type == events::MSG_HISTORY_NEW) {
+            auto _event = static_cast<events::HistoryNewEvent*>(event.get());
+            _begin_record(history_log::OP_NEW);
+            _put_node(_event->id, _event->meta);
+            history_log::put_sequence(_block, _event->sequence);
+
+        } else if (event->msg_type == events::MSG_HISTORY_SPLIT) {
+            auto _event = static_cast<events::HistorySplitEvent*>(event.get());
+            _begin_record(history_log::OP_SPLIT);
+            history_log::put_varint(_block, _event->parent);
+            _put_node(_event->lchild, _event->lmeta);
+            _put_node(_event->rchild, _event->rmeta);
+            history_log::put_sequence(_block, _event->lsequence);
+            history_log::put_sequence(_block, _event->rsequence);
+
+        } else if (event->msg_type == events::MSG_HISTORY_MERGE) {
+            auto _event = static_cast<events::HistoryMergeEvent*>(event.get());
+            _begin_record(history_log::OP_MERGE);
+            history_log::put_varint(_block, _event->lparent);
+            history_log::put_varint(_block, _event->rparent);
+            _put_node(_event->child, _event->meta);
+            history_log::put_sequence(_block, _event->sequence);
+
+        } else if (event->msg_type == events::MSG_HISTORY_EXTEND) {
+            auto _event = static_cast<events::HistoryExtendEvent*>(event.get());
+            _begin_record(history_log::OP_EXTEND);
+            _put_node(_event->id, _event->meta);
+            history_log::put_sequence(_block, _event->sequence);
+
+        } else if (event->msg_type == events::MSG_HISTORY_CLIP) {
+            auto _event = static_cast<events::HistoryClipEvent*>(event.get());
+            _begin_record(history_log::OP_CLIP);
+            _put_node(_event->id, _event->meta);
+            history_log::put_sequence(_block, _event->sequence);
+
+        } else if (event->msg_type == events::MSG_HISTORY_SPLIT_CIRCULAR) {
+            auto _event = static_cast<events::HistorySplitCircularEvent*>(event.get());
+            _begin_record(history_log::OP_SPLIT_CIRCULAR);
+            _put_node(_event->id, _event->meta);
+            history_log::put_sequence(_block, _event->sequence);
+
+        } else if (event->msg_type == events::MSG_HISTORY_DELETE) {
+            auto _event = static_cast<events::HistoryDeleteEvent*>(event.get());
+            _begin_record(history_log::OP_DELETE);
+            _put_node(_event->id, _event->meta);
+
+        } else {
+            return;
+        }
+        _end_record();
+    }
+};
+
+
+/* Reads a history log back as the history events that produced it.
+ */
+class cDBGHistoryLogReader {
+private:
+
+    std::ifstream           _input_stream;
+    std::string             _filename;
+    std::string             _compressed;
+    std::string             _raw;
+    std::string             _sequence;
+    const char *            _pos;
+    const char *            _end;
+    uint64_t                _block_records;
+    uint64_t                _n_records;
+    bool                    _done;
+    bool                    _truncated;
+    events::SequenceBuffer  _sequences;
+
+    bool _read(char * out, size_t n) {
+        _input_stream.read(out, n);
+        return static_cast<size_t>(_input_stream.gcount()) == n;
+    }
+
+    bool _read_varint(uint64_t& value) {
+        value = 0;
+        for (unsigned shift = 0; shift < 64; shift += 7) {
+            char c;
+            if (!_read(&c, 1)) {
+                return false;
+            }
+            uint8_t byte = static_cast<uint8_t>(c);
+            value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) {
+                return true;
+            }
+        }
+        throw InvalidStream("History log varint is too long");
+    }
+
+    void _stop(bool truncated) {
+        _done = true;
+        _truncated = truncated;
+    }
+
+    /* Load the next DATA block, skipping INDEX blocks; false at the END
+     * trailer, at EOF, or at a block cut short by a crash.
+     */
+    bool _next_block() {
+        while (!_done) {
+            char tag;
+            if (!_read(&tag, 1)) {
+                _stop(true);
+                break;
+            }
+            if (tag == history_log::BLOCK_END) {
+                _stop(false);
+                break;
+            }
+
+            uint64_t count, prev;
+            if (tag == history_log::BLOCK_INDEX) {
+                if (!_read_varint(count) || !_read_varint(prev)) {
+                    _stop(true);
+                    break;
+                }
+                for (uint64_t i = 0; i < 2 * count; ++i) {
+                    if (!_read_varint(prev)) {
+                        _stop(true);
+                        return false;
+                    }
+                }
+                continue;
+            }
+            if (tag != history_log::BLOCK_DATA) {
+                throw InvalidStream("Bad block tag in history log " + _filename);
+            }
+
+            uint64_t raw_size, compressed_size;
+            if (!_read_varint(count) ||
+                !_read_varint(raw_size) ||
+                !_read_varint(compressed_size)) {
+                _stop(true);
+                break;
+            }
+            _compressed.resize(compressed_size);
+            if (!_read(&_compressed[0], compressed_size)) {
+                _stop(true);
+                break;
+            }
+            _raw.resize(raw_size);
+            uLongf size = raw_size;
+            int status = uncompress(reinterpret_cast<Bytef*>(&_raw[0]),
+                                    &size,
+                                    reinterpret_cast<const Bytef*>(_compressed.data()),
+                                    compressed_size);
+            if (status != Z_OK || size != raw_size) {
+                throw InvalidStream("Corrupt block in history log " + _filename);
+            }
+            _pos = _raw.data();
+            _end = _pos + raw_size;
+            _block_records = count;
+            return true;
+        }
+        return false;
+    }
+
+    events::SequenceView _get_sequence() {
+        history_log::get_sequence(_pos, _end, _sequence);
+        return _sequences.add(_sequence);
+    }
+
+    id_t _get_id() {
+        return history_log::get_varint(_pos, _end);
+    }
+
+    node_meta_t _get_meta() {
+        if (_pos == _end) {
+            throw InvalidStream("History log record ends inside node meta");
+        }
+        return static_cast<node_meta_t>(static_cast<uint8_t>(*_pos++));
+    }
+
+public:
+
+    cDBGHistoryLogReader(const std::string& filename)
+        : _input_stream(filename.c_str(), std::ios_base::in | std::ios_base::binary),
+          _filename(filename),
+          _pos(nullptr),
+          _end(nullptr),
+          _block_records(0),
+          _n_records(0),
+          _done(false),
+          _truncated(false)
+    {
+        if (!_input_stream) {
+            throw BoinkFileException("Could not open history log " + filename);
+        }
+        char header[history_log::HEADER_SIZE];
+        if (!_read(header, history_log::HEADER_SIZE) ||
+            std::memcmp(header, history_log::MAGIC, sizeof(history_log::MAGIC)) != 0) {
+            throw InvalidStream(filename + " is not a boink history log");
+        }
+        if (static_cast<uint8_t>(header[6]) != history_log::VERSION) {
+            throw InvalidStream("Unsupported history log version in " + filename);
+        }
+    }
+
+    uint64_t n_records() const {
+        return _n_records;
+    }
+
+    /* Whether reading stopped short of the END trailer, as it does for
+     * the log of a run that did not exit cleanly.
+     */
+    bool truncated() const {
+        return _truncated;
+    }
+
+    /* The (offset, first record) of each DATA block, read by following
+     * the INDEX chain back from the trailer; empty if there is no
+     * trailer.
+     */
+    std::vector<std::pair<uint64_t, uint64_t>> index() {
+        std::vector<std::pair<uint64_t, uint64_t>> entries;
+        std::ifstream in(_filename.c_str(), std::ios_base::in | std::ios_base::binary);
+        in.seekg(0, std::ios_base::end);
+        std::streamoff size = in.tellg();
+        if (size < static_cast<std::streamoff>(history_log::HEADER_SIZE +
+                                              history_log::TRAILER_SIZE)) {
+            return entries;
+        }
+
+        char trailer[history_log::TRAILER_SIZE];
+        in.seekg(size - history_log::TRAILER_SIZE);
+        in.read(trailer, history_log::TRAILER_SIZE);
+        if (trailer[0] != history_log::BLOCK_END ||
+            std::memcmp(trailer + 17, history_log::MAGIC, sizeof(history_log::MAGIC)) != 0) {
+            return entries;
+        }
+
+        std::vector<std::vector<std::pair<uint64_t, uint64_t>>> chain;
+        uint64_t offset = history_log::get_uint64(trailer + 1);
+        while (offset != 0) {
+            // tag, two varints, and up to INDEX_INTERVAL pairs of varints
+            uint64_t length = std::min<uint64_t>(size - offset,
+                                                 1 + 20 + 20 * history_log::INDEX_INTERVAL);
+            std::vector<char> bytes(length);
+            in.seekg(offset);
+            in.read(bytes.data(), length);
+            const char * pos = bytes.data();
+            const char * end = pos + length;
+            if (*pos++ != history_log::BLOCK_INDEX) {
+                throw InvalidStream("Bad index offset in history log " + _filename);
+            }
+            uint64_t count = history_log::get_varint(pos, end);
+            uint64_t prev = history_log::get_varint(pos, end);
+            chain.emplace_back();
+            for (uint64_t i = 0; i < count; ++i) {
+                uint64_t block_offset = history_log::get_varint(pos, end);
+                uint64_t first_record = history_log::get_varint(pos, end);
+                chain.back().emplace_back(block_offset, first_record);
+            }
+            offset = prev;
+        }
+        for (auto it = chain.rbegin(); it != chain.rend(); ++it) {
+            entries.insert(entries.end(), it->begin(), it->end());
+        }
+        return entries;
+    }
+
+    /* The next event, or nullptr at the end of the log.
+     */
+    shared_ptr<events::Event> next() {
+        while (_block_records == 0) {
+            if (!_next_block()) {
+                return nullptr;
+            }
+        }
+        --_block_records;
+        ++_n_records;
+
+        if (_pos == _end) {
+            throw InvalidStream("History log block holds fewer records than it claims");
+        }
+        auto op = static_cast<history_log::op_t>(static_cast<uint8_t>(*_pos++));
+        switch(op) {
+            case history_log::OP_NEW: {
+                auto event = events::make_event<events::HistoryNewEvent>();
+                event->id = _get_id();
+                event->meta = _get_meta();
+                event->sequence = _get_sequence();
+                return event;
+            }
+            case history_log::OP_SPLIT: {
+                auto event = events::make_event<events::HistorySplitEvent>();
+                event->parent = _get_id();
+                event->lchild = _get_id();
+                event->lmeta = _get_meta();
+                event->rchild = _get_id();
+                event->rmeta = _get_meta();
+                event->lsequence = _get_sequence();
+                event->rsequence = _get_sequence();
+                return event;
+            }
+            case history_log::OP_MERGE: {
+                auto event = events::make_event<events::HistoryMergeEvent>();
+                event->lparent = _get_id();
+                event->rparent = _get_id();
+                event->child = _get_id();
+                event->meta = _get_meta();
+                event->sequence = _get_sequence();
+                return event;
+            }
+            case history_log::OP_EXTEND: {
+                auto event = events::make_event<events::HistoryExtendEvent>();
+                event->id = _get_id();
+                event->meta = _get_meta();
+                event->sequence = _get_sequence();
+                return event;
+            }
+            case history_log::OP_CLIP: {
+                auto event = events::make_event<events::HistoryClipEvent>();
+                event->id = _get_id();
+                event->meta = _get_meta();
+                event->sequence = _get_sequence();
+                return event;
+            }
+            case history_log::OP_SPLIT_CIRCULAR: {
+                auto event = events::make_event<events::HistorySplitCircularEvent>();
+                event->id = _get_id();
+                event->meta = _get_meta();
+                event->sequence = _get_sequence();
+                return event;
+            }
+            case history_log::OP_DELETE: {
+                auto event = events::make_event<events::HistoryDeleteEvent>();
+                event->id = _get_id();
+                event->meta = _get_meta();
+                return event;
+            }
+            default:
+                throw InvalidStream("Unknown op code in history log " + _filename);
+        }
+    }
+};
+
+
+/* Replay a history log into the GraphML cDBGHistoryReporter would have
+ * written for the same run. Returns the number of records converted.
+ */
+inline uint64_t history_log_to_graphml(const std::string& log_filename,
+                                       const std::string& graphml_filename) {
+    cDBGHistoryLogReader reader(log_filename);
+    std::ofstream output_stream(graphml_filename.c_str());
+    cDBGHistoryGraphML graphml(output_stream);
+
+    graphml.write_header();
+    while (auto event = reader.next()) {
+        graphml.handle_msg(event);
+    }
+    graphml.write_footer();
+
+    if (reader.truncated()) {
+        std::cerr << "WARNING: " << log_filename << " has no END trailer; converted "
+                  << reader.n_records() << " complete records." << std::endl;
+    }
+    return reader.n_records();
+}
+
+
+}
+}
+
+#endif
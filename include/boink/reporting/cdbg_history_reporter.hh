@@ -29,27 +29,26 @@ namespace reporting {
 
 using boink::cdbg::id_t;
 
-class cDBGHistoryReporter : public SingleFileReporter {
+/* Writes the cDBG history DAG as GraphML: one node per version of each
+ * cDBG node, one edge per operation between versions. Shared by the
+ * streaming reporter and the history log converter.
+ */
+class cDBGHistoryGraphML {
 private:
 
+    std::ostream& _output_stream;
     id_t _edge_id_counter;
     spp::sparse_hash_map<id_t, std::vector<std::string>> node_history;
 
 public:
-    cDBGHistoryReporter(const std::string& filename)
-        : SingleFileReporter(filename, "cDBGHistoryReporter"),
+
+    cDBGHistoryGraphML(std::ostream& output_stream)
+        : _output_stream(output_stream),
           _edge_id_counter(0)
     {
-        _cerr(this->THREAD_NAME << " reporting continuously.");
-
-        this->msg_type_whitelist.insert(events::MSG_HISTORY_NEW);
-        this->msg_type_whitelist.insert(events::MSG_HISTORY_SPLIT);
-        this->msg_type_whitelist.insert(events::MSG_HISTORY_SPLIT_CIRCULAR);
-        this->msg_type_whitelist.insert(events::MSG_HISTORY_MERGE);
-        this->msg_type_whitelist.insert(events::MSG_HISTORY_EXTEND);
-        this->msg_type_whitelist.insert(events::MSG_HISTORY_CLIP);
-        this->msg_type_whitelist.insert(events::MSG_HISTORY_DELETE);
+    }
 
+    void write_header() {
         _output_stream << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>"
                           "<graphml xmlns=\"http://graphml.graphdrawing.org/xmlns\" "
                           "xmlns:xsi=\"http://www.w3.org/2001/XMLSchema-instance\" "
@@ -64,12 +63,13 @@ public:
                        << std::endl; // open <graph>
     }
 
-    virtual void handle_exit() {
+    void write_footer() {
         _output_stream << "</graph>" << std::endl;
         _output_stream << "</graphml>" << std::endl;
     }
 
-    void write_node(std::string id, id_t boink_id, std::string node_meta, std::string sequence) {
+    void write_node(const std::string& id, id_t boink_id, const char * node_meta,
+                    const events::SequenceView& sequence) {
         _output_stream << "<node id=\"" << id << "\">" << std::endl
                        << "    <data key=\"seq\">" << sequence << "</data>" << std::endl
                        << "    <data key=\"meta\">" << node_meta << "</data>" << std::endl
@@ -85,24 +85,26 @@ public:
                        << "</edge>" << std::endl;
     }
 
-    std::string add_node_edit(id_t node_id, cdbg::node_meta_t meta, std::string sequence) {
+    std::string add_node_edit(id_t node_id, cdbg::node_meta_t meta,
+                              const events::SequenceView& sequence) {
         auto change_num = node_history[node_id].size();
         std::string id = std::to_string(node_id) + "_" + std::to_string(change_num);
         node_history[node_id].push_back(id);
-        write_node(id, node_id, std::string(node_meta_repr(meta)), sequence);
+        write_node(id, node_id, node_meta_repr(meta), sequence);
         return id;
     }
 
-    std::string add_new_node(id_t node_id, cdbg::node_meta_t meta, std::string sequence) {
+    std::string add_new_node(id_t node_id, cdbg::node_meta_t meta,
+                             const events::SequenceView& sequence) {
         std::string id = std::to_string(node_id) + "_0";
         if (node_history.count(node_id) == 0) {
             node_history[node_id] = std::vector<std::string>{id};
-            write_node(id, node_id, std::string(node_meta_repr(meta)), sequence);
+            write_node(id, node_id, node_meta_repr(meta), sequence);
         }
         return id;
     }
 
-    virtual void handle_msg(shared_ptr<events::Event> event) {
+    void handle_msg(shared_ptr<events::Event> event) {
         if (event->msg_type == events::MSG_HISTORY_NEW) {
             auto _event = static_cast<events::HistoryNewEvent*>(event.get());
             add_new_node(_event->id, _event->meta, _event->sequence);
@@ -152,12 +154,49 @@ public:
             std::string src = node_history[_event->id].back();
             std::string dst = add_node_edit(_event->id, _event->meta, _event->sequence);
             write_edge(src, dst, std::string("SPLIT_CIRCULAR"));
+
+        } else if (event->msg_type == events::MSG_HISTORY_DELETE) {
+            auto _event = static_cast<events::HistoryDeleteEvent*>(event.get());
+
+            std::string src = node_history[_event->id].back();
+            std::string dst = add_node_edit(_event->id, _event->meta, events::SequenceView());
+            write_edge(src, dst, std::string("DELETE"));
         }
     }
 };
 
 
+class cDBGHistoryReporter : public SingleFileReporter {
+private:
+
+    cDBGHistoryGraphML _graphml;
 
+public:
+    cDBGHistoryReporter(const std::string& filename)
+        : SingleFileReporter(filename, "cDBGHistoryReporter"),
+          _graphml(_output_stream)
+    {
+        _cerr(this->THREAD_NAME << " reporting continuously.");
+
+        this->msg_type_whitelist.insert(events::MSG_HISTORY_NEW);
+        this->msg_type_whitelist.insert(events::MSG_HISTORY_SPLIT);
+        this->msg_type_whitelist.insert(events::MSG_HISTORY_SPLIT_CIRCULAR);
+        this->msg_type_whitelist.insert(events::MSG_HISTORY_MERGE);
+        this->msg_type_whitelist.insert(events::MSG_HISTORY_EXTEND);
+        this->msg_type_whitelist.insert(events::MSG_HISTORY_CLIP);
+        this->msg_type_whitelist.insert(events::MSG_HISTORY_DELETE);
+
+        _graphml.write_header();
+    }
+
+    virtual void handle_exit() {
+        _graphml.write_footer();
+    }
+
+    virtual void handle_msg(shared_ptr<events::Event> event) {
+        _graphml.handle_msg(event);
+    }
+};
 
 }
 }
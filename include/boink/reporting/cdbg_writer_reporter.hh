@@ -34,16 +34,20 @@ protected:
 
     shared_ptr<cdbg::cDBG<GraphType>> cdbg;
     cdbg::cDBGFormat format;
+    // threads used to format each snapshot
+    unsigned int n_threads;
 
 public:
 
     cDBGWriter(shared_ptr<cdbg::cDBG<GraphType>> cdbg,
                cdbg::cDBGFormat format,
-               const string& output_prefix)
+               const string& output_prefix,
+               unsigned int n_threads=1)
         : MultiFileReporter(output_prefix,
                             "cDBGWriter[" + cdbg_format_repr(format) + "]"),
           cdbg(cdbg),
-          format(format)
+          format(format),
+          n_threads(n_threads)
     {
         _cerr(this->THREAD_NAME << " reporting at COARSE interval.");
 
@@ -62,7 +66,7 @@ public:
 
                 _cerr(this->THREAD_NAME << ", t=" << _event->t <<
                       ": write cDBG to " << filename);
-                cdbg->write(stream, format);
+                cdbg->write(stream, format, n_threads);
             }
         }
     }
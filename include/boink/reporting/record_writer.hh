@@ -0,0 +1,168 @@
+/* record_writer.hh -- buffered fixed-width binary report records
+ *
+ * Copyright (C) 2018 Camille Scott
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+
+#ifndef BOINK_RECORD_WRITER_HH
+#define BOINK_RECORD_WRITER_HH
+
+#include <cstdint>
+#include <cstring>
+#include <ios>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "boink/boink.hh"
+#include "boink/reporting/report_types.hh"
+
+
+namespace boink {
+namespace reporting {
+
+
+/* Layout of a record file: the magic and a version byte, the number of
+ * columns as a little-endian uint32, then for each column its type
+ * byte, its width (values per record) as a uint32 and its name as a
+ * uint16 length plus bytes. Records follow back to back, every value a
+ * little-endian 8 byte field, so the file loads directly as a numpy
+ * structured array (see boink/records.py). A partial final record
+ * means the writer was cut off and should be dropped.
+ */
+namespace records {
+
+    static const char    MAGIC[5]    = {'B', 'K', 'R', 'E', 'C'};
+    static const uint8_t VERSION     = 1;
+    static const size_t  BUFFER_SIZE = 1 << 16;
+
+    enum column_t : uint8_t {
+        COLUMN_UINT64  = 'u',
+        COLUMN_FLOAT64 = 'f'
+    };
+
+    inline void put_uint(std::string& out, uint64_t value, size_t n_bytes) {
+        for (size_t i = 0; i < n_bytes; ++i) {
+            out.push_back(static_cast<char>(value >> (8 * i)));
+        }
+    }
+
+    inline std::ios_base::openmode openmode(ReportFormat format) {
+        return format == BINARY_REPORT ? std::ios_base::out | std::ios_base::binary
+                                       : std::ios_base::out;
+    }
+}
+
+
+/* Builds records into a buffer and writes it out once it holds
+ * records::BUFFER_SIZE bytes, or on flush(). Declare every column,
+ * then write_header(), then put each record's values in column order
+ * and finish it with end_record().
+ */
+class RecordWriter {
+
+    std::ostream&                  _out;
+    std::vector<records::column_t> _types;
+    std::vector<uint32_t>          _widths;
+    std::vector<std::string>       _names;
+    std::string                    _buffer;
+
+    size_t                         _record_size;
+    size_t                         _record_start;
+    uint64_t                       _n_records;
+
+    void _put(uint64_t value) {
+        records::put_uint(_buffer, value, 8);
+    }
+
+public:
+
+    RecordWriter(std::ostream& out)
+        : _out(out),
+          _record_size(0),
+          _record_start(0),
+          _n_records(0)
+    {
+        _buffer.reserve(records::BUFFER_SIZE + 1024);
+    }
+
+    ~RecordWriter() {
+        flush();
+    }
+
+    void add_column(const std::string& name,
+                    records::column_t  type,
+                    uint32_t           width = 1) {
+        _names.push_back(name);
+        _types.push_back(type);
+        _widths.push_back(width);
+        _record_size += 8 * width;
+    }
+
+    void write_header() {
+        _buffer.append(records::MAGIC, sizeof(records::MAGIC));
+        _buffer.push_back(static_cast<char>(records::VERSION));
+        records::put_uint(_buffer, _names.size(), 4);
+        for (size_t i = 0; i < _names.size(); ++i) {
+            _buffer.push_back(static_cast<char>(_types[i]));
+            records::put_uint(_buffer, _widths[i], 4);
+            records::put_uint(_buffer, _names[i].size(), 2);
+            _buffer.append(_names[i]);
+        }
+        _record_start = _buffer.size();
+        flush();
+    }
+
+    void put(uint64_t value) {
+        _put(value);
+    }
+
+    void put(double value) {
+        uint64_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        _put(bits);
+    }
+
+    template <class Iterable>
+    void put_all(const Iterable& values) {
+        for (auto value : values) {
+            put(static_cast<uint64_t>(value));
+        }
+    }
+
+    void end_record() {
+        if (_buffer.size() - _record_start != _record_size) {
+            throw BoinkException("Record does not match the declared columns");
+        }
+        ++_n_records;
+        _record_start = _buffer.size();
+        if (_buffer.size() >= records::BUFFER_SIZE) {
+            flush();
+        }
+    }
+
+    // writes out the finished records; a record in progress stays
+    void flush() {
+        _out.write(_buffer.data(), _record_start);
+        _out.flush();
+        _buffer.erase(0, _record_start);
+        _record_start = 0;
+    }
+
+    size_t record_size() const {
+        return _record_size;
+    }
+
+    uint64_t n_records() const {
+        return _n_records;
+    }
+};
+
+
+}
+}
+
+#endif
@@ -15,6 +15,15 @@
 namespace boink {
 namespace reporting {
 
+/* Interval reporters write CSV rows, or fixed-width binary records
+ * through a RecordWriter.
+ */
+enum ReportFormat {
+    CSV_REPORT,
+    BINARY_REPORT
+};
+
+
 struct StreamingCompactorReport {
     uint64_t n_full;
     uint64_t n_tips;
@@ -34,6 +43,32 @@ struct StreamingCompactorReport {
     uint64_t n_tags;
     uint64_t n_unique;
     double   estimated_fp;
+
+    // seconds spent in each stage of update_sequence, summed over the
+    // timed updates; left zero, and not reported, unless built with
+    // BOINK_STAGE_TIMING
+    double   t_find_segments;
+    double   t_find_induced;
+    double   t_induce_dnodes;
+    double   t_update_unodes;
+    double   t_dbg_insert;
+    double   t_coverage;
+    double   t_notify;
+    double   t_updates;
+    uint64_t n_timed_updates;
+
+    StreamingCompactorReport()
+        : t_find_segments(0),
+          t_find_induced(0),
+          t_induce_dnodes(0),
+          t_update_unodes(0),
+          t_dbg_insert(0),
+          t_coverage(0),
+          t_notify(0),
+          t_updates(0),
+          n_timed_updates(0)
+    {
+    }
 };
 
 
@@ -40,10 +40,11 @@ protected:
 public:
 
     SingleFileReporter(const std::string& output_filename,
-                       const std::string& thread_name) 
+                       const std::string& thread_name,
+                       std::ios_base::openmode mode = std::ios_base::out)
         : EventListener(thread_name),
           _output_filename(output_filename),
-          _output_stream(_output_filename.c_str())
+          _output_stream(_output_filename.c_str(), mode)
     {
     }
 
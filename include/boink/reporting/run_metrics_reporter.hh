@@ -0,0 +1,159 @@
+/* run_metrics_reporter.hh -- live run metrics for a prometheus registry
+ *
+ * Copyright (C) 2018 Camille Scott
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+
+#ifndef BOINK_RUN_METRICS_REPORTER_HH
+#define BOINK_RUN_METRICS_REPORTER_HH
+
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <prometheus/registry.h>
+
+#include "boink/boink.hh"
+#include "boink/events.hh"
+#include "boink/event_types.hh"
+#include "boink/storage/metrics.hh"
+
+
+namespace boink {
+namespace reporting {
+
+
+class RunMetrics {
+
+private:
+
+    std::shared_ptr<prometheus::Registry>    pr_registry;
+    prometheus::Family<prometheus::Counter>& processed_counter_family;
+    prometheus::Family<prometheus::Gauge>&   processed_rate_family;
+
+public:
+
+    prometheus::Counter&                     n_reads;
+    prometheus::Counter&                     n_bases;
+    prometheus::Gauge&                       reads_per_second;
+    prometheus::Gauge&                       bases_per_second;
+
+    prometheus::Family<prometheus::Gauge>&   queue_depth_family;
+
+    RunMetrics(std::shared_ptr<prometheus::Registry> registry)
+        : pr_registry              (registry),
+          processed_counter_family (prometheus::BuildCounter()
+                                                .Name("boink_processor_consumed_total")
+                                                .Register(*pr_registry)),
+          processed_rate_family    (prometheus::BuildGauge()
+                                                .Name("boink_processor_consumed_per_second")
+                                                .Register(*pr_registry)),
+          n_reads                  (processed_counter_family.Add({{"unit", "reads"}})),
+          n_bases                  (processed_counter_family.Add({{"unit", "bases"}})),
+          reads_per_second         (processed_rate_family.Add({{"unit", "reads"}})),
+          bases_per_second         (processed_rate_family.Add({{"unit", "bases"}})),
+          queue_depth_family       (prometheus::BuildGauge()
+                                                .Name("boink_event_queue_depth")
+                                                .Register(*pr_registry))
+    {
+    }
+};
+
+
+/* Samples the dBG's storage, the processor's throughput and the queue
+ * depth of every tracked listener into a prometheus registry at each
+ * FINE interval, so that an exposed registry shows a run as it goes.
+ * Register it with the processor; track listeners before processing
+ * starts. Tracked listeners are kept alive until the reporter goes.
+ */
+template <class GraphType>
+class RunMetricsReporter : public events::EventListener {
+
+protected:
+
+    typedef std::chrono::steady_clock clock_type;
+
+    std::shared_ptr<GraphType>                           graph;
+    std::unique_ptr<RunMetrics>                          metrics;
+    std::unique_ptr<storage::StorageMetrics>             storage_metrics;
+
+    prometheus::Gauge&                                   own_queue_depth;
+    std::mutex                                           tracked_mutex;
+    std::vector<std::pair<shared_ptr<events::EventListener>,
+                          prometheus::Gauge*>>           tracked;
+
+    clock_type::time_point                               last_time;
+    uint64_t                                             last_reads;
+    uint64_t                                             last_bases;
+
+public:
+
+    RunMetricsReporter(std::shared_ptr<GraphType>            graph,
+                       std::shared_ptr<prometheus::Registry> registry)
+        : EventListener   ("RunMetricsReporter"),
+          graph           (graph),
+          metrics         (make_unique<RunMetrics>(registry)),
+          storage_metrics (make_unique<storage::StorageMetrics>(registry)),
+          own_queue_depth (metrics->queue_depth_family.Add({{"listener",
+                                                             this->THREAD_NAME}})),
+          last_time       (clock_type::now()),
+          last_reads      (0),
+          last_bases      (0)
+    {
+        _cerr(this->THREAD_NAME << " reporting at FINE interval.");
+        this->msg_type_whitelist.insert(events::MSG_TIME_INTERVAL);
+    }
+
+    void track_listener(shared_ptr<events::EventListener> listener) {
+        std::lock_guard<std::mutex> lock(tracked_mutex);
+        auto& gauge = metrics->queue_depth_family.Add({{"listener",
+                                                        listener->THREAD_NAME}});
+        tracked.emplace_back(listener, &gauge);
+    }
+
+    virtual void handle_msg(shared_ptr<events::Event> event) {
+        if (event->msg_type == events::MSG_TIME_INTERVAL) {
+            auto _event = static_cast<events::TimeIntervalEvent*>(event.get());
+            if (_event->level == events::TimeIntervalEvent::FINE ||
+                _event->level == events::TimeIntervalEvent::END) {
+                sample(_event->t, _event->n_bases);
+            }
+        }
+    }
+
+    void sample(uint64_t n_reads, uint64_t n_bases) {
+        storage_metrics->update(graph->storage());
+
+        auto now = clock_type::now();
+        double elapsed = std::chrono::duration<double>(now - last_time).count();
+        if (n_reads >= last_reads && n_bases >= last_bases) {
+            metrics->n_reads.Increment(n_reads - last_reads);
+            metrics->n_bases.Increment(n_bases - last_bases);
+            if (elapsed > 0) {
+                metrics->reads_per_second.Set((n_reads - last_reads) / elapsed);
+                metrics->bases_per_second.Set((n_bases - last_bases) / elapsed);
+            }
+        }
+        last_time = now;
+        last_reads = n_reads;
+        last_bases = n_bases;
+
+        own_queue_depth.Set(this->queue_depth());
+        std::lock_guard<std::mutex> lock(tracked_mutex);
+        for (auto& listener : tracked) {
+            listener.second->Set(listener.first->queue_depth());
+        }
+    }
+};
+
+
+}
+}
+
+#endif
@@ -19,6 +19,7 @@
 #include "boink/event_types.hh"
 #include "boink/cdbg/compactor.hh"
 #include "boink/reporting/reporters.hh"
+#include "boink/reporting/record_writer.hh"
 #include "boink/reporting/report_types.hh"
 
 
@@ -31,22 +32,122 @@ class StreamingCompactorReporter: public SingleFileReporter {
 protected:
 
     shared_ptr<cdbg::StreamingCompactor<GraphType>> compactor;
+    std::unique_ptr<RecordWriter>                   _records;
+
+    void _write_csv(uint64_t t, const StreamingCompactorReport& report) {
+        _output_stream << t << ","
+                       << report.n_full << ","
+                       << report.n_tips << ","
+                       << report.n_islands << ","
+                       << report.n_trivial << ","
+                       << report.n_circular << ","
+                       << report.n_loops << ","
+                       << report.n_dnodes << ","
+                       << report.n_unodes << ","
+                       << report.n_tags << ","
+                       << report.n_updates << ","
+                       << report.n_splits << ","
+                       << report.n_merges << ","
+                       << report.n_extends << ","
+                       << report.n_clips << ","
+                       << report.n_deletes << ","
+                       << report.n_circular_merges << ","
+                       << report.n_unique << ","
+                       << report.estimated_fp
+#ifdef BOINK_STAGE_TIMING
+                       << ","
+                       << report.t_find_segments << ","
+                       << report.t_find_induced << ","
+                       << report.t_induce_dnodes << ","
+                       << report.t_update_unodes << ","
+                       << report.t_dbg_insert << ","
+                       << report.t_coverage << ","
+                       << report.t_notify << ","
+                       << report.t_updates << ","
+                       << report.n_timed_updates
+#endif
+                       << std::endl;
+    }
+
+    void _write_record(uint64_t t, const StreamingCompactorReport& report) {
+        _records->put(t);
+        _records->put(report.n_full);
+        _records->put(report.n_tips);
+        _records->put(report.n_islands);
+        _records->put(report.n_trivial);
+        _records->put(report.n_circular);
+        _records->put(report.n_loops);
+        _records->put(report.n_dnodes);
+        _records->put(report.n_unodes);
+        _records->put(report.n_tags);
+        _records->put(report.n_updates);
+        _records->put(report.n_splits);
+        _records->put(report.n_merges);
+        _records->put(report.n_extends);
+        _records->put(report.n_clips);
+        _records->put(report.n_deletes);
+        _records->put(report.n_circular_merges);
+        _records->put(report.n_unique);
+        _records->put(report.estimated_fp);
+#ifdef BOINK_STAGE_TIMING
+        _records->put(report.t_find_segments);
+        _records->put(report.t_find_induced);
+        _records->put(report.t_induce_dnodes);
+        _records->put(report.t_update_unodes);
+        _records->put(report.t_dbg_insert);
+        _records->put(report.t_coverage);
+        _records->put(report.t_notify);
+        _records->put(report.t_updates);
+        _records->put(report.n_timed_updates);
+#endif
+        _records->end_record();
+    }
 
 public:
 
     StreamingCompactorReporter(shared_ptr<cdbg::StreamingCompactor<GraphType>> compactor,
-                               const std::string& output_filename)
-        : SingleFileReporter(output_filename, "StreamingCompactorReporter"),
+                               const std::string& output_filename,
+                               ReportFormat format = CSV_REPORT)
+        : SingleFileReporter(output_filename, "StreamingCompactorReporter",
+                             records::openmode(format)),
           compactor(compactor)
     {    
         _cerr(this->THREAD_NAME << " reporting at FINE interval.");
 
         this->msg_type_whitelist.insert(events::MSG_TIME_INTERVAL);
+        this->msg_type_whitelist.insert(events::MSG_FP_WARNING);
+
+        if (format == BINARY_REPORT) {
+            _records = make_unique<RecordWriter>(_output_stream);
+            for (auto name : {"read_n", "n_full", "n_tips", "n_islands", "n_trivial",
+                              "n_circular", "n_loops", "n_dnodes", "n_unodes", "n_tags",
+                              "n_updates", "n_splits", "n_merges", "n_extends", "n_clips",
+                              "n_deletes", "n_circular_merges", "n_unique"}) {
+                _records->add_column(name, records::COLUMN_UINT64);
+            }
+            _records->add_column("estimated_fp", records::COLUMN_FLOAT64);
+#ifdef BOINK_STAGE_TIMING
+            for (auto name : {"t_find_segments", "t_find_induced",
+                              "t_induce_dnodes", "t_update_unodes", "t_dbg_insert",
+                              "t_coverage", "t_notify", "t_updates"}) {
+                _records->add_column(name, records::COLUMN_FLOAT64);
+            }
+            _records->add_column("n_timed_updates", records::COLUMN_UINT64);
+#endif
+            _records->write_header();
+            return;
+        }
 
         _output_stream << "read_n,n_full,n_tips,n_islands,n_trivial"
                           ",n_circular,n_loops,n_dnodes,n_unodes,n_tags,"
                           "n_updates,n_splits,n_merges,n_extends,n_clips,"
-                          "n_deletes,n_circular_merges,n_unique,estimated_fp" << std::endl;
+                          "n_deletes,n_circular_merges,n_unique,estimated_fp"
+#ifdef BOINK_STAGE_TIMING
+                          ",t_find_segments,t_find_induced,t_induce_dnodes,"
+                          "t_update_unodes,t_dbg_insert,t_coverage,t_notify,"
+                          "t_updates,n_timed_updates"
+#endif
+                       << std::endl;
     }
 
     virtual void handle_msg(shared_ptr<events::Event> event) {
@@ -55,31 +156,27 @@ public:
             if (_event->level == events::TimeIntervalEvent::FINE ||
                 _event->level == events::TimeIntervalEvent::END) {
                 auto report = compactor->get_report();
-                _output_stream << _event->t << ","
-                               << report.n_full << ","
-                               << report.n_tips << ","
-                               << report.n_islands << ","
-                               << report.n_trivial << ","
-                               << report.n_circular << ","
-                               << report.n_loops << ","
-                               << report.n_dnodes << ","
-                               << report.n_unodes << ","
-                               << report.n_tags << ","
-                               << report.n_updates << ","
-                               << report.n_splits << ","
-                               << report.n_merges << ","
-                               << report.n_extends << ","
-                               << report.n_clips << ","
-                               << report.n_deletes << ","
-                               << report.n_circular_merges << ","
-                               << report.n_unique << ","
-                               << report.estimated_fp 
-                               << std::endl;
+                if (!_records) {
+                    _write_csv(_event->t, report);
+                    return;
+                }
+                _write_record(_event->t, report);
+                if (_event->level == events::TimeIntervalEvent::END) {
+                    _records->flush();
+                }
             }
+        } else if (event->msg_type == events::MSG_FP_WARNING && _records) {
+            // get the buffered rows to disk in case the run is stopped over it
+            _records->flush();
         }
     }
-};
 
+    virtual void handle_exit() {
+        if (_records) {
+            _records->flush();
+        }
+    }
+};
 
 }
 }
@@ -18,6 +18,7 @@
 #include "boink/boink.hh"
 #include "boink/event_types.hh"
 #include "boink/reporting/reporters.hh"
+#include "boink/reporting/record_writer.hh"
 #include "boink/reporting/report_types.hh"
 #include "boink/ukhs_signature.hh"
 
@@ -29,16 +30,27 @@ class UKHSSignatureReporter : public SingleFileReporter {
 private:
 
     std::shared_ptr<signatures::UKHSCountSignature> signature;
+    std::unique_ptr<RecordWriter>                   _records;
 
 public:
 
     UKHSSignatureReporter(std::shared_ptr<signatures::UKHSCountSignature> signature,
-                          const std::string&                              filename)
-        : SingleFileReporter(filename, "UKHSSignatureReporter"),
+                          const std::string&                              filename,
+                          ReportFormat                                    format = CSV_REPORT)
+        : SingleFileReporter(filename, "UKHSSignatureReporter",
+                             records::openmode(format)),
           signature(signature)
     {
         _cerr(this->THREAD_NAME << " reporting at MEDIUM interval.");
         this->msg_type_whitelist.insert(events::MSG_TIME_INTERVAL);
+
+        if (format == BINARY_REPORT) {
+            _records = make_unique<RecordWriter>(_output_stream);
+            _records->add_column("read_n", records::COLUMN_UINT64);
+            _records->add_column("signature", records::COLUMN_UINT64,
+                                 signature->get_size());
+            _records->write_header();
+        }
     }
 
     virtual void handle_msg(std::shared_ptr<events::Event> event) {
@@ -47,6 +59,13 @@ public:
             if (_event->level == events::TimeIntervalEvent::MEDIUM ||
                 _event->level == events::TimeIntervalEvent::END) {
                 
+                if (_records) {
+                    _records->put(_event->t);
+                    _records->put_all(signature->get_signature());
+                    _records->end_record();
+                    _records->flush();
+                    return;
+                }
                 _output_stream << _event->t;
                 auto counts = signature->get_signature();
                 for (auto& count : counts) {
@@ -160,7 +160,7 @@ public:
     }
 
     double estimated_fp() {
-        double fp = n_occupied() / _tablesizes[0];
+        double fp = (double) n_occupied() / _tablesizes[0];
         fp = pow(fp, n_tables());
         return fp;
     }
@@ -203,6 +203,14 @@ public:
         return 1;
     }
 
+    // pull the k-mer's bits into cache ahead of a query.
+    inline void prefetch(hashing::hash_t khash) const
+    {
+        for (size_t i = 0; i < _n_tables; i++) {
+            __builtin_prefetch(_counts[i] + (khash % _tablesizes[i]) / 8);
+        }
+    }
+
     // get the count for the given k-mer hash.
     inline const count_t query(hashing::hash_t khash) const
     {
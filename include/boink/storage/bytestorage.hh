@@ -98,6 +98,7 @@ protected:
     size_t   _n_tables;
     uint64_t _n_unique_kmers;
     uint64_t _occupied_bins;
+    uint64_t _n_saturated;
 
     byte_t ** _counts;
 
@@ -127,7 +128,8 @@ public:
         _bigcount_spin_lock(false), 
         _tablesizes(tablesizes),
         _n_unique_kmers(0), 
-        _occupied_bins(0)
+        _occupied_bins(0),
+        _n_saturated(0)
     {
         _supports_bigcount = true;
         _allocate_counters();
@@ -181,8 +183,13 @@ public:
         return _occupied_bins;
     }
 
+    const uint64_t n_saturated() const
+    {
+        return _n_saturated;
+    }
+
     double estimated_fp() {
-        double fp = n_occupied() / _tablesizes[0];
+        double fp = (double) n_occupied() / _tablesizes[0];
         fp = pow(fp, n_tables());
         return fp;
     }
@@ -225,6 +232,10 @@ public:
             }
         } // for each table
 
+        if (n_full == _n_tables) {
+            __sync_add_and_fetch(&_n_saturated, 1);
+        }
+
         // if all tables are full for this position, then add in bigcounts.
         if (n_full == _n_tables && _use_bigcount) {
             while (!__sync_bool_compare_and_swap(&_bigcount_spin_lock, 0, 1));
@@ -254,6 +265,14 @@ public:
         return query(khash);
     }
 
+    // pull the k-mer's bins into cache ahead of a query.
+    inline void prefetch(hashing::hash_t khash) const
+    {
+        for (unsigned int i = 0; i < _n_tables; i++) {
+            __builtin_prefetch(_counts[i] + khash % _tablesizes[i]);
+        }
+    }
+
     // get the count for the given k-mer hash.
     inline const count_t query(hashing::hash_t khash) const
     {
@@ -296,6 +315,11 @@ struct is_probabilistic<ByteStorage> {
       static const bool value = true;
 };
 
+template<>
+struct is_counting<ByteStorage> {
+      static const bool value = true;
+};
+
 // Helper classes for saving ByteStorage objs to disk & loading them.
 
 class ByteStorageFile
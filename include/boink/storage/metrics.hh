@@ -0,0 +1,71 @@
+/* storage/metrics.hh -- gauges for k-mer storage fill and accuracy
+ *
+ * Copyright (C) 2018 Camille Scott
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+
+#ifndef BOINK_STORAGE_METRICS_HH
+#define BOINK_STORAGE_METRICS_HH
+
+#include <memory>
+#include <string>
+
+#include <prometheus/registry.h>
+
+#include "boink/storage/storage.hh"
+
+namespace boink {
+namespace storage {
+
+
+/* One gauge per measure, labeled with the storage's name so that
+ * several storages can publish to the same registry. Values are polled
+ * with update(); the storages keep no reference to their metrics.
+ */
+struct StorageMetrics {
+
+private:
+
+    std::shared_ptr<prometheus::Registry>  pr_registry;
+    prometheus::Family<prometheus::Gauge>& storage_gauge_family;
+
+public:
+
+    prometheus::Gauge&                     n_unique;
+    prometheus::Gauge&                     n_occupied;
+    prometheus::Gauge&                     n_saturated;
+    prometheus::Gauge&                     estimated_fp;
+
+    StorageMetrics(std::shared_ptr<prometheus::Registry> registry,
+                   const std::string&                    storage_name = "dbg")
+        : pr_registry          (registry),
+          storage_gauge_family (prometheus::BuildGauge()
+                                            .Name("boink_storage_current")
+                                            .Register(*pr_registry)),
+          n_unique             (storage_gauge_family.Add({{"storage", storage_name},
+                                                          {"measure", "unique_kmers"}})),
+          n_occupied           (storage_gauge_family.Add({{"storage", storage_name},
+                                                          {"measure", "occupied_bins"}})),
+          n_saturated          (storage_gauge_family.Add({{"storage", storage_name},
+                                                          {"measure", "saturated_inserts"}})),
+          estimated_fp         (storage_gauge_family.Add({{"storage", storage_name},
+                                                          {"measure", "estimated_fp"}}))
+    {
+    }
+
+    void update(Storage& storage) {
+        n_unique.Set(storage.n_unique_kmers());
+        n_occupied.Set(storage.n_occupied());
+        n_saturated.Set(storage.n_saturated());
+        estimated_fp.Set(storage.estimated_fp());
+    }
+};
+
+
+}
+}
+
+#endif
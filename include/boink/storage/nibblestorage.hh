@@ -83,6 +83,7 @@ protected:
     size_t _n_tables;
     uint64_t _occupied_bins;
     uint64_t _n_unique_kmers;
+    uint64_t _n_saturated;
     std::array<std::mutex, 32> mutexes;
     static constexpr uint8_t _max_count{15};
     byte_t ** _counts;
@@ -112,7 +113,7 @@ public:
 
     NibbleStorage(const std::vector<uint64_t>& tablesizes) :
         _tablesizes{tablesizes},
-        _occupied_bins{0}, _n_unique_kmers{0}
+        _occupied_bins{0}, _n_unique_kmers{0}, _n_saturated{0}
     {
         // to allow more than 32 tables increase the size of mutex pool
         assert(_n_tables <= 32);
@@ -163,6 +164,7 @@ public:
     inline const bool insert(hashing::hash_t khash)
     {
         bool is_new_kmer = false;
+        unsigned int n_full = 0;
 
         for (unsigned int i = 0; i < _n_tables; i++) {
             MuxGuard g(mutexes[i]);
@@ -186,6 +188,7 @@ public:
             // if we have reached the maximum count stop incrementing the
             // counter. This avoids overflowing it.
             if (current_count == _max_count) {
+                n_full++;
                 continue;
             }
 
@@ -194,6 +197,10 @@ public:
             table[idx] = (table[idx] & ~mask) | (new_count & mask);
         }
 
+        if (n_full == _n_tables) {
+            __sync_add_and_fetch(&_n_saturated, 1);
+        }
+
         if (is_new_kmer) {
             __sync_add_and_fetch(&_n_unique_kmers, 1);
         }
@@ -209,6 +216,14 @@ public:
         return query(khash);
     }
 
+    // pull the k-mer's bins into cache ahead of a query.
+    inline void prefetch(hashing::hash_t khash) const
+    {
+        for (unsigned int i = 0; i < _n_tables; i++) {
+            __builtin_prefetch(_counts[i] + _table_index(khash, _tablesizes[i]));
+        }
+    }
+
     // get the count for the given k-mer hash.
     inline const count_t query(hashing::hash_t khash) const
     {
@@ -246,8 +261,12 @@ public:
     {
         return _occupied_bins;
     }
+    const uint64_t n_saturated() const
+    {
+        return _n_saturated;
+    }
     double estimated_fp() {
-        double fp = n_occupied() / _tablesizes[0];
+        double fp = (double) n_occupied() / _tablesizes[0];
         fp = pow(fp, n_tables());
         return fp;
     }
@@ -266,6 +285,11 @@ struct is_probabilistic<NibbleStorage> {
       static const bool value = true;
 };
 
+template<>
+struct is_counting<NibbleStorage> {
+      static const bool value = true;
+};
+
 }
 }
 
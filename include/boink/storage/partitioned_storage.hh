@@ -90,10 +90,15 @@ public:
         return n_partitions;
     }
 
-    template<typename Dummy = double>
-    auto estimated_fp() 
-    -> std::enable_if_t<storage::is_probabilistic<BaseStorageType>::value, Dummy>
-    {
+    const uint64_t n_saturated() const {
+        uint64_t sum = 0;
+        for (auto& partition : partitions) {
+            sum += partition->n_saturated();
+        }
+        return sum;
+    }
+
+    double estimated_fp() {
         double sum = 0;
         for (auto& partition : partitions) {
             sum += partition->estimated_fp();
@@ -158,12 +163,16 @@ public:
 };
 
 
-template<>
 template<class StorageType>
 struct is_probabilistic<PartitionedStorage<StorageType>> { 
       static const bool value = is_probabilistic<StorageType>::value;
 };
 
+template<class StorageType>
+struct is_counting<PartitionedStorage<StorageType>> {
+      static const bool value = is_counting<StorageType>::value;
+};
+
 }
 }
 #endif
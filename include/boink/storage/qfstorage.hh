@@ -85,6 +85,9 @@ public:
   // get the count for the given k-mer hash.
   const count_t query(hashing::hash_t khash) const;
 
+  // nop: the filter's runs have to be walked to find a slot
+  void prefetch(hashing::hash_t khash) const {}
+
   // Accessors for protected/private table info members
   // xnslots is larger than nslots. It includes some extra slots to deal
   // with some details of how the counting is implemented
@@ -101,7 +104,7 @@ public:
   void reset() {}; //nop
 
   double estimated_fp() {
-      double fp = n_occupied() / get_tablesizes()[0];
+      double fp = (double) n_occupied() / get_tablesizes()[0];
       fp = pow(fp, n_tables());
       return fp;
   }
@@ -113,6 +116,11 @@ struct is_probabilistic<QFStorage> {
       static const bool value = true;
 };
 
+template<>
+struct is_counting<QFStorage> {
+      static const bool value = true;
+};
+
 }
 }
 
@@ -57,13 +57,8 @@ public:
         return n_buckets();
     }
 
-    void save(std::string, uint16_t ) {
-     
-    }
-
-    void load(std::string, uint16_t &) {
-
-    }
+    void save(std::string outfilename, uint16_t ksize);
+    void load(std::string infilename, uint16_t& ksize);
 
     const bool insert(hashing::hash_t h) {
         auto result = _store.insert(h);
@@ -81,6 +76,14 @@ public:
         return _store.count(h);
     }
 
+    // sparsepp doesn't expose where a key's bucket lives
+    void prefetch(hashing::hash_t h) const {
+    }
+
+    const bool remove(hashing::hash_t h) {
+        return _store.erase(h) > 0;
+    }
+
 
     byte_t ** get_raw_tables() {
         return nullptr;
@@ -94,6 +97,11 @@ struct is_probabilistic<SparseppSetStorage> {
       static const bool value = false;
 };
 
+template<>
+struct supports_removal<SparseppSetStorage> {
+      static const bool value = true;
+};
+
 
 }
 }
@@ -70,6 +70,7 @@
 #   define SAVED_LABELSET 6
 #   define SAVED_SMALLCOUNT 7
 #   define SAVED_QFCOUNT 8
+#   define SAVED_SPARSEPP 9
 
 
 namespace boink {
@@ -88,6 +89,19 @@ struct is_probabilistic {
       static const bool value = false;
 };
 
+/* True when query returns how many times a k-mer was inserted
+ * (saturating), rather than only whether it was.
+ */
+template< typename T >
+struct is_counting {
+      static const bool value = false;
+};
+
+template< typename T >
+struct supports_removal {
+      static const bool value = false;
+};
+
 //
 // base Storage class for hashtable-related storage of information in memory.
 //
@@ -111,6 +125,17 @@ public:
     virtual const uint64_t n_occupied() const = 0;
     virtual const uint64_t n_unique_kmers() const = 0;
 
+    // Exact storages have no false positives.
+    virtual double estimated_fp() {
+        return 0.0;
+    }
+
+    // Inserts of k-mers already at the maximum count in every table;
+    // with bigcount on, these are the ones that spill over to it.
+    virtual const uint64_t n_saturated() const {
+        return 0;
+    }
+
     virtual const bool    insert(hashing::hash_t khash ) = 0;
     virtual const count_t insert_and_query(hashing::hash_t khash) = 0;
     virtual const count_t query(hashing::hash_t khash) const = 0;
@@ -0,0 +1,10 @@
+/* boink/cdbg/batch_compactor.cc
+ *
+ * Copyright (C) 2018 Camille Scott
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+
+#include "boink/cdbg/batch_compactor.hh"
@@ -12,6 +12,7 @@
 
 #include <utility>
 #include <string>
+#include <vector>
 
 
 using namespace utils;
@@ -135,5 +136,90 @@ void filter_length(ReadBundle& bundle, uint32_t length) {
     }
 }
 
+
+
+QualityFilter::QualityFilter(uint8_t min_quality,
+                             uint16_t min_length,
+                             uint8_t offset)
+    : _min_quality(min_quality),
+      _min_length(min_length),
+      _offset(offset),
+      _n_reads_masked(0),
+      _n_bases_masked(0),
+      _n_kmers_filtered(0)
+{
+    if (_min_length == 0) {
+        throw BoinkException("QualityFilter min_length must be > 0.");
+    }
+    // the threshold is compared as a raw quality byte
+    if (static_cast<int>(_offset) + _min_quality > 255) {
+        throw BoinkException("QualityFilter min_quality + offset must be <= 255.");
+    }
+}
+
+
+bool QualityFilter::find_segments(const Read& read,
+                                  std::vector<segment_t>& segments) {
+    segments.clear();
+    const size_t length = read.cleaned_seq.length();
+    if (read.quality.length() != length || length == 0) {
+        segments.push_back(segment_t(0, length));
+        return true;
+    }
+
+    // Branch-free pass over the quality string so the compiler can
+    // vectorize it; the run scan below only touches the mask.
+    const uint8_t threshold = _offset + _min_quality;
+    const uint8_t * qual = reinterpret_cast<const uint8_t*>(read.quality.data());
+    _mask.resize(length);
+    uint8_t * mask = _mask.data();
+    size_t n_passing = 0;
+    for (size_t i = 0; i < length; ++i) {
+        mask[i] = qual[i] >= threshold;
+        n_passing += mask[i];
+    }
+
+    if (n_passing == length) {
+        segments.push_back(segment_t(0, length));
+        return true;
+    }
+
+    uint64_t n_kept_kmers = 0;
+    size_t start = 0;
+    while (start < length) {
+        while (start < length && !mask[start]) {
+            ++start;
+        }
+        size_t end = start;
+        while (end < length && mask[end]) {
+            ++end;
+        }
+        if (end - start >= _min_length) {
+            segments.push_back(segment_t(start, end - start));
+            n_kept_kmers += end - start - _min_length + 1;
+        }
+        start = end;
+    }
+
+    uint64_t n_kmers = length >= _min_length ? length - _min_length + 1 : 0;
+    ++_n_reads_masked;
+    _n_bases_masked += length - n_passing;
+    _n_kmers_filtered += n_kmers - n_kept_kmers;
+
+    return false;
+}
+
+
+Read QualityFilter::make_segment(const Read& read,
+                                 const segment_t& segment) const {
+    Read result;
+    result.name = read.name;
+    result.description = read.description;
+    result.sequence = read.sequence.substr(segment.first, segment.second);
+    result.quality = read.quality.substr(segment.first, segment.second);
+    result.cleaned_seq = read.cleaned_seq.substr(segment.first, segment.second);
+    return result;
+}
+
 }
 }
@@ -0,0 +1,10 @@
+/* cdbg_history_log.cc
+ *
+ * Copyright (C) 2018 Camille Scott
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+
+#include "boink/reporting/cdbg_history_log.hh"
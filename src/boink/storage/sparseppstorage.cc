@@ -8,3 +8,122 @@
  */
 
 #include "boink/storage/sparseppstorage.hh"
+
+#include <errno.h>
+#include <cstring>
+#include <sstream> // IWYU pragma: keep
+#include <fstream>
+#include <iostream>
+
+#include "boink/boink.hh"
+#include "boink/hashing/hashing_types.hh"
+
+using namespace std;
+using namespace boink;
+using namespace boink::storage;
+using namespace boink::hashing;
+
+
+void SparseppSetStorage::save(std::string outfilename, uint16_t ksize)
+{
+    unsigned int save_ksize = ksize;
+    unsigned long long n_hashes = _store.size();
+
+    ofstream outfile(outfilename.c_str(), ios::binary);
+    if (!outfile.is_open()) {
+        throw BoinkFileException("Cannot open k-mer set file: " + outfilename);
+    }
+
+    outfile.write(SAVED_SIGNATURE, 4);
+    unsigned char version = SAVED_FORMAT_VERSION;
+    outfile.write((const char *) &version, 1);
+
+    unsigned char ht_type = SAVED_SPARSEPP;
+    outfile.write((const char *) &ht_type, 1);
+
+    outfile.write((const char *) &save_ksize, sizeof(save_ksize));
+    outfile.write((const char *) &n_hashes, sizeof(n_hashes));
+
+    for (auto h : _store) {
+        outfile.write((const char *) &h, sizeof(h));
+    }
+    if (outfile.fail()) {
+        throw BoinkFileException(strerror(errno));
+    }
+    outfile.close();
+}
+
+
+void SparseppSetStorage::load(std::string infilename, uint16_t &ksize)
+{
+    ifstream infile;
+
+    // configure ifstream to raise exceptions for everything.
+    infile.exceptions(std::ifstream::failbit | std::ifstream::badbit |
+                      std::ifstream::eofbit);
+
+    try {
+        infile.open(infilename.c_str(), ios::binary);
+    } catch (std::ifstream::failure &e) {
+        throw BoinkFileException("Cannot open k-mer set file: " + infilename
+                                 + " " + strerror(errno));
+    }
+
+    unsigned int save_ksize = 0;
+    unsigned long long n_hashes = 0;
+    char signature[4];
+    unsigned char version = 0, ht_type = 0;
+
+    try {
+        infile.read(signature, 4);
+        infile.read((char *) &version, 1);
+        infile.read((char *) &ht_type, 1);
+    } catch (std::ifstream::failure &e) {
+        throw BoinkFileException("Unexpected end of k-mer set file: " + infilename);
+    }
+
+    if (!(std::string(signature, 4) == SAVED_SIGNATURE)) {
+        std::ostringstream err;
+        err << "Does not start with signature for a oxli file: 0x";
+        for(size_t i=0; i < 4; ++i) {
+            err << std::hex << (int) signature[i];
+        }
+        err << " Should be: " << SAVED_SIGNATURE;
+        throw BoinkFileException(err.str());
+    } else if (!(version == SAVED_FORMAT_VERSION)) {
+        std::ostringstream err;
+        err << "Incorrect file format version " << (int) version
+            << " while reading k-mer set from " << infilename
+            << "; should be " << (int) SAVED_FORMAT_VERSION;
+        throw BoinkFileException(err.str());
+    } else if (!(ht_type == SAVED_SPARSEPP)) {
+        std::ostringstream err;
+        err << "Incorrect file format type " << (int) ht_type
+            << " while reading k-mer set from " << infilename;
+        throw BoinkFileException(err.str());
+    }
+
+    try {
+        infile.read((char *) &save_ksize, sizeof(save_ksize));
+        infile.read((char *) &n_hashes, sizeof(n_hashes));
+
+        _store.clear();
+        _store.reserve(n_hashes);
+        for (unsigned long long i = 0; i < n_hashes; ++i) {
+            hash_t h;
+            infile.read((char *) &h, sizeof(h));
+            _store.insert(h);
+        }
+        infile.close();
+    } catch (std::ifstream::failure &e) {
+        std::string err;
+        if (infile.eof()) {
+            err = "Unexpected end of k-mer set file: " + infilename;
+        } else {
+            err = "Error reading from k-mer set file: " + infilename;
+        }
+        throw BoinkFileException(err);
+    }
+
+    ksize = (uint16_t) save_ksize;
+}